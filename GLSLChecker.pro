@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT       += core gui opengl
+QT       += core gui opengl concurrent
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
 TARGET = GLSLChecker
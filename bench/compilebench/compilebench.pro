@@ -0,0 +1,25 @@
+#-------------------------------------------------
+#
+# Parallel compile benchmark
+#
+#-------------------------------------------------
+
+QT       += core gui
+
+TARGET = compilebench
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../../libtinyhl/
+QMAKE_LIBDIR += $$PWD/../../build_lib
+LIBS += -ltinyhl
+SOURCES += main.cpp
+
+QMAKE_CXXFLAGS += -std=c++11
+CONFIG(debug, debug|release) {
+    DEFINES += DEBUG _DEBUG
+}
+CONFIG(release, debug|release) {
+    DEFINES += NDEBUG
+}
@@ -0,0 +1,170 @@
+#include "compilepool.h"
+#include "compilecache.h"
+#include "offscreencontext.h"
+#include <QGuiApplication>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QThread>
+#include <cstdio>
+#include <stdexcept>
+#include <algorithm>
+
+namespace {
+	using SourceV = glsl::CompilePool::SourceV;
+	//! ベンチマーク用のプログラムを生成
+	/*! ドライバのシェーダーキャッシュに当たらないよう、プログラム毎に定数を変えておく
+		\param[in] first	定数の通し番号の開始値 */
+	SourceV MakeSyntheticPrograms(int n, int first) {
+		const char* c_vs =
+			"#version 130\n"
+			"uniform mat4 u_mvp;\n"
+			"uniform mat3 u_normal;\n"
+			"in vec4 a_pos;\n"
+			"in vec3 a_normal;\n"
+			"out vec3 v_normal;\n"
+			"void main() {\n"
+			"	v_normal = normalize(u_normal * a_normal) * %1;\n"
+			"	gl_Position = u_mvp * a_pos;\n"
+			"}\n";
+		const char* c_fs =
+			"#version 130\n"
+			"#define LIGHT_COUNT 16\n"
+			"uniform vec3 u_lightDir[LIGHT_COUNT];\n"
+			"uniform vec4 u_color;\n"
+			"in vec3 v_normal;\n"
+			"out vec4 o_color;\n"
+			"float lit(int i, vec3 n) {\n"
+			"	return max(dot(n, u_lightDir[i]), 0.0) * %1;\n"
+			"}\n"
+			"void main() {\n"
+			"	vec3 n = normalize(v_normal);\n"
+			"	float c = 0.0;\n"
+			"	for(int i=0 ; i<LIGHT_COUNT ; i++)\n"
+			"		c += lit(i, n) / float(i + 1);\n"
+			"	o_color = u_color * c;\n"
+			"}\n";
+		SourceV ret(n);
+		for(int i=0 ; i<n ; i++) {
+			const QString k = QString("1.%1").arg(first + i, 8, 10, QChar('0'));
+			ret[i].source[glsl::Shader::Vertex] = QString(c_vs).arg(k);
+			ret[i].source[glsl::Shader::Fragment] = QString(c_fs).arg(k);
+		}
+		return ret;
+	}
+	//! srcを全てcompileProgramし、成功してリンク済みのプログラムが返った数を数える
+	int CompileLinked(glsl::Compiler& compiler, const SourceV& src) {
+		int nOk = 0;
+		for(auto& s : src) {
+			glsl::CompileResult res;
+			auto prog = compiler.compileProgram(s, res);
+			if(res.bSuccess && prog && prog->isLinked())
+				++nOk;
+		}
+		return nOk;
+	}
+	//! キャッシュのプログラムバイナリをドライバが受け付けなかった時に、コンパイルし直してエントリを更新するか確かめる
+	/*! 全エントリのバイナリを壊してからもう一度コンパイルし、全てrejectedに数えられて結果が正しいことと、
+		その次は更新したエントリのバイナリから復元できることを調べる
+		\return 問題が無ければtrue (プログラムバイナリを扱えないドライバでは確かめずにtrue) */
+	bool CheckBinary(int nProgram) {
+		glsl::OffscreenContext ctx;
+		if(!ctx.makeCurrent())
+			throw std::runtime_error("can't make OpenGL context current");
+		QTemporaryDir dir;
+		if(!dir.isValid())
+			throw std::runtime_error("can't make a temporary cache directory");
+		bool bOk = true;
+		{
+			// プログラムはコンテキストがカレントのうちに破棄する
+			glsl::Compiler compiler;
+			if(!compiler.hasProgramBinary()) {
+				std::printf("check-binary: skipped (the driver has no program binary format)\n");
+				ctx.doneCurrent();
+				return true;
+			}
+			glsl::CompileCache cache(dir.path());
+			compiler.setCache(&cache);
+			const SourceV src = MakeSyntheticPrograms(nProgram, 0);
+			const auto fnCheck = [&bOk](const char* step, bool b) {
+				std::printf("check-binary: %-28s %s\n", step, b ? "ok" : "FAILED");
+				if(!b)
+					bOk = false;
+			};
+			// 1回目はコンパイルしてバイナリ付きで置く
+			fnCheck("compile", CompileLinked(compiler, src) == nProgram && cache.stat().miss == quint64(nProgram));
+
+			// ドライバの更新を模して、全エントリのバイナリを壊す
+			int nCorrupt = 0;
+			for(auto& s : src) {
+				const QByteArray key = glsl::CompileCache::MakeKey(s, compiler.driverInfo());
+				glsl::CompileResult res;
+				if(!cache.find(key, res) || res.binary.data.isEmpty())
+					continue;
+				char* p = res.binary.data.data();
+				for(int i=0 ; i<res.binary.data.size() ; i++)
+					p[i] = ~p[i];
+				cache.store(key, res);
+				++nCorrupt;
+			}
+			fnCheck("corrupt binaries", nCorrupt == nProgram);
+
+			// 2回目は全て受け付けられず、コンパイルし直してエントリを更新する
+			const glsl::CompileCache::Stat before = cache.stat();
+			const int nLinked = CompileLinked(compiler, src);
+			glsl::CompileCache::Stat st = cache.stat();
+			fnCheck("fall back to compile", nLinked == nProgram && st.rejected - before.rejected == quint64(nProgram));
+
+			// 3回目は更新したバイナリから復元できる
+			const glsl::CompileCache::Stat before2 = st;
+			const int nRestored = CompileLinked(compiler, src);
+			st = cache.stat();
+			fnCheck("restore refreshed entries", nRestored == nProgram && st.rejected == before2.rejected
+																	&& st.hit - before2.hit == quint64(nProgram));
+		}
+		ctx.doneCurrent();
+		return bOk;
+	}
+}
+/*! 使い方: compilebench [--check-binary] [プログラム数] [最大ワーカー数]
+	ワーカー数を1から最大まで変えてプログラムを並列にコンパイル・リンクし、毎秒のシェーダー数を出力する。
+	--check-binaryではキャッシュのプログラムバイナリが使えない時の動作を確かめ、問題があれば1で終了する */
+int main(int argc, char* argv[]) {
+	if(qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+		qputenv("QT_QPA_PLATFORM", "offscreen");
+	QGuiApplication app(argc, argv);
+	QStringList args = app.arguments();
+	const bool bCheckBinary = args.removeAll("--check-binary") > 0;
+	const int nProgram = (args.size() > 1) ? args[1].toInt() : 256,
+			nMaxWorker = (args.size() > 2) ? args[2].toInt() : std::max(1, QThread::idealThreadCount());
+	if(nProgram <= 0 || nMaxWorker <= 0) {
+		std::fprintf(stderr, "usage: compilebench [--check-binary] [programs] [max workers]\n");
+		return 1;
+	}
+	try {
+		if(bCheckBinary)
+			return CheckBinary(nProgram) ? 0 : 1;
+		std::printf("programs: %d (%d shaders)\n", nProgram, nProgram * 2);
+		double base = 0;
+		for(int nw=1 ; nw<=nMaxWorker ; nw++) {
+			glsl::CompilePool pool(nw);
+			// 最初のコンパイルはコンテキストの初期化を含むので計測から外す
+			pool.compileAll(MakeSyntheticPrograms(nw, 0));
+			// ワーカー数毎に別の定数を使い、前回の結果がキャッシュされていても当たらないようにする
+			const SourceV src = MakeSyntheticPrograms(nProgram, nProgram * nw);
+
+			QElapsedTimer timer;
+			timer.start();
+			auto res = pool.compileAll(src);
+			const qint64 ns = std::max<qint64>(timer.nsecsElapsed(), 1);
+			const int nFailed = std::count_if(res.begin(), res.end(), [](const glsl::CompileResult& r){ return !r.bSuccess; });
+			const double sps = nProgram * 2 / (ns * 1e-9);
+			if(nw == 1)
+				base = sps;
+			std::printf("workers %2d : %10.1f shaders/s  (x%.2f, %d failed)\n", nw, sps, sps / base, nFailed);
+		}
+	} catch(const std::exception& e) {
+		std::fprintf(stderr, "compilebench: %s\n", e.what());
+		return 2;
+	}
+	return 0;
+}
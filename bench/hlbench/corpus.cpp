@@ -0,0 +1,155 @@
+#include "corpus.h"
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QTextStream>
+#include <cstdint>
+
+namespace {
+	//! 実行毎に同じ列を返す乱数 (LCG)
+	class Random {
+		uint32_t	_state;
+		public:
+			Random(uint32_t seed): _state(seed) {}
+			uint32_t next() {
+				_state = _state * 1664525u + 1013904223u;
+				return _state >> 8;
+			}
+			int range(int n) {
+				return int(next() % uint32_t(n));
+			}
+			template <class T, size_t N>
+			const T& pick(const T (&a)[N]) {
+				return a[range(int(N))];
+			}
+	};
+	const char* c_statement[] = {
+		"vec3 n = normalize(mat3(u_normal) * a_normal.xyz) * 0.5 + vec3(0.5);",
+		"float d = max(dot(n, l), 0.0) * u_intensity;",
+		"color.rgb += texture(u_tex0, v_uv).rgb * d;",
+		"if(any(greaterThan(abs(p), vec3(1.0)))) discard;",
+		"for(int i=0 ; i<LIGHT_COUNT ; i++) { acc += lit(i, n); }",
+		"ivec2 px = ivec2(gl_FragCoord.xy) & ivec2(7);",
+		"mat4 m = transpose(inverse(u_model)) * u_view;",
+		"uvec4 k = uvec4(px.xyxy) ^ uvec4(0x9E3779B9u);",
+		"gl_Position = u_mvp * vec4(a_pos, 1.0);",
+		"o_color = vec4(pow(c, vec3(1.0 / 2.2)), 1.0);"
+	};
+	const char* c_word[] = {
+		"the", "light", "vector", "is", "normalized", "before", "use", "and",
+		"clamped", "to", "avoid", "NaN", "when", "length", "zero", "see", "vec3",
+		"float", "uniform", "texture", "in", "out", "sampler2D", "precision"
+	};
+	const char* c_number[] = {
+		"1.0", "0.5", "2.5e-3", "1e3", ".25", "3.f", "42u", "0x1Fu", "7.0lf", "0777",
+		"123.456", "1.0E+10", "0.0", "65535u", "3.14159265", "1.5f", "0xFFFF", "8"
+	};
+}
+Corpus MakeCorpus(const QString& name, const QStringList& lines) {
+	Corpus c;
+	c.name = name;
+	c.lines = lines;
+	c.utf8 = lines.join('\n').toUtf8();
+	c.bytes = c.utf8.size();
+	return c;
+}
+QStringList MakeLongLines(int n) {
+	Random rnd(1);
+	QStringList ret;
+	for(int i=0 ; i<n ; i++) {
+		QString line;
+		while(line.length() < 2000) {
+			line += rnd.pick(c_statement);
+			line += ' ';
+		}
+		ret << line;
+	}
+	return ret;
+}
+QStringList MakeCommentLines(int n) {
+	Random rnd(2);
+	QStringList ret;
+	const auto fnSentence = [&rnd](int nWord) {
+		QStringList ws;
+		for(int i=0 ; i<nWord ; i++)
+			ws << rnd.pick(c_word);
+		return ws.join(' ');
+	};
+	while(ret.size() < n) {
+		switch(rnd.range(4)) {
+			case 0: {
+				// 複数行のブロックコメント
+				ret << "/*";
+				const int nl = 3 + rnd.range(8);
+				for(int i=0 ; i<nl ; i++)
+					ret << "\t" + fnSentence(6 + rnd.range(10));
+				ret << "*/";
+			} break;
+			case 1:
+				ret << "// " + fnSentence(8 + rnd.range(8));
+				break;
+			case 2:
+				ret << QString(rnd.pick(c_statement)) + "\t// " + fnSentence(4 + rnd.range(6));
+				break;
+			default:
+				ret << QString("float x%1 = /* %2 */ %3;").arg(ret.size()).arg(fnSentence(3)).arg(rnd.pick(c_number));
+				break;
+		}
+	}
+	return ret;
+}
+QStringList MakeNumberLines(int n) {
+	Random rnd(3);
+	QStringList ret;
+	for(int i=0 ; i<n ; i++) {
+		QStringList nums;
+		const int nn = 8 + rnd.range(16);
+		for(int j=0 ; j<nn ; j++)
+			nums << rnd.pick(c_number);
+		ret << QString("const float k%1[%2] = float[](%3);").arg(i).arg(nn).arg(nums.join(", "));
+	}
+	return ret;
+}
+QStringList MakeMixedLines(int n) {
+	const char* c_line[] = {
+		"uniform mat4 u_mvp; uniform sampler2D u_tex0; uniform vec4 u_color;",
+		"vec3 n = normalize(mat3(u_normal) * a_normal.xyz) * 0.5 + vec3(0.5, 0.25, 1.0);",
+		"#define LIGHT_COUNT 16",
+		"for(int i=0 ; i<LIGHT_COUNT ; i++) { col += lit(i, n, 1.5f, 0x10, 2u) * .25; }",
+		"ivec2 p = ivec2(gl_FragCoord.xy) + ivec2(3, 7); uvec4 k = uvec4(p.xyxy);",
+		"float d = dot(v, v) * 123.456 + 789.0lf - 1e3; dmat2x3 m; isampler2DArray s;"
+	};
+	QStringList ret;
+	for(int i=0 ; i<n ; i++)
+		ret << c_line[i % (sizeof(c_line)/sizeof(c_line[0]))];
+	return ret;
+}
+QStringList LoadLines(const QStringList& paths) {
+	QStringList ret;
+	for(auto& p : paths) {
+		QFile file(p);
+		if(!file.open(QFile::ReadOnly | QFile::Text))
+			continue;
+		QTextStream ts(&file);
+		ts.setCodec("UTF-8");
+		while(!ts.atEnd())
+			ret << ts.readLine();
+	}
+	return ret;
+}
+QStringList ListShaderFiles(const QString& dir) {
+	QStringList ret;
+	QDirIterator itr(dir, QStringList() << "*.vsh" << "*.fsh" << "*.glsl" << "*.vert" << "*.frag", QDir::Files, QDirIterator::Subdirectories);
+	while(itr.hasNext())
+		ret << itr.next();
+	ret.sort();
+	return ret;
+}
+QStringList RepeatLines(const QStringList& lines, int n) {
+	QStringList ret;
+	if(lines.isEmpty())
+		return ret;
+	while(ret.size() < n)
+		ret << lines;
+	return ret;
+}
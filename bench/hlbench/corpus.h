@@ -0,0 +1,29 @@
+#pragma once
+#include <QStringList>
+#include <QByteArray>
+#include <vector>
+
+//! ベンチマークに使う行の集まり
+struct Corpus {
+	QString		name;
+	QStringList	lines;
+	QByteArray	utf8;		//!< linesを改行で連結したUTF-8
+	qint64		bytes;		//!< utf8のバイト数
+};
+using CorpusV = std::vector<Corpus>;
+
+Corpus MakeCorpus(const QString& name, const QStringList& lines);
+//! 数百文字の文を繋げた長い行
+QStringList MakeLongLines(int n);
+//! ブロックコメントと行コメントが大半を占める行
+QStringList MakeCommentLines(int n);
+//! 数値リテラルが密集した行
+QStringList MakeNumberLines(int n);
+//! 宣言・式・ディレクティブが混ざった一般的な行
+QStringList MakeMixedLines(int n);
+//! ファイルを行に分けて読み込む
+QStringList LoadLines(const QStringList& paths);
+//! dir以下のシェーダーファイル (名前順)
+QStringList ListShaderFiles(const QString& dir);
+//! 行数がn以上になるまでlinesを繰り返す
+QStringList RepeatLines(const QStringList& lines, int n);
@@ -0,0 +1,30 @@
+#-------------------------------------------------
+#
+# Highlighter benchmark
+#
+#-------------------------------------------------
+
+QT       += core gui concurrent
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+TARGET = hlbench
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../../libtinyhl/
+QMAKE_LIBDIR += $$PWD/../../build_lib
+LIBS += -ltinyhl
+SOURCES += corpus.cpp \
+	    main.cpp \
+	    memstat.cpp
+HEADERS += corpus.h \
+	    memstat.h
+
+QMAKE_CXXFLAGS += -std=c++11
+CONFIG(debug, debug|release) {
+    DEFINES += DEBUG _DEBUG
+}
+CONFIG(release, debug|release) {
+    DEFINES += NDEBUG
+}
@@ -0,0 +1,502 @@
+#include "corpus.h"
+#include "memstat.h"
+#include "linehighlighter.h"
+#include "syntaxhighlighter.h"
+#include "regexset.h"
+#include "simdscan.h"
+#include <QGuiApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QTextDocument>
+#include <QRegExp>
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <algorithm>
+
+namespace {
+	//! 1つのコーパスと方式の計測結果
+	struct Result {
+		QString		corpus,
+					mode;
+		int			lines;
+		qint64		tokens,		//!< 出力したSpanの数
+					ns;			//!< 最速の回の処理時間
+		double		allocPerLine,
+					regexPerLine;	//!< 1行当たりにQRegularExpressionを評価した回数
+		qint64		peakBytes;	//!< 負数なら取得できなかった
+
+		double nsPerLine() const { return double(ns) / lines; }
+		double nsPerToken() const { return tokens > 0 ? double(ns) / tokens : 0; }
+		double linesPerSec() const { return lines / (std::max<qint64>(ns, 1) * 1e-9); }
+		QString key() const { return corpus + "/" + mode; }
+	};
+	using ResultV = std::vector<Result>;
+	//! 計測する処理 (出力したSpanの数を返す。数えない場合は負数)
+	using RunFn = std::function<qint64 ()>;
+	//! 計測の前に毎回行う準備 (時間と確保回数に含めない)
+	using PrepareFn = std::function<void ()>;
+
+	/*! 一度空回ししてからnRepeat回計測し、最速の時間と平均の確保回数を取る */
+	Result Measure(const Corpus& c, const QString& mode, int nRepeat, const PrepareFn& fnPrepare, const RunFn& fnRun) {
+		Result res;
+		res.corpus = c.name;
+		res.mode = mode;
+		res.lines = c.lines.size();
+		res.ns = std::numeric_limits<qint64>::max();
+		ResetPeakMemory();
+		fnPrepare();
+		res.tokens = fnRun();
+		uint64_t nAlloc = 0,
+				nMatch = 0;
+		QElapsedTimer timer;
+		for(int i=0 ; i<nRepeat ; i++) {
+			fnPrepare();
+			const uint64_t a0 = AllocationCount(),
+							m0 = glsl::RegexSet::MatchCount();
+			timer.start();
+			fnRun();
+			const qint64 ns = timer.nsecsElapsed();
+			nAlloc += AllocationCount() - a0;
+			nMatch += glsl::RegexSet::MatchCount() - m0;
+			res.ns = std::min(res.ns, ns);
+		}
+		const double nLine = double(nRepeat) * std::max(res.lines, 1);
+		res.allocPerLine = nAlloc / nLine;
+		res.regexPerLine = nMatch / nLine;
+		res.peakBytes = PeakMemory();
+		return res;
+	}
+	//! LineHighlighterでQStringの行を1行ずつ処理する (SpanVは使い回す)
+	Result RunLine(const Corpus& c, const glsl::LineHighlighter& line, int nRepeat) {
+		glsl::LineHighlighter::SpanV span;
+		return Measure(c, "line", nRepeat, [](){}, [&](){
+			qint64 n = 0;
+			int state = 0;
+			for(auto& text : c.lines) {
+				span.clear();
+				state = line.highlight(text, state, span);
+				n += span.size();
+			}
+			return n;
+		});
+	}
+	//! UTF-8のバッファをコピーせずに纏めて処理する
+	Result RunUtf8(const Corpus& c, const glsl::LineHighlighter& line, int nRepeat) {
+		glsl::TokenSpanV span;
+		const glsl::U8View view(c.utf8.constData(), c.utf8.size());
+		return Measure(c, "utf8", nRepeat, [&span](){ span.clear(); }, [&](){
+			line.tokenizer().utf8().tokenizeBuffer(view, 0, span);
+			return qint64(span.size());
+		});
+	}
+	//! QTextDocumentにSyntaxHighlighterを付けて全体をハイライトする (書式の設定まで含む)
+	Result RunDocument(const Corpus& c, const glsl::SPRuleSet& rules, int nRepeat) {
+		const QString text = c.lines.join('\n');
+		std::unique_ptr<QTextDocument> doc;
+		Result res = Measure(c, "document", nRepeat, [&](){
+			// ハイライターは文書と一緒に破棄される
+			doc.reset(new QTextDocument());
+			doc->setPlainText(text);
+		}, [&](){
+			auto* hl = new glsl::SyntaxHighlighter(doc.get());
+			hl->setRuleSet(rules);
+			return qint64(-1);
+		});
+		return res;
+	}
+
+	bool WriteFile(const QString& path, const QByteArray& data) {
+		QFile file(path);
+		return file.open(QFile::WriteOnly | QFile::Truncate) && file.write(data) == data.size();
+	}
+
+	// ---------------- 行毎の確保回数の検査 ----------------
+	//! 正規表現キーワードを除いたルールセットを読み込む
+	/*! \param[in] tmp	除いたdefsを置くディレクトリ */
+	glsl::SPRuleSet LoadStringRules(const QString& rulesDir, const QTemporaryDir& tmp) {
+		QDir dir(rulesDir + "/defs");
+		for(auto& f : dir.entryList(QStringList() << "*.json", QDir::Files, QDir::Name)) {
+			QFile file(dir.filePath(f));
+			if(!file.open(QFile::ReadOnly))
+				throw std::runtime_error("can't read " + file.fileName().toStdString());
+			const QByteArray data = file.readAll();
+			if(QJsonDocument::fromJson(data).object().value("type").toString("string") == "regex")
+				continue;
+			if(!WriteFile(tmp.path() + "/" + f, data))
+				throw std::runtime_error("can't write " + tmp.path().toStdString());
+		}
+		return glsl::RuleSet::Load(rulesDir + "/usercfg.json", tmp.path(), rulesDir + "/block.json");
+	}
+	//! QRegularExpressionの1回の評価で確保する回数 (一致した場合。一致しなければこれより少ない)
+	double MatchAllocation() {
+		const QRegularExpression re("[a-z]+", QRegularExpression::UseUnicodePropertiesOption);
+		re.optimize();
+		const QString text("float");
+		// JITのスタックなど初回だけ確保する物を除く
+		re.match(text, 0, QRegularExpression::NormalMatch, QRegularExpression::AnchoredMatchOption);
+		const int n = 1000;
+		const uint64_t a0 = AllocationCount();
+		for(int i=0 ; i<n ; i++)
+			re.match(text, 0, QRegularExpression::NormalMatch, QRegularExpression::AnchoredMatchOption);
+		return double(AllocationCount() - a0) / n;
+	}
+	/*! 全コーパスをline, utf8方式で処理し、空回しの後の確保を報告する。
+		文字列キーワードだけのルールセット(strLine)では1度でも確保が起きたら、
+		全てのルールセット(line)ではQRegularExpressionの評価回数から見込める分を超えて確保したら失敗とする
+		\param[in] perMatch	MatchAllocation()の値
+		\return 失敗した計測の数 */
+	int CheckAllocation(const CorpusV& corpus, const glsl::LineHighlighter& strLine, const glsl::LineHighlighter& line,
+						double perMatch, int nRepeat) {
+		std::printf("\nallocations per line (string keyword rules)\n");
+		int nBad = 0;
+		for(auto& c : corpus) {
+			for(auto& r : {RunLine(c, strLine, nRepeat), RunUtf8(c, strLine, nRepeat)}) {
+				const bool bBad = r.allocPerLine > 0;
+				std::printf("%-20s  alloc/line %9.4f  %s\n", qPrintable(r.key()), r.allocPerLine, bBad ? "ALLOCATES" : "ok");
+				if(bBad)
+					++nBad;
+			}
+		}
+		// 正規表現キーワードの分は評価回数で別に数える
+		std::printf("\nallocations per line (full rules, each QRegularExpression evaluation allocates up to %.1f)\n", perMatch);
+		for(auto& c : corpus) {
+			for(auto& r : {RunLine(c, line, nRepeat), RunUtf8(c, line, nRepeat)}) {
+				const double other = r.allocPerLine - r.regexPerLine * perMatch;
+				// 割り算の誤差で僅かに正になるのは無視する
+				const bool bBad = other > 1e-9;
+				std::printf("%-20s  alloc/line %9.4f  regex/line %9.4f  other %9.4f  %s\n", qPrintable(r.key()),
+							r.allocPerLine, r.regexPerLine, std::max(other, 0.0), bBad ? "ALLOCATES" : "ok");
+				if(bBad)
+					++nBad;
+			}
+		}
+		return nBad;
+	}
+	/*! SyntaxHighlighterでは書式の設定にQtが確保するので、覚えた結果を適用し直すだけの回(rehighlight)と
+		全ブロックを字句解析し直す回(同じルールセットを設定し直す)を比べ、
+		字句解析の分でQRegularExpressionの評価回数から見込める以上に確保が増えた物を報告する
+		\return 確保が増えた計測の数 */
+	int CheckDocumentAllocation(const CorpusV& corpus, const glsl::SPRuleSet& rules, double perMatch, int nRepeat) {
+		std::printf("\nallocations per line in document mode (tokenize - apply memo)\n");
+		int nBad = 0;
+		for(auto& c : corpus) {
+			QTextDocument doc;
+			doc.setPlainText(c.lines.join('\n'));
+			auto* hl = new glsl::SyntaxHighlighter(&doc);
+			hl->setRuleSet(rules);
+			const Result	tokenize = Measure(c, "document", nRepeat, [](){}, [&](){
+								hl->setRuleSet(rules);
+								return qint64(-1);
+							}),
+							memo = Measure(c, "document", nRepeat, [](){}, [&](){
+								hl->rehighlight();
+								return qint64(-1);
+							});
+			const double diff = tokenize.allocPerLine - memo.allocPerLine,
+						other = diff - (tokenize.regexPerLine - memo.regexPerLine) * perMatch;
+			const bool bBad = other > 1e-9;
+			std::printf("%-20s  alloc/line %9.4f - %9.4f = %9.4f  regex/line %9.4f  other %9.4f  %s\n", qPrintable(tokenize.key()),
+						tokenize.allocPerLine, memo.allocPerLine, diff, tokenize.regexPerLine, std::max(other, 0.0),
+						bBad ? "ALLOCATES" : "ok");
+			if(bBad)
+				++nBad;
+		}
+		return nBad;
+	}
+
+	// ---------------- 正規表現キーワードの従来方式との比較 ----------------
+	using StrV = std::vector<QString>;
+	struct LegacyRegex {
+		QRegExp	re;
+		bool	bAutoSpacing;
+	};
+	using LegacyV = std::vector<LegacyRegex>;
+	//! defs以下の正規表現キーワードを従来方式と結合方式の両方に読み込む
+	void LoadRegexDefs(const QString& path, LegacyV& legacy, glsl::RegexSet& set) {
+		QDir dir(path);
+		QStringList files = dir.entryList(QStringList() << "*.json", QDir::Files, QDir::Name);
+		int category = 0;
+		for(auto& f : files) {
+			QFile file(dir.filePath(f));
+			if(!file.open(QFile::ReadOnly))
+				continue;
+			QJsonObject o = QJsonDocument::fromJson(file.readAll()).object();
+			if(o.value("type").toString("string") == "regex") {
+				bool bCase = o.value("case_sensitive").toBool(false),
+					bSpace = o.value("auto_spacing").toBool(false);
+				for(const auto& w : o.value("words").toArray()) {
+					QString word = w.toString();
+					if(word.isEmpty())
+						continue;
+					legacy.push_back(LegacyRegex{QRegExp(word, bCase ? Qt::CaseSensitive : Qt::CaseInsensitive), bSpace});
+					set.add(word, category, bCase, bSpace);
+				}
+			}
+			++category;
+		}
+		set.build();
+	}
+	//! 従来方式: トークン毎に各パターンを行末まで検索し、最も手前の一致を取る
+	int RunLegacy(const QStringList& lines, LegacyV& legacy) {
+		QRegExp keyword("[\\w\\.]+");
+		int hits = 0;
+		for(auto& text : lines) {
+			int cursor = 0;
+			for(;;) {
+				int ofs = text.indexOf(keyword, cursor);
+				if(ofs < 0)
+					break;
+				int best = std::numeric_limits<int>::max();
+				for(auto& l : legacy) {
+					int idx = text.indexOf(l.re, ofs);
+					if(idx < 0)
+						continue;
+					int len = l.re.matchedLength();
+					if(l.bAutoSpacing) {
+						if((idx + len < text.length() && text.at(idx+len).isLetterOrNumber()) ||
+							(idx > 0 && text.at(idx-1).isLetterOrNumber()))
+							continue;
+					}
+					best = std::min(best, idx);
+				}
+				if(best != std::numeric_limits<int>::max())
+					++hits;
+				cursor = ofs + keyword.matchedLength();
+			}
+		}
+		return hits;
+	}
+	//! 結合方式: トークン毎に結合済み正規表現で一度だけ検索
+	int RunCombined(const QStringList& lines, const glsl::RegexSet& set) {
+		QRegExp keyword("[\\w\\.]+");
+		int hits = 0;
+		for(auto& text : lines) {
+			int cursor = 0;
+			for(;;) {
+				int ofs = text.indexOf(keyword, cursor);
+				if(ofs < 0)
+					break;
+				if(set.find(text, ofs).offset >= 0)
+					++hits;
+				cursor = ofs + keyword.matchedLength();
+			}
+		}
+		return hits;
+	}
+	void CompareRegex(const QString& defs, const QStringList& lines) {
+		LegacyV legacy;
+		glsl::RegexSet set;
+		LoadRegexDefs(defs, legacy, set);
+		QElapsedTimer timer;
+		timer.start();
+		const int hitL = RunLegacy(lines, legacy);
+		const qint64 nsL = timer.nsecsElapsed();
+		timer.restart();
+		const int hitC = RunCombined(lines, set);
+		const qint64 nsC = timer.nsecsElapsed();
+		const double n = lines.size();
+		std::printf("\nkeyword regex: %d lines, %d patterns\n", lines.size(), int(legacy.size()));
+		std::printf("legacy   (QRegExp per pattern) : %10.1f ns/line  (%d hits)\n", nsL / n, hitL);
+		std::printf("combined (QRegularExpression)  : %10.1f ns/line  (%d hits)\n", nsC / n, hitC);
+		std::printf("speedup: %.2fx\n", double(nsL) / std::max<qint64>(nsC, 1));
+	}
+
+	// ---------------- 結果の出力と比較 ----------------
+	void PrintResults(const ResultV& rv) {
+		std::printf("%-10s %-9s %8s %12s %10s %9s %10s %8s\n",
+					"corpus", "mode", "lines", "lines/s", "ns/line", "ns/token", "alloc/line", "peak MB");
+		for(auto& r : rv) {
+			std::printf("%-10s %-9s %8d %12.0f %10.1f %9.1f %10.2f %8.1f\n",
+						qPrintable(r.corpus), qPrintable(r.mode), r.lines, r.linesPerSec(),
+						r.nsPerLine(), r.nsPerToken(), r.allocPerLine,
+						r.peakBytes >= 0 ? r.peakBytes / (1024.0*1024.0) : -1.0);
+		}
+	}
+	QJsonDocument ToJson(const ResultV& rv) {
+		QJsonArray ar;
+		for(auto& r : rv) {
+			QJsonObject o;
+			o["corpus"] = r.corpus;
+			o["mode"] = r.mode;
+			o["lines"] = r.lines;
+			o["tokens"] = double(r.tokens);
+			o["ns_per_line"] = r.nsPerLine();
+			o["ns_per_token"] = r.nsPerToken();
+			o["lines_per_sec"] = r.linesPerSec();
+			o["alloc_per_line"] = r.allocPerLine;
+			o["peak_bytes"] = double(r.peakBytes);
+			ar.append(o);
+		}
+		QJsonObject root;
+		root["version"] = 1;
+		root["results"] = ar;
+		return QJsonDocument(root);
+	}
+	/*! 基準より時間か確保回数がtolerance(割合)を超えて増えた物を報告する
+		\return 悪化した項目の数 */
+	int CompareBaseline(const ResultV& rv, const QJsonDocument& base, double tolerance) {
+		QHash<QString, QJsonObject> map;
+		for(const auto& v : base.object().value("results").toArray()) {
+			const QJsonObject o = v.toObject();
+			map.insert(o.value("corpus").toString() + "/" + o.value("mode").toString(), o);
+		}
+		std::printf("\ncompared with baseline (tolerance %.0f%%)\n", tolerance * 100);
+		int nBad = 0;
+		for(auto& r : rv) {
+			auto itr = map.find(r.key());
+			if(itr == map.end()) {
+				std::printf("%-20s  (not in baseline)\n", qPrintable(r.key()));
+				continue;
+			}
+			const double	baseNs = itr->value("ns_per_line").toDouble(),
+							baseAlloc = itr->value("alloc_per_line").toDouble();
+			const double dNs = baseNs > 0 ? r.nsPerLine() / baseNs - 1.0 : 0;
+			// 確保回数は計測毎の揺れが無いので、端数の違いだけは許す
+			const bool	bSlow = dNs > tolerance,
+						bAlloc = r.allocPerLine > baseAlloc * (1.0 + tolerance) + 0.01;
+			std::printf("%-20s  ns/line %10.1f -> %10.1f (%+6.1f%%)  alloc/line %7.2f -> %7.2f  %s\n",
+						qPrintable(r.key()), baseNs, r.nsPerLine(), dNs * 100,
+						baseAlloc, r.allocPerLine,
+						(bSlow || bAlloc) ? "REGRESSION" : "ok");
+			if(bSlow || bAlloc)
+				++nBad;
+		}
+		return nBad;
+	}
+}
+/*! 使い方: hlbench [options] [シェーダーファイル...]
+	--rulesのusercfg.json, defs, block.jsonを読み込み、生成したコーパスと同梱のシェーダー(と指定したファイル)を
+	各方式でハイライトして行/秒, ns/トークン, 1行当たりの確保回数, ピークメモリを出力する。
+	終了コード: 0=正常, 1=基準より遅くなった(--check-allocでは1行でも確保が起きた), 2=引数やファイルのエラー */
+int main(int argc, char* argv[]) {
+	if(qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+		qputenv("QT_QPA_PLATFORM", "offscreen");
+	QGuiApplication app(argc, argv);
+	QCoreApplication::setApplicationName("hlbench");
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Measure the syntax highlighter on synthetic and bundled shader corpora.");
+	parser.addHelpOption();
+	QCommandLineOption	optRules("rules", "directory with usercfg.json, defs/ and block.json (default: current directory).", "dir", "."),
+						optCorpus("corpus", "directory of bundled shaders (default: <rules>/bench/hlbench/corpus).", "dir"),
+						optLines("lines", "lines per generated corpus.", "n", "20000"),
+						optRepeat("repeat", "timed runs per measurement (the fastest is reported).", "n", "5"),
+						optMode("mode", "comma separated modes: line, utf8, document.", "list", "line,utf8,document"),
+						optSave("save", "write the results to <file> as a baseline.", "file"),
+						optBase("baseline", "compare with a baseline written by --save and fail on slowdown.", "file"),
+						optTol("tolerance", "allowed slowdown against the baseline in percent.", "percent", "10"),
+						optLegacy("legacy", "also compare per-pattern QRegExp with the combined keyword regex."),
+						optAlloc("check-alloc", "fail if the line and utf8 modes allocate per line or the document mode allocates for tokenizing, apart from regex keyword evaluations."),
+						optSimd("simd", "instruction set of the UTF-16 scanner: scalar, sse2, avx2 (default: the fastest supported).", "level");
+	for(auto* o : {&optRules, &optCorpus, &optLines, &optRepeat, &optMode, &optSave, &optBase, &optTol, &optLegacy, &optAlloc, &optSimd})
+		parser.addOption(*o);
+	parser.addPositionalArgument("files", "additional shader files measured as the 'files' corpus.", "[files...]");
+	parser.process(app);
+
+	bool bLines, bRepeat, bTol;
+	const int nLines = parser.value(optLines).toInt(&bLines),
+			nRepeat = parser.value(optRepeat).toInt(&bRepeat);
+	const double tolerance = parser.value(optTol).toDouble(&bTol) / 100.0;
+	if(!bLines || nLines <= 0 || !bRepeat || nRepeat <= 0 || !bTol || tolerance < 0) {
+		std::fprintf(stderr, "hlbench: invalid numeric option\n");
+		return 2;
+	}
+	if(parser.isSet(optSimd)) {
+		int level = 0;
+		while(level < glsl::SimdLevel::_Num && parser.value(optSimd) != glsl::GetSimdLevelName(static_cast<glsl::SimdLevel::Type>(level)))
+			++level;
+		if(level == glsl::SimdLevel::_Num) {
+			std::fprintf(stderr, "hlbench: unknown simd level: %s\n", qPrintable(parser.value(optSimd)));
+			return 2;
+		}
+		glsl::SetSimdLevel(static_cast<glsl::SimdLevel::Type>(level));
+	}
+	std::printf("simd: %s (supported: %s)\n", glsl::GetSimdLevelName(glsl::GetSimdLevel()),
+				glsl::GetSimdLevelName(glsl::GetSupportedSimdLevel()));
+	const QStringList modes = parser.value(optMode).split(',', QString::SkipEmptyParts);
+	const QString rulesDir = parser.value(optRules);
+	try {
+		const glsl::SPRuleSet rules = glsl::RuleSet::Load(rulesDir + "/usercfg.json", rulesDir + "/defs", rulesDir + "/block.json");
+		const glsl::LineHighlighter line(rules);
+
+		CorpusV corpus;
+		corpus.push_back(MakeCorpus("long", MakeLongLines(std::max(1, nLines / 20))));
+		corpus.push_back(MakeCorpus("comment", MakeCommentLines(nLines)));
+		corpus.push_back(MakeCorpus("number", MakeNumberLines(nLines)));
+		corpus.push_back(MakeCorpus("mixed", MakeMixedLines(nLines)));
+		const QString corpusDir = parser.isSet(optCorpus) ? parser.value(optCorpus) : rulesDir + "/bench/hlbench/corpus";
+		const QStringList bundled = LoadLines(ListShaderFiles(corpusDir));
+		if(bundled.isEmpty())
+			std::fprintf(stderr, "hlbench: no bundled shaders in %s\n", qPrintable(corpusDir));
+		else
+			corpus.push_back(MakeCorpus("real", RepeatLines(bundled, nLines)));
+		if(!parser.positionalArguments().isEmpty()) {
+			const QStringList files = LoadLines(parser.positionalArguments());
+			if(files.isEmpty())
+				throw std::runtime_error("no lines in the given files");
+			corpus.push_back(MakeCorpus("files", files));
+		}
+
+		ResultV rv;
+		for(auto& c : corpus) {
+			qint64 tokens = -1;
+			for(auto& m : modes) {
+				Result r;
+				if(m == "line")
+					r = RunLine(c, line, nRepeat);
+				else if(m == "utf8")
+					r = RunUtf8(c, line, nRepeat);
+				else if(m == "document")
+					r = RunDocument(c, rules, nRepeat);
+				else
+					throw std::runtime_error("unknown mode: " + m.toStdString());
+				// 書式を設定するだけの方式は他の方式で数えたSpan数を使う
+				if(r.tokens < 0)
+					r.tokens = tokens;
+				else
+					tokens = r.tokens;
+				rv.push_back(r);
+			}
+		}
+		PrintResults(rv);
+		if(parser.isSet(optLegacy))
+			CompareRegex(rulesDir + "/defs", MakeMixedLines(nLines));
+		int nBad = 0;
+		if(parser.isSet(optAlloc)) {
+			QTemporaryDir tmp;
+			if(!tmp.isValid())
+				throw std::runtime_error("can't create a temporary directory");
+			const glsl::LineHighlighter strLine(LoadStringRules(rulesDir, tmp));
+			const double perMatch = MatchAllocation();
+			nBad += CheckAllocation(corpus, strLine, line, perMatch, nRepeat);
+			nBad += CheckDocumentAllocation(corpus, rules, perMatch, nRepeat);
+		}
+
+		if(parser.isSet(optSave) && !WriteFile(parser.value(optSave), ToJson(rv).toJson()))
+			throw std::runtime_error("can't write " + parser.value(optSave).toStdString());
+		if(parser.isSet(optBase)) {
+			QFile file(parser.value(optBase));
+			if(!file.open(QFile::ReadOnly))
+				throw std::runtime_error("can't read " + parser.value(optBase).toStdString());
+			QJsonParseError err;
+			const QJsonDocument base = QJsonDocument::fromJson(file.readAll(), &err);
+			if(err.error != QJsonParseError::NoError)
+				throw std::runtime_error(err.errorString().toStdString());
+			nBad += CompareBaseline(rv, base, tolerance);
+		}
+		return nBad > 0 ? 1 : 0;
+	} catch(const std::exception& e) {
+		std::fprintf(stderr, "hlbench: %s\n", e.what());
+		return 2;
+	}
+}
@@ -0,0 +1,90 @@
+// 標準ライブラリのヘッダはmallocの宣言と食い違わないよう最小限にする
+#include "memstat.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#if defined(__linux__)
+	#include <features.h>
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+	#include <sys/resource.h>
+#endif
+
+namespace {
+	std::atomic<uint64_t>	g_nAlloc(0);
+}
+#if defined(__GLIBC__)
+extern "C" {
+	void* __libc_malloc(size_t n);
+	void* __libc_calloc(size_t n, size_t size);
+	void* __libc_realloc(void* p, size_t n);
+	void __libc_free(void* p);
+
+	void* malloc(size_t n) __THROW {
+		g_nAlloc.fetch_add(1, std::memory_order_relaxed);
+		return __libc_malloc(n);
+	}
+	void* calloc(size_t n, size_t size) __THROW {
+		g_nAlloc.fetch_add(1, std::memory_order_relaxed);
+		return __libc_calloc(n, size);
+	}
+	void* realloc(void* p, size_t n) __THROW {
+		g_nAlloc.fetch_add(1, std::memory_order_relaxed);
+		return __libc_realloc(p, n);
+	}
+	void free(void* p) __THROW {
+		__libc_free(p);
+	}
+}
+#else
+#include <cstdlib>
+#include <new>
+void* operator new(std::size_t n) {
+	g_nAlloc.fetch_add(1, std::memory_order_relaxed);
+	if(void* p = std::malloc(n ? n : 1))
+		return p;
+	throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+#endif
+
+uint64_t AllocationCount() {
+	return g_nAlloc.load(std::memory_order_relaxed);
+}
+void ResetPeakMemory() {
+#if defined(__linux__)
+	// VmHWMを現在のRSSに戻す (Linux 4.0以降)
+	if(FILE* f = std::fopen("/proc/self/clear_refs", "w")) {
+		std::fputs("5", f);
+		std::fclose(f);
+	}
+#endif
+}
+int64_t PeakMemory() {
+#if defined(__linux__)
+	if(FILE* f = std::fopen("/proc/self/status", "r")) {
+		char line[256];
+		long long kb = -1;
+		while(std::fgets(line, sizeof(line), f)) {
+			if(std::sscanf(line, "VmHWM: %lld kB", &kb) == 1)
+				break;
+		}
+		std::fclose(f);
+		if(kb >= 0)
+			return kb * 1024;
+	}
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+	rusage ru;
+	if(getrusage(RUSAGE_SELF, &ru) == 0) {
+	#if defined(__APPLE__)
+		return ru.ru_maxrss;
+	#else
+		return int64_t(ru.ru_maxrss) * 1024;
+	#endif
+	}
+#endif
+	return -1;
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include <cstdint>
+
+// 計測用のメモリ統計
+// glibc環境ではmalloc系を、それ以外ではoperator newを置き換えて確保回数を数える
+// (後者ではQtのコンテナがmallocで確保する分は数えられない)
+
+//! プロセス開始からのメモリ確保回数
+uint64_t AllocationCount();
+//! ピークRSSを現在の値に戻す (Linux以外では何もしない)
+void ResetPeakMemory();
+//! ピークRSS (byte, 取得できなければ負数)
+int64_t PeakMemory();
@@ -0,0 +1,207 @@
+#include "batchchecker.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QSet>
+#include <algorithm>
+#include <numeric>
+
+bool ReadShaderSource(const QString& path, QString& dst) {
+	QFile file(path);
+	if(!file.open(QFile::ReadOnly))
+		return false;
+	dst = QString::fromUtf8(file.readAll());
+	return true;
+}
+bool ReadProgramSource(const ProgramFiles& files, glsl::ProgramSource& dst, QString& err) {
+	for(int i=0 ; i<glsl::Shader::_Num ; i++) {
+		auto& path = files.path[i];
+		if(path.isEmpty())
+			continue;
+		if(!ReadShaderSource(path, dst.source[i])) {
+			err = QString("can't open file %1").arg(path);
+			return false;
+		}
+	}
+	return true;
+}
+BatchChecker::BatchChecker(int nJobs, const QSurfaceFormat& fmt) {
+	if(nJobs != 1)
+		_pool.reset(new glsl::CompilePool(nJobs, fmt));
+}
+BatchChecker::~BatchChecker() {}
+void BatchChecker::setCache(glsl::CompileCache* cache) {
+	_compiler.setCache(cache);
+	if(_pool)
+		_pool->setCache(cache);
+}
+void BatchChecker::setIncludePaths(const QStringList& paths) {
+	_pp.setSearchPaths(paths);
+}
+const glsl::IncludeGraph& BatchChecker::includeGraph() const {
+	return _pp.graph();
+}
+void BatchChecker::invalidate(const QString& path) {
+	_pp.invalidate(path);
+}
+void BatchChecker::setAxes(const glsl::AxisV& axes) {
+	_axes = axes;
+}
+QStringList BatchChecker::_includes(const ProgramFiles& files) const {
+	QSet<QString> inc;
+	for(auto& path : files.path) {
+		if(!path.isEmpty()) {
+			for(auto& f : _pp.graph().includes(QFileInfo(path).canonicalFilePath()))
+				inc.insert(f);
+		}
+	}
+	QStringList ret = inc.toList();
+	ret.sort();
+	return ret;
+}
+glsl::CompilePool::ResultV BatchChecker::_compileAll(const glsl::CompilePool::SourceV& src) {
+	if(_pool) {
+		// ステージはワーカー毎に使い回すので、同じステージを使うプログラムが
+		// 同じワーカーの範囲に入るようステージのソースで並べてから渡す
+		using HashV = std::vector<uint>;
+		std::vector<HashV> hash(src.size(), HashV(glsl::Shader::_Num));
+		for(size_t i=0 ; i<src.size() ; i++) {
+			for(int k=0 ; k<glsl::Shader::_Num ; k++)
+				hash[i][k] = qHash(src[i].source[k]);
+		}
+		std::vector<int> order(src.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&hash](int a, int b){
+			return hash[a] < hash[b];
+		});
+		glsl::CompilePool::SourceV sorted;
+		sorted.reserve(src.size());
+		for(int idx : order)
+			sorted.push_back(src[idx]);
+		glsl::CompilePool::ResultV res = _pool->compileAll(sorted);
+		glsl::CompilePool::ResultV ret(src.size());
+		for(size_t i=0 ; i<order.size() ; i++)
+			ret[order[i]] = std::move(res[i]);
+		return ret;
+	}
+	glsl::CompilePool::ResultV ret;
+	ret.reserve(src.size());
+	for(auto& s : src)
+		ret.push_back(_compiler.compile(s));
+	return ret;
+}
+ProgramReport BatchChecker::check(const ProgramFiles& files) {
+	return checkAll(ProgramFilesV(1, files)).front();
+}
+ProgramReportV BatchChecker::checkAll(const ProgramFilesV& v, const glsl::CompilePool::SourceV* text) {
+	const glsl::DefineVV comb = glsl::ExpandAxes(_axes);
+	QSet<QString> known;
+	for(auto& ax : _axes)
+		known.insert(ax.name);
+
+	ProgramReportV ret;
+	ret.reserve(v.size());
+	// 前処理の結果が同じソースは1つにまとめる
+	glsl::CompilePool::SourceV src;
+	QHash<QByteArray, int> unique;
+	// プログラム毎、組み合わせ毎のsrcのインデックス (読み込めなかったプログラムは空)
+	std::vector<std::vector<int>> job(v.size());
+	// jobと同じ並びの前処理時間
+	std::vector<std::vector<glsl::Timing>> pre(v.size());
+	// jobと同じ並びのソース文字列番号に対応するファイル名
+	// (まとめたソースは番号のままのログでコンパイルし、組み合わせ毎に置き換える)
+	std::vector<std::vector<QStringList>> files(v.size());
+	for(size_t i=0 ; i<v.size() ; i++) {
+		ret.push_back(ProgramReport{v[i], QStringList(), glsl::CompileResult(), VariantReportV()});
+		ProgramReport& rep = ret.back();
+		glsl::ProgramSource raw;
+		if(text)
+			raw = (*text)[i];
+		else if(!ReadProgramSource(rep.files, raw, rep.result.log))
+			continue;
+		for(auto& def : comb) {
+			glsl::ProgramSource ps = raw;
+			pre[i].push_back(glsl::Timing());
+			{
+				glsl::ScopedTiming st(pre[i].back(), glsl::Phase::Preprocess);
+				_pp.setPrologue(glsl::MakePrologue(def));
+				_pp.expand(ps, rep.files.path);
+				if(!known.isEmpty()) {
+					for(auto& s : ps.source) {
+						if(!s.isEmpty())
+							s = glsl::ResolveConditionals(s, known);
+					}
+				}
+			}
+			files[i].push_back(ps.files);
+			ps.files.clear();
+			const QByteArray key = glsl::HashSource(ps);
+			auto itr = unique.find(key);
+			if(itr == unique.end()) {
+				itr = unique.insert(key, static_cast<int>(src.size()));
+				src.push_back(std::move(ps));
+			}
+			job[i].push_back(itr.value());
+			if(!_axes.empty())
+				rep.variants.push_back(VariantReport{def, -1, glsl::CompileResult()});
+		}
+		rep.includes = _includes(rep.files);
+	}
+	_pp.setPrologue(QString());
+
+	const glsl::CompilePool::ResultV res = _compileAll(src);
+	// まとめたソースのコンパイル時間は最初に使った組み合わせにだけ付ける
+	std::vector<bool> claimed(src.size(), false);
+	auto fnResult = [&](int idx, const glsl::Timing& t, const QStringList& fl) -> glsl::CompileResult {
+		glsl::CompileResult r = res[idx];
+		if(!fl.isEmpty())
+			r.log = glsl::MapSourceLog(r.log, fl);
+		if(claimed[idx])
+			r.timing = glsl::Timing();
+		claimed[idx] = true;
+		r.timing += t;
+		_timing.add(r.timing);
+		return r;
+	};
+	for(size_t i=0 ; i<ret.size() ; i++) {
+		ProgramReport& rep = ret[i];
+		const auto& jv = job[i];
+		if(jv.empty())
+			continue;
+		if(_axes.empty()) {
+			rep.result = fnResult(jv[0], pre[i][0], files[i][0]);
+			continue;
+		}
+		glsl::CompileResult& all = rep.result;
+		all.bSuccess = all.bLinked = true;
+		QHash<int, int> first;
+		for(size_t k=0 ; k<jv.size() ; k++) {
+			VariantReport& var = rep.variants[k];
+			var.result = fnResult(jv[k], pre[i][k], files[i][k]);
+			all.timing += var.result.timing;
+			auto itr = first.find(jv[k]);
+			if(itr != first.end())
+				var.sameAs = itr.value();
+			else {
+				first.insert(jv[k], static_cast<int>(k));
+				if(!var.result.bSuccess)
+					all.log.append(QString("[%1]\n%2\n").arg(glsl::DefineString(var.defines)).arg(var.result.log));
+			}
+			all.bSuccess &= var.result.bSuccess;
+			all.bLinked &= var.result.bLinked;
+		}
+	}
+	return ret;
+}
+glsl::StageCache::Stat BatchChecker::stageStat() const {
+	glsl::StageCache::Stat ret = _compiler.stageStat();
+	if(_pool)
+		ret += _pool->stageStat();
+	return ret;
+}
+const glsl::TimingStat& BatchChecker::timingStat() const {
+	return _timing;
+}
+glsl::DriverInfo BatchChecker::driverInfo() {
+	return _compiler.driverInfo();
+}
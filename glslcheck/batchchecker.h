@@ -0,0 +1,78 @@
+#pragma once
+#include "compilepool.h"
+#include "permutation.h"
+#include "preprocessor.h"
+#include "shadertree.h"
+#include <memory>
+
+namespace glsl {
+	class CompileCache;
+}
+class QSurfaceFormat;
+//! マクロ定義の組み合わせ1つ分の検査結果
+struct VariantReport {
+	glsl::DefineV		defines;
+	int					sameAs;		//!< 前処理の結果が同じになった最初の組み合わせ (自身が最初なら-1)
+	glsl::CompileResult	result;
+};
+using VariantReportV = std::vector<VariantReport>;
+//! 1プログラム分の検査結果
+struct ProgramReport {
+	ProgramFiles		files;
+	QStringList			includes;	//!< インクルードしているファイル (間接的な物も含む)
+	//! 組み合わせがあれば、全て成功した時だけ成功 (ログは失敗した組み合わせの物, 時間は全ての組み合わせの合計)
+	glsl::CompileResult	result;
+	VariantReportV		variants;	//!< マクロの軸を指定した時の組み合わせ毎の結果
+};
+using ProgramReportV = std::vector<ProgramReport>;
+
+//! シェーダーファイルを読み込み、コンパイル・リンクする
+/*! 使用中は構築時と同じOpenGLコンテキストがカレントであること。
+	ソースは#includeを展開してからコンパイルする。
+	マクロの軸があれば、全ての組み合わせについて#defineを加えて条件分岐を解決し、
+	結果が同じになった物(プログラムを跨いでも)は1度だけコンパイルする。
+	同じソースのステージは各Compilerで1度だけコンパイルし、プログラム間で使い回す。
+	nJobsが2以上ならcheckAllはCompilePoolのワーカーで並列に処理する */
+class BatchChecker {
+	glsl::Compiler		_compiler;
+	glsl::Preprocessor	_pp;
+	glsl::AxisV			_axes;
+	glsl::TimingStat	_timing;
+	using UPPool = std::unique_ptr<glsl::CompilePool>;
+	UPPool				_pool;
+	//! プログラムが(間接的な物も含めて)インクルードしているファイル
+	QStringList _includes(const ProgramFiles& files) const;
+	//! 全てコンパイルし、srcと同じ順で結果を返す (プールがあれば並列)
+	glsl::CompilePool::ResultV _compileAll(const glsl::CompilePool::SourceV& src);
+	public:
+		/*! \param[in] nJobs	並列数 (1ならカレントのコンテキストのみ使用, 0以下なら論理コア数)
+			\param[in] fmt		ワーカーのコンテキストに要求するフォーマット */
+		BatchChecker(int nJobs, const QSurfaceFormat& fmt);
+		~BatchChecker();
+		//! コンパイル結果をキャッシュする (nullptrで無効, 所有はしない)
+		void setCache(glsl::CompileCache* cache);
+		//! <name>形式と、見つからなかった"name"形式のインクルードを探すディレクトリ
+		void setIncludePaths(const QStringList& paths);
+		//! インクルードの依存関係 (checkで読み込んだ物)
+		const glsl::IncludeGraph& includeGraph() const;
+		//! 変更されたファイルのキャッシュを捨てる
+		void invalidate(const QString& path);
+		//! マクロの軸 (空なら組み合わせを作らずにそのまま検査)
+		void setAxes(const glsl::AxisV& axes);
+		ProgramReport check(const ProgramFiles& files);
+		/*! \param[in] text	指定すればファイルを読まずにvと同じ並びのソースを検査する
+								(vのパスはインクルードを探す起点とログの名前にだけ使う) */
+		ProgramReportV checkAll(const ProgramFilesV& v, const glsl::CompilePool::SourceV* text = nullptr);
+		//! これまでのcheckAllで検査した組み合わせ毎の処理時間の集計
+		/*! 同じソースにまとめた組み合わせは、コンパイル時間を最初の1つだけに数える */
+		const glsl::TimingStat& timingStat() const;
+		//! 全Compilerのステージの使い回しの状況
+		glsl::StageCache::Stat stageStat() const;
+		glsl::DriverInfo driverInfo();
+};
+//! シェーダーファイルをUTF-8として読み込む
+/*! \return 読み込めなければfalse */
+bool ReadShaderSource(const QString& path, QString& dst);
+//! プログラムを構成する全ステージのファイルを読み込む
+/*! \return 読み込めなければfalse (errにエラー内容) */
+bool ReadProgramSource(const ProgramFiles& files, glsl::ProgramSource& dst, QString& err);
@@ -0,0 +1,35 @@
+#-------------------------------------------------
+#
+# Headless batch shader checker
+#
+#-------------------------------------------------
+
+QT       += core gui network concurrent
+
+TARGET = glslcheck
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../libtinyhl/
+QMAKE_LIBDIR += $$PWD/../build_lib
+LIBS += -ltinyhl
+SOURCES += main.cpp \
+	    batchchecker.cpp \
+	    report.cpp \
+	    server.cpp \
+	    shadertree.cpp \
+	    watcher.cpp
+HEADERS += batchchecker.h \
+	    report.h \
+	    server.h \
+	    shadertree.h \
+	    watcher.h
+
+QMAKE_CXXFLAGS += -std=c++11
+CONFIG(debug, debug|release) {
+    DEFINES += DEBUG _DEBUG
+}
+CONFIG(release, debug|release) {
+    DEFINES += NDEBUG
+}
@@ -0,0 +1,148 @@
+#include "batchchecker.h"
+#include "report.h"
+#include "server.h"
+#include "watcher.h"
+#include "offscreencontext.h"
+#include "compilecache.h"
+#include <QGuiApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QSaveFile>
+#include <cstdio>
+
+/*! 使い方: glslcheck [options] <path>...  又は  glslcheck [options] --serve <name>
+	pathに指定したファイルやディレクトリ以下のシェーダーを、拡張子を除いた名前が同じ物同士で
+	1つのプログラムとしてコンパイル・リンクし、結果をJSONで出力する。
+	--axisを指定すると、マクロの値の全ての組み合わせについて検査する。
+	工程毎の処理時間はレポートに載せ、--timingでヒストグラムを表示、--timing-statsで実行を跨いで集計する。
+	--watchを指定すると終了せずにファイルの変更を監視し、影響を受けるプログラムだけを検査し直す。
+	--serveを指定するとコンテキスト・ハイライト定義・キャッシュを保持したまま、ローカルソケットで要求を受け付け続ける (Serverを参照)。
+	終了コード: 0=全て成功, 1=失敗したプログラムがある, 2=引数やコンテキストのエラー */
+int main(int argc, char* argv[]) {
+	// ディスプレイの無いビルドサーバーでも動くよう、指定が無ければoffscreenプラットフォームを使う
+	if(qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+		qputenv("QT_QPA_PLATFORM", "offscreen");
+	QGuiApplication app(argc, argv);
+	QCoreApplication::setApplicationName("glslcheck");
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Compile and link GLSL shader trees without the GUI.");
+	parser.addHelpOption();
+	QCommandLineOption	optGL("gl", "request OpenGL <version> (e.g. 3.3).", "version"),
+						optCore("core", "request a core profile context."),
+						optJobs(QStringList() << "j" << "jobs", "compile on <n> worker contexts in parallel (0 = one per core).", "n", "1"),
+						optCache("cache", "keep compile results in <dir> (default: user cache directory).", "dir"),
+						optNoCache("no-cache", "always compile, don't read or write the result cache."),
+						optInclude(QStringList() << "I" << "include", "search <dir> for #include files (repeatable).", "dir"),
+						optAxis(QStringList() << "A" << "axis", "check every combination of macro values NAME=v1,v2,... (repeatable, an empty value leaves NAME undefined).", "axis"),
+						optTiming("timing", "print per-phase timing histograms to stderr."),
+						optTimingStats("timing-stats", "accumulate per-phase timings across runs in <file> (JSON).", "file"),
+						optWatch(QStringList() << "w" << "watch", "keep running and recheck programs affected by file changes."),
+						optDebounce("debounce", "in watch mode, wait <ms> after the last change before rechecking.", "ms", "20"),
+						optServe("serve", "keep running and answer JSON-lines requests on the local socket <name>.", "name"),
+						optRules("rules", "load highlight rules (usercfg.json, defs, block.json) for --serve from <dir> (default: application directory).", "dir"),
+						optOut(QStringList() << "o" << "output", "write the JSON report to <file> instead of stdout.", "file");
+	parser.addOption(optGL);
+	parser.addOption(optCore);
+	parser.addOption(optJobs);
+	parser.addOption(optCache);
+	parser.addOption(optNoCache);
+	parser.addOption(optInclude);
+	parser.addOption(optAxis);
+	parser.addOption(optTiming);
+	parser.addOption(optTimingStats);
+	parser.addOption(optWatch);
+	parser.addOption(optDebounce);
+	parser.addOption(optServe);
+	parser.addOption(optRules);
+	parser.addOption(optOut);
+	parser.addPositionalArgument("paths", "shader files or directories to check.", "<path>...");
+	parser.process(app);
+
+	const QStringList paths = parser.positionalArguments();
+	if(paths.isEmpty() && !parser.isSet(optServe)) {
+		std::fprintf(stderr, "%s", qPrintable(parser.helpText()));
+		return 2;
+	}
+	bool bJobs;
+	const int nJobs = parser.value(optJobs).toInt(&bJobs);
+	if(!bJobs || nJobs < 0) {
+		std::fprintf(stderr, "glslcheck: invalid job count: %s\n", qPrintable(parser.value(optJobs)));
+		return 2;
+	}
+	try {
+		const QSurfaceFormat fmt = glsl::MakeSurfaceFormat(parser.value(optGL), parser.isSet(optCore));
+		glsl::OffscreenContext ctx(fmt);
+		if(!ctx.makeCurrent())
+			throw std::runtime_error("can't make OpenGL context current");
+
+		BatchChecker checker(nJobs, fmt);
+		checker.setIncludePaths(parser.values(optInclude));
+		glsl::AxisV axes;
+		for(auto& a : parser.values(optAxis))
+			axes.push_back(glsl::ParseAxis(a));
+		checker.setAxes(axes);
+		std::unique_ptr<glsl::CompileCache> cache;
+		if(!parser.isSet(optNoCache)) {
+			cache.reset(new glsl::CompileCache(parser.isSet(optCache) ? parser.value(optCache) : glsl::CompileCache::DefaultPath()));
+			checker.setCache(cache.get());
+		}
+		if(parser.isSet(optServe)) {
+			Server server(checker, cache.get(), parser.isSet(optRules) ? parser.value(optRules) : QCoreApplication::applicationDirPath());
+			server.listen(parser.value(optServe));
+			std::fprintf(stderr, "listening on %s\n", qPrintable(server.fullServerName()));
+			return app.exec();
+		}
+		if(parser.isSet(optWatch)) {
+			bool bDebounce;
+			const int debounce = parser.value(optDebounce).toInt(&bDebounce);
+			if(!bDebounce || debounce < 0)
+				throw std::runtime_error("invalid debounce: " + parser.value(optDebounce).toStdString());
+			// レポートは出力先を指定した時だけ検査毎に書き出す
+			Watcher watcher(checker, cache.get(), stderr, parser.value(optOut), debounce);
+			watcher.start(paths);
+			return app.exec();
+		}
+		ProgramReportV rep = checker.checkAll(ScanShaderTree(paths));
+		glsl::CompileCache::Stat stat;
+		if(cache)
+			stat = cache->stat();
+		const glsl::StageCache::Stat stage = checker.stageStat();
+		QJsonDocument doc = MakeReport(rep, checker.driverInfo(), cache ? &stat : nullptr, &checker.timingStat(), &stage);
+		const int nFailed = PrintDiagnostics(stderr, rep);
+		if(parser.isSet(optTiming))
+			PrintTimingStat(stderr, checker.timingStat());
+		if(parser.isSet(optTimingStats)) {
+			// 読めなければ今回の分から集計し直す
+			glsl::TimingStat total;
+			QFile in(parser.value(optTimingStats));
+			if(in.open(QFile::ReadOnly)) {
+				if(!FromJson(QJsonDocument::fromJson(in.readAll()).object(), total))
+					total.clear();
+				in.close();
+			}
+			total += checker.timingStat();
+			QSaveFile sf(in.fileName());
+			if(!sf.open(QFile::WriteOnly))
+				throw std::runtime_error("can't open timing stats " + in.fileName().toStdString());
+			sf.write(QJsonDocument(ToJson(total)).toJson());
+			if(!sf.commit())
+				throw std::runtime_error("can't write timing stats " + in.fileName().toStdString());
+		}
+
+		QFile out;
+		bool bOpen;
+		if(parser.isSet(optOut)) {
+			out.setFileName(parser.value(optOut));
+			bOpen = out.open(QFile::WriteOnly | QFile::Truncate);
+		} else
+			bOpen = out.open(stdout, QFile::WriteOnly);
+		if(!bOpen)
+			throw std::runtime_error("can't open output " + out.fileName().toStdString());
+		out.write(doc.toJson());
+		return nFailed > 0 ? 1 : 0;
+	} catch(const std::exception& e) {
+		std::fprintf(stderr, "glslcheck: %s\n", e.what());
+		return 2;
+	}
+}
@@ -0,0 +1,296 @@
+#include "report.h"
+#include <QJsonArray>
+#include <algorithm>
+
+namespace {
+	const char* c_stageKey[glsl::Shader::_Num] = {
+		"vertex",
+		"fragment",
+		"geometry",
+		"tess_control",
+		"tess_evaluation",
+		"compute"
+	};
+	QJsonArray ToJson(const glsl::VariableV& v) {
+		QJsonArray ar;
+		for(auto& a : v)
+			ar.append(::ToJson(a));
+		return ar;
+	}
+	QJsonArray ToJson(const glsl::BlockV& v) {
+		QJsonArray ar;
+		for(auto& b : v)
+			ar.append(::ToJson(b));
+		return ar;
+	}
+	//! summaryに載せる遅いプログラムの数
+	const size_t c_nSlowest = 10;
+	//! ヒストグラムの棒の最大長
+	const int c_histWidth = 40;
+	double ToMsec(qint64 nsec) {
+		return nsec / 1e6;
+	}
+	qint64 FromMsec(const QJsonValue& v) {
+		return qRound64(v.toDouble() * 1e6);
+	}
+	//! 最も時間が掛かった工程
+	glsl::Phase::Type SlowestPhase(const glsl::Timing& t) {
+		return static_cast<glsl::Phase::Type>(std::max_element(t.nsec, t.nsec+glsl::Phase::_Num) - t.nsec);
+	}
+	//! 区間の表示 ("64us", "1.0ms"など)
+	QString DurationString(qint64 nsec) {
+		if(nsec < 1000*1000)
+			return QString("%1us").arg(nsec / 1000);
+		return QString("%1ms").arg(nsec / 1e6, 0, 'f', 1);
+	}
+}
+const char* GetStageKey(glsl::Shader::Type type) {
+	return c_stageKey[type];
+}
+QJsonObject ToJson(const glsl::Variable& v) {
+	QJsonObject o;
+	o["name"] = v.name;
+	const glsl::ValueType* type = glsl::GetValueType(v.type);
+	// 表に無い型は数値で出す
+	o["type"] = type ? QString(type->name) : QString("0x%1").arg(v.type, 4, 16, QChar('0'));
+	if(type)
+		o["glsl_type"] = QString(type->glslName);
+	o["size"] = v.size;
+	o["location"] = v.location;
+	if(v.block >= 0) {
+		o["block"] = v.block;
+		o["offset"] = v.offset;
+	}
+	return o;
+}
+QJsonObject ToJson(const glsl::Block& b) {
+	QJsonObject o;
+	o["name"] = b.name;
+	o["binding"] = b.binding;
+	o["data_size"] = b.dataSize;
+	o["variables"] = b.nVariable;
+	return o;
+}
+QJsonObject ToJson(const glsl::Reflection& r) {
+	QJsonObject o;
+	o["attributes"] = ToJson(r.attribute);
+	o["uniforms"] = ToJson(r.uniform);
+	o["uniform_blocks"] = ToJson(r.uniformBlock);
+	o["storage_blocks"] = ToJson(r.storageBlock);
+	o["buffer_variables"] = ToJson(r.bufferVariable);
+	return o;
+}
+QJsonObject ToJson(const glsl::DriverInfo& d) {
+	QJsonObject o;
+	o["vendor"] = d.vendor;
+	o["renderer"] = d.renderer;
+	o["version"] = d.version;
+	return o;
+}
+QJsonObject ToJson(const VariantReport& v) {
+	QJsonObject o;
+	QJsonObject def;
+	for(auto& d : v.defines)
+		def[d.name] = d.value.isNull() ? QJsonValue() : QJsonValue(d.value);
+	o["defines"] = def;
+	if(v.sameAs >= 0)
+		o["same_as"] = v.sameAs;
+	o["success"] = v.result.bSuccess;
+	o["linked"] = v.result.bLinked;
+	o["log"] = v.result.log;
+	o["timing"] = ToJson(v.result.timing);
+	const QJsonObject ref = ToJson(v.result.reflection);
+	for(auto itr = ref.begin() ; itr != ref.end() ; ++itr)
+		o[itr.key()] = itr.value();
+	return o;
+}
+QJsonObject ToJson(const ProgramReport& r) {
+	QJsonObject o;
+	o["name"] = r.files.name;
+	QJsonObject files;
+	for(int i=0 ; i<glsl::Shader::_Num ; i++) {
+		if(!r.files.path[i].isEmpty())
+			files[GetStageKey(static_cast<glsl::Shader::Type>(i))] = r.files.path[i];
+	}
+	o["files"] = files;
+	o["includes"] = QJsonArray::fromStringList(r.includes);
+	o["success"] = r.result.bSuccess;
+	o["linked"] = r.result.bLinked;
+	o["log"] = r.result.log;
+	o["timing"] = ToJson(r.result.timing);
+	const QJsonObject ref = ToJson(r.result.reflection);
+	for(auto itr = ref.begin() ; itr != ref.end() ; ++itr)
+		o[itr.key()] = itr.value();
+	if(!r.variants.empty()) {
+		QJsonArray ar;
+		for(auto& v : r.variants)
+			ar.append(ToJson(v));
+		o["variants"] = ar;
+	}
+	return o;
+}
+QJsonObject ToJson(const glsl::CompileCache::Stat& s) {
+	QJsonObject o;
+	// JSONの数値はdoubleなので大きな値も表せる
+	o["hits"] = double(s.hit);
+	o["misses"] = double(s.miss);
+	o["rejected_binaries"] = double(s.rejected);
+	return o;
+}
+QJsonObject ToJson(const glsl::StageCache::Stat& s) {
+	QJsonObject o;
+	o["compiled"] = double(s.miss);
+	o["reused"] = double(s.hit);
+	return o;
+}
+QJsonObject ToJson(const glsl::Timing& t) {
+	QJsonObject o;
+	for(int i=0 ; i<glsl::Phase::_Num ; i++) {
+		if(t.nsec[i] > 0)
+			o[glsl::GetPhaseName(static_cast<glsl::Phase::Type>(i)) + "_ms"] = ToMsec(t.nsec[i]);
+	}
+	o["total_ms"] = ToMsec(t.total());
+	return o;
+}
+QJsonObject ToJson(const glsl::TimingStat& s) {
+	QJsonObject phases;
+	for(int i=0 ; i<glsl::Phase::_Num ; i++) {
+		const auto phase = static_cast<glsl::Phase::Type>(i);
+		const glsl::TimingStat::Entry& e = s.entry(phase);
+		if(e.count == 0)
+			continue;
+		QJsonObject o;
+		o["count"] = double(e.count);
+		o["total_ms"] = ToMsec(e.total);
+		o["mean_ms"] = ToMsec(e.total / qint64(e.count));
+		o["min_ms"] = ToMsec(e.min);
+		o["max_ms"] = ToMsec(e.max);
+		// 空の区間は省く
+		QJsonArray hist;
+		for(int k=0 ; k<glsl::TimingStat::NBucket ; k++) {
+			if(e.bucket[k] == 0)
+				continue;
+			QJsonObject b;
+			b["from_us"] = double(glsl::TimingStat::BucketFloor(k) / 1000);
+			b["count"] = double(e.bucket[k]);
+			hist.append(b);
+		}
+		o["histogram"] = hist;
+		phases[glsl::GetPhaseName(phase)] = o;
+	}
+	QJsonObject o;
+	o["runs"] = double(s.numRun());
+	o["phases"] = phases;
+	return o;
+}
+bool FromJson(const QJsonObject& o, glsl::TimingStat& dst) {
+	if(!o.contains("runs") || !o.value("phases").isObject())
+		return false;
+	dst.clear();
+	dst.setNumRun(quint64(o.value("runs").toDouble()));
+	const QJsonObject phases = o.value("phases").toObject();
+	for(int i=0 ; i<glsl::Phase::_Num ; i++) {
+		const auto phase = static_cast<glsl::Phase::Type>(i);
+		const QJsonObject p = phases.value(glsl::GetPhaseName(phase)).toObject();
+		if(p.isEmpty())
+			continue;
+		glsl::TimingStat::Entry& e = dst.entry(phase);
+		e.count = quint64(p.value("count").toDouble());
+		e.total = FromMsec(p.value("total_ms"));
+		e.min = FromMsec(p.value("min_ms"));
+		e.max = FromMsec(p.value("max_ms"));
+		for(auto b : p.value("histogram").toArray()) {
+			const QJsonObject bo = b.toObject();
+			const int k = glsl::TimingStat::BucketOf(qint64(bo.value("from_us").toDouble()) * 1000);
+			e.bucket[k] += quint64(bo.value("count").toDouble());
+		}
+	}
+	return true;
+}
+QJsonDocument MakeReport(const ProgramReportV& v, const glsl::DriverInfo& driver, const glsl::CompileCache::Stat* cache,
+							const glsl::TimingStat* timing, const glsl::StageCache::Stat* stage)
+{
+	QJsonArray progs;
+	int nFailed = 0,
+		nVariant = 0,
+		nUnique = 0;
+	for(auto& r : v) {
+		progs.append(ToJson(r));
+		if(!r.result.bSuccess)
+			++nFailed;
+		for(auto& var : r.variants) {
+			++nVariant;
+			if(var.sameAs < 0)
+				++nUnique;
+		}
+	}
+	QJsonObject summary;
+	summary["programs"] = int(v.size());
+	summary["failed"] = nFailed;
+	if(nVariant > 0) {
+		summary["variants"] = nVariant;
+		summary["unique_variants"] = nUnique;
+	}
+	if(cache)
+		summary["cache"] = ToJson(*cache);
+	if(timing)
+		summary["timing"] = ToJson(*timing);
+	if(stage)
+		summary["stages"] = ToJson(*stage);
+	{
+		// 時間の掛かったプログラムから順に一部だけ載せる
+		std::vector<const ProgramReport*> sorted;
+		for(auto& r : v)
+			sorted.push_back(&r);
+		const size_t nSlow = std::min<size_t>(sorted.size(), c_nSlowest);
+		std::partial_sort(sorted.begin(), sorted.begin()+nSlow, sorted.end(), [](const ProgramReport* a, const ProgramReport* b){
+			return a->result.timing.total() > b->result.timing.total();
+		});
+		QJsonArray slow;
+		for(size_t i=0 ; i<nSlow ; i++) {
+			const glsl::Timing& t = sorted[i]->result.timing;
+			QJsonObject o;
+			o["name"] = sorted[i]->files.name;
+			o["total_ms"] = ToMsec(t.total());
+			o["slowest_phase"] = glsl::GetPhaseName(SlowestPhase(t));
+			slow.append(o);
+		}
+		summary["slowest"] = slow;
+	}
+
+	QJsonObject root;
+	root["driver"] = ToJson(driver);
+	root["programs"] = progs;
+	root["summary"] = summary;
+	return QJsonDocument(root);
+}
+int PrintDiagnostics(FILE* fp, const ProgramReportV& v) {
+	int nFailed = 0;
+	for(auto& r : v) {
+		if(r.result.bSuccess)
+			continue;
+		++nFailed;
+		std::fprintf(fp, "%s: error\n%s\n", qPrintable(r.files.name), qPrintable(r.result.log));
+	}
+	return nFailed;
+}
+void PrintTimingStat(FILE* fp, const glsl::TimingStat& s) {
+	std::fprintf(fp, "timing over %llu checks:\n", static_cast<unsigned long long>(s.numRun()));
+	for(int i=0 ; i<glsl::Phase::_Num ; i++) {
+		const auto phase = static_cast<glsl::Phase::Type>(i);
+		const glsl::TimingStat::Entry& e = s.entry(phase);
+		if(e.count == 0)
+			continue;
+		std::fprintf(fp, "%s: n=%llu total=%.2fms mean=%.3fms min=%.3fms max=%.3fms\n",
+					qPrintable(glsl::GetPhaseName(phase)), static_cast<unsigned long long>(e.count),
+					ToMsec(e.total), ToMsec(e.total / qint64(e.count)), ToMsec(e.min), ToMsec(e.max));
+		const quint64 maxCount = *std::max_element(e.bucket, e.bucket+glsl::TimingStat::NBucket);
+		for(int k=0 ; k<glsl::TimingStat::NBucket ; k++) {
+			if(e.bucket[k] == 0)
+				continue;
+			const int nBar = std::max<int>(1, int(e.bucket[k] * c_histWidth / maxCount));
+			std::fprintf(fp, "  >= %8s %s %llu\n", qPrintable(DurationString(glsl::TimingStat::BucketFloor(k))),
+						qPrintable(QString(nBar, QChar('#'))), static_cast<unsigned long long>(e.bucket[k]));
+		}
+	}
+}
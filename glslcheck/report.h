@@ -0,0 +1,36 @@
+#pragma once
+#include "batchchecker.h"
+#include "compilecache.h"
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <cstdio>
+
+//! JSONでステージを表す名前 ("vertex", "tess_control"など)
+const char* GetStageKey(glsl::Shader::Type type);
+QJsonObject ToJson(const glsl::Variable& v);
+QJsonObject ToJson(const glsl::Block& b);
+QJsonObject ToJson(const glsl::Reflection& r);
+QJsonObject ToJson(const glsl::DriverInfo& d);
+QJsonObject ToJson(const VariantReport& v);
+QJsonObject ToJson(const ProgramReport& r);
+QJsonObject ToJson(const glsl::CompileCache::Stat& s);
+//! コンパイルしたステージ数と使い回したステージ数
+QJsonObject ToJson(const glsl::StageCache::Stat& s);
+//! 工程毎の時間 ("link_ms"など, 実行した工程のみ) と合計
+QJsonObject ToJson(const glsl::Timing& t);
+//! 工程毎の回数・合計・平均・最小・最大と、空でない区間のヒストグラム
+QJsonObject ToJson(const glsl::TimingStat& s);
+//! ToJson(TimingStat)の出力を読み込む
+/*! \return 形式が違えばfalse */
+bool FromJson(const QJsonObject& o, glsl::TimingStat& dst);
+//! 全プログラムの検査結果をJSONに纏める
+/*! \param[in] cache	キャッシュを使った場合はその利用状況 (使わなければnullptr)
+	\param[in] timing	処理時間の集計 (nullptrなら載せない)
+	\param[in] stage	ステージの使い回しの状況 (nullptrなら載せない) */
+QJsonDocument MakeReport(const ProgramReportV& v, const glsl::DriverInfo& driver, const glsl::CompileCache::Stat* cache = nullptr,
+							const glsl::TimingStat* timing = nullptr, const glsl::StageCache::Stat* stage = nullptr);
+//! 失敗したプログラムのログを人が読める形で出力
+/*! \return 失敗したプログラムの数 */
+int PrintDiagnostics(FILE* fp, const ProgramReportV& v);
+//! 工程毎の集計とヒストグラムを人が読める形で出力
+void PrintTimingStat(FILE* fp, const glsl::TimingStat& s);
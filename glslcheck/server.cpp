@@ -0,0 +1,243 @@
+#include "server.h"
+#include "report.h"
+#include "compilecache.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+
+namespace {
+	//! 改行が来ないまま溜められる要求の大きさ
+	const qint64 c_maxLine = 64*1024*1024;
+	//! 既存のソケットが生きているか確かめる時の待ち時間 (ms)
+	const int c_probeMs = 1000;
+	//! ステージ名 -> 種別 (見つからなければShader::_Num)
+	glsl::Shader::Type StageFromKey(const QString& key) {
+		for(int i=0 ; i<glsl::Shader::_Num ; i++) {
+			const auto type = static_cast<glsl::Shader::Type>(i);
+			if(key == GetStageKey(type))
+				return type;
+		}
+		return glsl::Shader::_Num;
+	}
+	QJsonObject Error(const QString& msg) {
+		QJsonObject e;
+		e["message"] = msg;
+		QJsonObject o;
+		o["error"] = e;
+		return o;
+	}
+	QJsonObject Result(const QJsonValue& v) {
+		QJsonObject o;
+		o["result"] = v;
+		return o;
+	}
+	//! params.files又はparams.sourcesから検査するプログラムを作る
+	/*! \return 形式が正しくなければ空でないエラー文 */
+	QString MakeProgram(const QJsonObject& params, ProgramFiles& files, glsl::ProgramSource& src) {
+		const bool bText = params.contains("sources");
+		const QJsonObject stage = params.value(bText ? "sources" : "files").toObject(),
+						paths = params.value("paths").toObject();
+		if(stage.isEmpty())
+			return "params.files or params.sources is required";
+		for(auto itr = stage.begin() ; itr != stage.end() ; ++itr) {
+			const glsl::Shader::Type type = StageFromKey(itr.key());
+			if(type == glsl::Shader::_Num)
+				return QString("unknown stage: %1").arg(itr.key());
+			if(!itr.value().isString())
+				return QString("stage %1 must be a string").arg(itr.key());
+			if(bText) {
+				src.source[type] = itr.value().toString();
+				files.path[type] = paths.value(itr.key()).toString();
+			} else
+				files.path[type] = itr.value().toString();
+		}
+		files.name = params.value("name").toString();
+		if(files.name.isEmpty()) {
+			for(auto& p : files.path) {
+				if(!p.isEmpty()) {
+					files.name = p;
+					break;
+				}
+			}
+		}
+		if(!bText) {
+			QString err;
+			if(!ReadProgramSource(files, src, err))
+				return err;
+		}
+		return QString();
+	}
+}
+Server::Server(BatchChecker& checker, glsl::CompileCache* cache, const QString& rulesDir, QObject* parent):
+	QObject(parent),
+	_checker(checker),
+	_cache(cache)
+{
+	// 起動時に読み込んでおき、要求毎には読まない
+	try {
+		glsl::SPRuleSet rules = glsl::RuleSet::LoadDir(rulesDir);
+		if(rules && rules->blockDef())
+			_highlighter.reset(new glsl::LineHighlighter(rules));
+	} catch(const std::exception& e) {
+		qWarning("can't load highlight rules from %s: %s", qPrintable(rulesDir), e.what());
+	}
+	connect(&_server, &QLocalServer::newConnection, this, &Server::_onNewConnection);
+}
+void Server::listen(const QString& name) {
+	// 要求でファイルを読ませられるので、他のユーザーからは接続させない
+	_server.setSocketOptions(QLocalServer::UserAccessOption);
+	if(!_server.listen(name) && _server.serverError() == QAbstractSocket::AddressInUseError) {
+		// 前回のソケットが残っているだけ(接続できない)なら消してやり直す
+		QLocalSocket probe;
+		probe.connectToServer(name);
+		if(probe.waitForConnected(c_probeMs))
+			throw std::runtime_error("another server is already listening on " + name.toStdString());
+		QLocalServer::removeServer(name);
+		_server.listen(name);
+	}
+	if(!_server.isListening())
+		throw std::runtime_error("can't listen on " + name.toStdString() + ": " + _server.errorString().toStdString());
+}
+QString Server::fullServerName() const {
+	return _server.fullServerName();
+}
+void Server::_onNewConnection() {
+	while(QLocalSocket* s = _server.nextPendingConnection()) {
+		connect(s, &QLocalSocket::readyRead, this, &Server::_onReadyRead);
+		connect(s, &QLocalSocket::disconnected, s, &QLocalSocket::deleteLater);
+	}
+}
+void Server::_onReadyRead() {
+	auto* s = qobject_cast<QLocalSocket*>(sender());
+	if(!s)
+		return;
+	while(s->canReadLine())
+		_push(s, s->readLine());
+	if(s->bytesAvailable() > c_maxLine) {
+		qWarning("request line too long, closing connection");
+		s->abort();
+	}
+}
+void Server::_push(QLocalSocket* socket, const QByteArray& line) {
+	if(line.trimmed().isEmpty())
+		return;
+	Request req;
+	req.socket = socket;
+	QJsonParseError err;
+	const QJsonDocument doc = QJsonDocument::fromJson(line, &err);
+	if(!doc.isObject())
+		req.response = Error(QString("invalid JSON: %1").arg(err.errorString()));
+	else {
+		const QJsonObject o = doc.object();
+		req.id = o.value("id");
+		req.method = o.value("method").toString();
+		req.params = o.value("params").toObject();
+	}
+	_queue.push_back(std::move(req));
+	_schedule();
+}
+void Server::_schedule() {
+	if(_bScheduled)
+		return;
+	_bScheduled = true;
+	// この周に届いた他の接続の要求も纏めて処理する
+	QMetaObject::invokeMethod(this, "_flush", Qt::QueuedConnection);
+}
+void Server::_flush() {
+	_bScheduled = false;
+	RequestQ q;
+	q.swap(_queue);
+
+	std::vector<Request*> check;
+	for(auto& r : q) {
+		if(!r.response.isEmpty() || !r.socket)
+			continue;
+		if(r.method == "compile" || r.method == "reflect")
+			check.push_back(&r);
+		else if(r.method == "tokenize")
+			r.response = _tokenize(r.params);
+		else if(r.method == "stats")
+			r.response = Result(_stats());
+		else
+			r.response = Error(QString("unknown method: %1").arg(r.method));
+	}
+	_check(check);
+	// 接続毎には要求と同じ順になる
+	for(auto& r : q) {
+		if(!r.socket)
+			continue;
+		QJsonObject o = r.response;
+		o["id"] = r.id;
+		r.socket->write(QJsonDocument(o).toJson(QJsonDocument::Compact));
+		r.socket->write("\n");
+	}
+	if(_cache)
+		_cache->flush();
+}
+void Server::_check(std::vector<Request*>& req) {
+	ProgramFilesV files;
+	glsl::CompilePool::SourceV src;
+	std::vector<Request*> valid;
+	for(auto* r : req) {
+		ProgramFiles pf;
+		glsl::ProgramSource ps;
+		const QString err = MakeProgram(r->params, pf, ps);
+		if(!err.isEmpty()) {
+			r->response = Error(err);
+			continue;
+		}
+		files.push_back(std::move(pf));
+		src.push_back(std::move(ps));
+		valid.push_back(r);
+	}
+	if(valid.empty())
+		return;
+	const ProgramReportV rep = _checker.checkAll(files, &src);
+	for(size_t i=0 ; i<valid.size() ; i++) {
+		QJsonObject o = ToJson(rep[i]);
+		if(valid[i]->method == "compile") {
+			const QJsonObject ref = ToJson(glsl::Reflection());
+			for(auto itr = ref.begin() ; itr != ref.end() ; ++itr)
+				o.remove(itr.key());
+		}
+		valid[i]->response = Result(o);
+	}
+}
+QJsonObject Server::_tokenize(const QJsonObject& params) const {
+	if(!_highlighter)
+		return Error("highlight rules are not loaded");
+	const QJsonValue text = params.value("text");
+	if(!text.isString())
+		return Error("params.text is required");
+	const QString str = text.toString();
+	glsl::TokenSpanV span;
+	glsl::U16Tokenizer::LineV line;
+	const int state = _highlighter->tokenizer().utf16().tokenizeBuffer(glsl::MakeView(str), 0, span, &line);
+	QJsonArray tokens;
+	for(size_t i=0 ; i<line.size() ; i++) {
+		const size_t end = (i+1 < line.size()) ? line[i+1].spanBegin : span.size();
+		for(size_t k=line[i].spanBegin ; k<end ; k++) {
+			QJsonArray t;
+			t.append(int(i));
+			t.append(int(span[k].offset - line[i].offset));
+			t.append(int(span[k].length));
+			t.append(span[k].kind);
+			tokens.append(t);
+		}
+	}
+	QJsonArray cat;
+	for(auto& c : _highlighter->ruleSet()->categories())
+		cat.append(QString::fromStdString(c.name));
+	QJsonObject o;
+	o["categories"] = cat;
+	o["tokens"] = tokens;
+	o["state"] = state;
+	return Result(o);
+}
+QJsonObject Server::_stats() const {
+	QJsonObject o;
+	if(_cache)
+		o["cache"] = ToJson(_cache->stat());
+	o["stages"] = ToJson(_checker.stageStat());
+	o["timing"] = ToJson(_checker.timingStat());
+	return o;
+}
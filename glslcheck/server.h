@@ -0,0 +1,69 @@
+#pragma once
+#include "batchchecker.h"
+#include "linehighlighter.h"
+#include <QObject>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QPointer>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <deque>
+#include <memory>
+
+namespace glsl {
+	class CompileCache;
+}
+//! ローカルソケット(Unixドメインソケット)で検査要求を受け付け続けるサーバー
+/*! 1行に1つのJSONを置くJSON-lines形式で、要求は{"id", "method", "params"}、
+	応答は{"id", "result"}又は{"id", "error": {"message"}}。
+	method:
+		compile		params.files(ステージ名 -> パス) 又は params.sources(ステージ名 -> テキスト)とparams.paths(任意)を検査し、
+					成否・ログ・処理時間を返す
+		reflect		compileに加えて変数情報も返す
+		tokenize	params.textをハイライト定義で分割し、[行, 列, 長さ, カテゴリ番号(-1はコメント)]の配列を返す
+		stats		キャッシュ・ステージ・処理時間の集計を返す
+	要求は応答を待たずに続けて送ってよく(パイプライン)、応答は接続毎に要求と同じ順で返す。
+	イベントループが1周する間に届いた要求は全ての接続の分を纏め、コンパイルはBatchCheckerのプールで並列に行う */
+class Server : public QObject {
+	Q_OBJECT
+	struct Request {
+		QPointer<QLocalSocket>	socket;
+		QJsonValue				id;
+		QString					method;
+		QJsonObject				params;
+		QJsonObject				response;	//!< 処理済みならresult又はerrorが入る
+	};
+	using RequestQ = std::deque<Request>;
+	using UPHighlighter = std::unique_ptr<glsl::LineHighlighter>;
+
+	BatchChecker&		_checker;
+	glsl::CompileCache*	_cache;
+	UPHighlighter		_highlighter;
+	QLocalServer		_server;
+	RequestQ			_queue;
+	bool				_bScheduled = false;	//!< _flushを予約したか
+
+	//! 受信した行を要求としてキューに積む
+	void _push(QLocalSocket* socket, const QByteArray& line);
+	void _schedule();
+	//! compile/reflectの要求を纏めて検査する
+	void _check(std::vector<Request*>& req);
+	QJsonObject _tokenize(const QJsonObject& params) const;
+	QJsonObject _stats() const;
+
+	private slots:
+		void _onNewConnection();
+		void _onReadyRead();
+		//! 溜まった要求を処理して応答を返す
+		void _flush();
+	public:
+		/*! \param[in] rulesDir	ハイライト定義(usercfg.json, defs, block.json)のディレクトリ (読めなければtokenizeはエラーを返す)
+			\param[in] cache	statsで利用状況を返し、処理毎にflushする (nullptrなら無し, 所有はしない) */
+		Server(BatchChecker& checker, glsl::CompileCache* cache, const QString& rulesDir, QObject* parent = nullptr);
+		//! nameで待ち受けを始める
+		/*! ソケットは同じユーザーからしか接続できない。
+			前回のソケットが残っていても接続できなければ消して使い、接続できれば(別のサーバーが動いている)エラーにする
+			\throw std::runtime_error 待ち受けられなかった */
+		void listen(const QString& name);
+		QString fullServerName() const;
+};
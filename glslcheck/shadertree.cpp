@@ -0,0 +1,40 @@
+#include "shadertree.h"
+#include <QDirIterator>
+#include <QFileInfo>
+#include <map>
+
+namespace {
+	using ProgramMap = std::map<QString, ProgramFiles>;
+	void AddFile(ProgramMap& m, const QFileInfo& fi) {
+		auto type = glsl::GetStageFromPath(fi.fileName());
+		if(type == glsl::Shader::_Num)
+			return;
+		// 拡張子だけが違うファイルを同じプログラムとみなす
+		QString name = fi.absolutePath() + '/' + fi.completeBaseName();
+		auto& ent = m[name];
+		ent.name = name;
+		ent.path[type] = fi.absoluteFilePath();
+	}
+}
+ProgramFilesV ScanShaderTree(const QStringList& paths, bool bRecursive) {
+	ProgramMap m;
+	QStringList filter;
+	for(int i=0 ; i<glsl::Shader::_Num ; i++)
+		filter << QString("*.") + glsl::GetStageExtension(static_cast<glsl::Shader::Type>(i));
+	for(auto& p : paths) {
+		QFileInfo fi(p);
+		if(fi.isDir()) {
+			QDirIterator itr(p, filter, QDir::Files | QDir::Readable, bRecursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags);
+			while(itr.hasNext()) {
+				itr.next();
+				AddFile(m, itr.fileInfo());
+			}
+		} else if(fi.isFile())
+			AddFile(m, fi);
+	}
+	ProgramFilesV ret;
+	ret.reserve(m.size());
+	for(auto& ent : m)
+		ret.push_back(std::move(ent.second));
+	return ret;
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include "glsl.h"
+#include <QString>
+#include <QStringList>
+#include <vector>
+
+//! 同じディレクトリ・同じベース名のシェーダーファイルを1つのプログラムとして纏めた物
+struct ProgramFiles {
+	QString		name;					//!< 拡張子を除いたパス
+	QString		path[glsl::Shader::_Num];	//!< ステージ毎のファイル (無ければ空)
+};
+using ProgramFilesV = std::vector<ProgramFiles>;
+//! 指定されたファイルやディレクトリ(再帰)からシェーダーファイルを集めて組にする
+/*! 結果は名前順
+	\param[in] bRecursive	falseならディレクトリの直下だけを見る */
+ProgramFilesV ScanShaderTree(const QStringList& paths, bool bRecursive = true);
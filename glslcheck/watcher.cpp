@@ -0,0 +1,222 @@
+#include "watcher.h"
+#include "report.h"
+#include "compilecache.h"
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QSaveFile>
+
+namespace {
+	//! プログラムが置かれているディレクトリ (名前は"ディレクトリ/ベース名")
+	QStringRef ProgramDir(const QString& name) {
+		return name.leftRef(name.lastIndexOf('/'));
+	}
+	bool SameFiles(const ProgramFiles& a, const ProgramFiles& b) {
+		for(int i=0 ; i<glsl::Shader::_Num ; i++) {
+			if(a.path[i] != b.path[i])
+				return false;
+		}
+		return true;
+	}
+}
+Watcher::Watcher(BatchChecker& checker, glsl::CompileCache* cache, FILE* log, const QString& outPath, int debounce, QObject* parent):
+	QObject(parent),
+	_checker(checker),
+	_cache(cache),
+	_log(log),
+	_outPath(outPath)
+{
+	_timer.setSingleShot(true);
+	_timer.setInterval(debounce);
+	connect(&_timer, &QTimer::timeout, this, &Watcher::_flush);
+	connect(&_watcher, &QFileSystemWatcher::fileChanged, this, &Watcher::_onFileChanged);
+	connect(&_watcher, &QFileSystemWatcher::directoryChanged, this, &Watcher::_onDirectoryChanged);
+}
+int Watcher::start(const QStringList& paths) {
+	for(auto& p : paths) {
+		QFileInfo fi(p);
+		if(fi.isDir())
+			_watchTree(fi.absoluteFilePath());
+	}
+	_check(ScanShaderTree(paths), false);
+	int nFailed = 0;
+	for(auto& r : _report) {
+		if(!r.second.result.bSuccess)
+			++nFailed;
+	}
+	std::fprintf(_log, "watching %d programs (%d failed)\n", int(_report.size()), nFailed);
+	std::fflush(_log);
+	_writeReport();
+	if(_cache)
+		_cache->flush();
+	return nFailed;
+}
+void Watcher::_watchTree(const QString& dir) {
+	QStringList add;
+	if(!_dir.contains(dir))
+		add.append(dir);
+	QDirIterator itr(dir, QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+	while(itr.hasNext()) {
+		const QString d = itr.next();
+		if(!_dir.contains(d))
+			add.append(d);
+	}
+	for(auto& d : add)
+		_dir.insert(d);
+	if(!add.isEmpty())
+		_watcher.addPaths(add);
+}
+void Watcher::_watchFile(const QString& path) {
+	// 置き換えで保存されたファイルは監視から外れるので、その都度加え直す
+	if(!path.isEmpty() && QFileInfo(path).exists())
+		_watcher.addPath(path);
+}
+void Watcher::_remove(const QString& name) {
+	auto itr = _report.find(name);
+	if(itr == _report.end())
+		return;
+	for(auto& p : itr->second.files.path) {
+		if(!p.isEmpty())
+			_owner.remove(QFileInfo(p).canonicalFilePath());
+	}
+	_report.erase(itr);
+}
+void Watcher::_check(const ProgramFilesV& v, bool bPrintOk) {
+	if(v.empty())
+		return;
+	ProgramReportV rep = _checker.checkAll(v);
+	for(auto& r : rep) {
+		_remove(r.files.name);
+		for(auto& p : r.files.path) {
+			if(p.isEmpty())
+				continue;
+			const QString canon = QFileInfo(p).canonicalFilePath();
+			_owner.insert(canon, r.files.name);
+			_watchFile(canon);
+		}
+		for(auto& inc : r.includes)
+			_watchFile(inc);
+		if(!r.result.bSuccess)
+			std::fprintf(_log, "%s: error\n%s\n", qPrintable(r.files.name), qPrintable(r.result.log));
+		else if(bPrintOk)
+			std::fprintf(_log, "%s: ok\n", qPrintable(r.files.name));
+		_report[r.files.name] = std::move(r);
+	}
+}
+void Watcher::_scanDir(const QString& dir, std::map<QString, ProgramFiles>& affected) {
+	if(!QFileInfo(dir).isDir()) {
+		// ディレクトリごと消えた
+		const QString prefix = dir + '/';
+		for(auto itr = _dir.begin() ; itr != _dir.end() ; ) {
+			if(*itr == dir || itr->startsWith(prefix)) {
+				_watcher.removePath(*itr);
+				itr = _dir.erase(itr);
+			} else
+				++itr;
+		}
+		for(auto itr = _report.begin() ; itr != _report.end() ; ) {
+			auto cur = itr++;
+			if(cur->first.startsWith(prefix))
+				_remove(cur->first);
+		}
+		return;
+	}
+	// 直下のプログラムだけを調べ直す
+	std::map<QString, ProgramFiles> now;
+	for(auto& pf : ScanShaderTree(QStringList(dir), false))
+		now[pf.name] = pf;
+	for(auto itr = _report.begin() ; itr != _report.end() ; ) {
+		auto cur = itr++;
+		if(ProgramDir(cur->first) != dir)
+			continue;
+		auto n = now.find(cur->first);
+		if(n == now.end())
+			_remove(cur->first);
+		else if(!SameFiles(n->second, cur->second.files))
+			affected[n->first] = n->second;
+	}
+	for(auto& n : now) {
+		if(_report.count(n.first) == 0)
+			affected[n.first] = n.second;
+	}
+	// 新しいサブディレクトリは中身ごと加える
+	for(auto& sub : QDir(dir).entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+		const QString path = sub.absoluteFilePath();
+		if(_dir.contains(path))
+			continue;
+		_watchTree(path);
+		for(auto& pf : ScanShaderTree(QStringList(path)))
+			affected[pf.name] = pf;
+	}
+}
+void Watcher::_onFileChanged(const QString& path) {
+	if(_changedFile.isEmpty() && _changedDir.isEmpty())
+		_latency.start();
+	_changedFile.insert(path);
+	_timer.start();
+}
+void Watcher::_onDirectoryChanged(const QString& path) {
+	if(_changedFile.isEmpty() && _changedDir.isEmpty())
+		_latency.start();
+	_changedDir.insert(path);
+	_timer.start();
+}
+void Watcher::_flush() {
+	std::map<QString, ProgramFiles> affected;
+	for(auto& dir : _changedDir)
+		_scanDir(dir, affected);
+	for(auto& file : _changedFile) {
+		_checker.invalidate(file);
+		_watchFile(file);
+		auto itr = _owner.find(file);
+		if(itr != _owner.end()) {
+			auto r = _report.find(itr.value());
+			if(r != _report.end())
+				affected[r->first] = r->second.files;
+		}
+		// このファイルを(間接的にも)インクルードしているプログラム
+		for(auto& dep : _checker.includeGraph().dependents(file)) {
+			auto o = _owner.find(dep);
+			if(o == _owner.end())
+				continue;
+			auto r = _report.find(o.value());
+			if(r != _report.end())
+				affected[r->first] = r->second.files;
+		}
+	}
+	_changedFile.clear();
+	_changedDir.clear();
+
+	ProgramFilesV v;
+	v.reserve(affected.size());
+	for(auto& a : affected)
+		v.push_back(std::move(a.second));
+	_check(v, true);
+	if(!v.empty()) {
+		std::fprintf(_log, "rechecked %d of %d programs in %.1fms\n", int(v.size()), int(_report.size()), _latency.nsecsElapsed() / 1e6);
+		_writeReport();
+	}
+	std::fflush(_log);
+	if(_cache)
+		_cache->flush();
+}
+void Watcher::_writeReport() {
+	if(_outPath.isEmpty())
+		return;
+	ProgramReportV v;
+	v.reserve(_report.size());
+	for(auto& r : _report)
+		v.push_back(r.second);
+	glsl::CompileCache::Stat stat;
+	if(_cache)
+		stat = _cache->stat();
+	QSaveFile file(_outPath);
+	if(!file.open(QFile::WriteOnly)) {
+		std::fprintf(_log, "can't open output %s\n", qPrintable(_outPath));
+		return;
+	}
+	const glsl::StageCache::Stat stage = _checker.stageStat();
+	file.write(MakeReport(v, _checker.driverInfo(), _cache ? &stat : nullptr, &_checker.timingStat(), &stage).toJson());
+	if(!file.commit())
+		std::fprintf(_log, "can't write output %s\n", qPrintable(_outPath));
+}
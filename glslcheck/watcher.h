@@ -0,0 +1,64 @@
+#pragma once
+#include "batchchecker.h"
+#include <QObject>
+#include <QFileSystemWatcher>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QSet>
+#include <QTimer>
+#include <cstdio>
+#include <map>
+
+namespace glsl {
+	class CompileCache;
+}
+//! シェーダーツリーを監視し、変更の影響を受けるプログラムだけを検査し直す
+/*! QFileSystemWatcher(Linuxではinotify)で、ディレクトリ(ファイルの追加・削除・置き換え)と
+	プログラムのファイル・インクルードしているファイル(内容の変更)を監視する。
+	保存が続けて起きても1度で済むよう、最後の通知から一定時間待ってから検査する。
+	ヘッダが変わったら、IncludeGraphでそれを(間接的にも)インクルードしている全てのプログラムを検査する */
+class Watcher : public QObject {
+	Q_OBJECT
+	using ReportMap = std::map<QString, ProgramReport>;
+
+	BatchChecker&		_checker;
+	glsl::CompileCache*	_cache;
+	FILE*				_log;
+	QString				_outPath;
+	QFileSystemWatcher	_watcher;
+	QTimer				_timer;
+	QElapsedTimer		_latency;		//!< 検査を待っている最初の通知からの時間
+	QSet<QString>		_dir;			//!< 監視しているディレクトリ (絶対パス)
+	ReportMap			_report;		//!< プログラム名 -> 最後の検査結果
+	QHash<QString, QString>	_owner;		//!< ステージのファイル(正規化したパス) -> プログラム名
+	QSet<QString>		_changedFile,
+						_changedDir;
+
+	//! dir以下(再帰)のディレクトリを監視に加える
+	void _watchTree(const QString& dir);
+	void _watchFile(const QString& path);
+	//! プログラムを除き、ファイルとの対応も消す
+	void _remove(const QString& name);
+	//! 検査してファイルを監視に加える
+	/*! \param[in] bPrintOk	成功したプログラムも表示するか */
+	void _check(const ProgramFilesV& v, bool bPrintOk);
+	//! ディレクトリの変更から、追加・削除・構成が変わったプログラムを集める
+	void _scanDir(const QString& dir, std::map<QString, ProgramFiles>& affected);
+	//! 全プログラムのレポートを書き出す (出力先が無ければ何もしない)
+	void _writeReport();
+
+	private slots:
+		void _onFileChanged(const QString& path);
+		void _onDirectoryChanged(const QString& path);
+		//! 溜まった変更を処理する
+		void _flush();
+	public:
+		/*! \param[in] cache	検査毎にflushする (nullptrなら無し, 所有はしない)
+			\param[in] log		診断の出力先
+			\param[in] outPath	検査毎にJSONのレポートを書き出すファイル (空なら書き出さない)
+			\param[in] debounce	最後の通知から検査するまでの待ち時間(ミリ秒) */
+		Watcher(BatchChecker& checker, glsl::CompileCache* cache, FILE* log, const QString& outPath, int debounce, QObject* parent = nullptr);
+		//! pathsを全て検査して監視を始める
+		/*! \return 失敗したプログラムの数 */
+		int start(const QStringList& paths);
+};
@@ -0,0 +1,114 @@
+#include "asynccompiler.h"
+#include "offscreencontext.h"
+#include <QOpenGLContext>
+#include <QThread>
+
+namespace glsl {
+	// ------------------ AsyncCompiler::Worker ------------------
+	class AsyncCompiler::Worker : public QThread {
+		AsyncCompiler&	_owner;
+		using UPContext = std::unique_ptr<OffscreenContext>;
+		UPContext		_ctx;
+		QThread*		_ownerThread;
+		protected:
+			void run() override {
+				const bool bCurrent = _ctx->makeCurrent();
+				std::unique_ptr<Compiler> compiler;
+				if(bCurrent)
+					compiler.reset(new Compiler());
+				for(;;) {
+					ProgramSource src;
+					int gen;
+					{
+						QMutexLocker lk(&_owner._mutex);
+						while(!_owner._bPending && !_owner._bQuit)
+							_owner._cv.wait(&_owner._mutex);
+						if(_owner._bQuit)
+							break;
+						std::swap(src, _owner._pending);
+						gen = _owner._pendingGen;
+						_owner._bPending = false;
+						if(compiler)
+							compiler->setCache(_owner._cache);
+					}
+					// 処理中に新しい要求が来たらステージの合間で打ち切る
+					const CancelFn cancel = [this, gen]() {
+						QMutexLocker lk(&_owner._mutex);
+						return gen != _owner._generation || _owner._bQuit;
+					};
+					CompileResult res;
+					if(compiler)
+						res = compiler->compile(src, cancel);
+					else
+						res.log = "can't make OpenGL context current";
+					{
+						QMutexLocker lk(&_owner._mutex);
+						// 処理中に新しい要求が来ていたら結果は捨てる
+						if(gen != _owner._generation || res.bCanceled)
+							continue;
+						_owner._done = std::move(res);
+						_owner._doneGen = gen;
+						_owner._bDone = true;
+					}
+					QMetaObject::invokeMethod(&_owner, "_onFinished", Qt::QueuedConnection);
+				}
+				compiler.reset();
+				if(bCurrent)
+					_ctx->doneCurrent();
+				_ctx->moveToThread(_ownerThread);
+			}
+		public:
+			Worker(AsyncCompiler& owner, QOpenGLContext* share):
+				_owner(owner),
+				_ctx(new OffscreenContext(share ? share->format() : QSurfaceFormat(), share)),
+				_ownerThread(QThread::currentThread())
+			{
+				_ctx->moveToThread(this);
+			}
+	};
+	// ------------------ AsyncCompiler ------------------
+	AsyncCompiler::AsyncCompiler(QOpenGLContext* share, QObject* parent):
+		QObject(parent),
+		_worker(new Worker(*this, share))
+	{
+		_worker->start();
+	}
+	AsyncCompiler::~AsyncCompiler() {
+		{
+			QMutexLocker lk(&_mutex);
+			_bQuit = true;
+			_cv.wakeAll();
+		}
+		// コンパイル中ならそれが終わるまで待つ
+		_worker->wait();
+	}
+	void AsyncCompiler::setCache(CompileCache* cache) {
+		QMutexLocker lk(&_mutex);
+		_cache = cache;
+	}
+	int AsyncCompiler::request(const ProgramSource& src) {
+		QMutexLocker lk(&_mutex);
+		_pending = src;
+		_pendingGen = ++_generation;
+		_bPending = true;
+		_cv.wakeAll();
+		return _generation;
+	}
+	bool AsyncCompiler::isBusy() {
+		QMutexLocker lk(&_mutex);
+		return _bPending || _doneGen != _generation;
+	}
+	void AsyncCompiler::_onFinished() {
+		CompileResult res;
+		int gen;
+		{
+			QMutexLocker lk(&_mutex);
+			if(!_bDone || _doneGen != _generation)
+				return;
+			std::swap(res, _done);
+			gen = _doneGen;
+			_bDone = false;
+		}
+		emit compiled(gen, res);
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include "compiler.h"
+#include <QObject>
+#include <QMutex>
+#include <QWaitCondition>
+#include <memory>
+
+class QOpenGLContext;
+namespace glsl {
+	//! バックグラウンドのスレッドでシェーダーをコンパイルする
+	/*! GUIのコンテキストとリソースを共有するOffscreenContextを専用スレッドで使う。
+		新しい要求が来たら未着手の要求は捨て、処理中の要求はステージのコンパイルとリンクの合間で打ち切る
+		(最新の結果だけをcompiledで通知)。
+		GUIスレッドで作成・使用すること */
+	class AsyncCompiler : public QObject {
+		Q_OBJECT
+		class Worker;
+		using UPWorker = std::unique_ptr<Worker>;
+		UPWorker		_worker;
+		// ---- 以下は_mutexで保護 ----
+		QMutex			_mutex;
+		QWaitCondition	_cv;
+		bool			_bQuit = false,
+						_bPending = false,	//!< 未着手の要求があるか
+						_bDone = false;		//!< 通知していない結果があるか
+		int				_generation = 0;	//!< 最新の要求番号
+		ProgramSource	_pending;
+		int				_pendingGen = 0;
+		CompileResult	_done;
+		int				_doneGen = 0;
+		CompileCache*	_cache = nullptr;
+
+		private slots:
+			void _onFinished();
+		public:
+			/*! \param[in] share	リソースを共有するコンテキスト (nullptrなら共有しない) */
+			AsyncCompiler(QOpenGLContext* share, QObject* parent = nullptr);
+			~AsyncCompiler();
+			//! 結果をキャッシュする (nullptrで無効, 所有はしない)
+			void setCache(CompileCache* cache);
+			//! それまでの要求を取り消してコンパイルを要求
+			/*! \return 要求番号 (compiledで通知される) */
+			int request(const ProgramSource& src);
+			//! 結果を待っている要求があるか
+			bool isBusy();
+		signals:
+			//! 最新の要求のコンパイルが終わった (GUIスレッドで通知)
+			void compiled(int generation, const glsl::CompileResult& res);
+	};
+}
@@ -0,0 +1,43 @@
+#include "chartable.h"
+#include <algorithm>
+#include <cstring>
+
+namespace glsl {
+	CharTable::CharTable() {
+		std::memset(_alnum, 0, sizeof(_alnum));
+		for(char16_t c='0' ; c<='9' ; c++)
+			setLetterOrNumber(c, true);
+		for(char16_t c='A' ; c<='Z' ; c++) {
+			setLetterOrNumber(c, true);
+			setLetterOrNumber(c - 'A' + 'a', true);
+		}
+	}
+	void CharTable::setLetterOrNumber(char16_t c, bool b) {
+		const uint64_t bit = uint64_t(1) << (c & 63);
+		if(b)
+			_alnum[c >> 6] |= bit;
+		else
+			_alnum[c >> 6] &= ~bit;
+	}
+	void CharTable::addFold(char16_t c, char16_t folded) {
+		_fold.emplace_back(c, folded);
+	}
+	char16_t CharTable::fold(char16_t c) const {
+		// ASCIIは表引きせずに変換
+		if(c < 0x80) {
+			if(c >= 'A' && c <= 'Z')
+				return c - 'A' + 'a';
+			return c;
+		}
+		auto itr = std::lower_bound(_fold.begin(), _fold.end(), c, [](const std::pair<char16_t,char16_t>& p, char16_t ch){
+			return p.first < ch;
+		});
+		if(itr != _fold.end() && itr->first == c)
+			return itr->second;
+		return c;
+	}
+	const CharTable& CharTable::Ascii() {
+		static const CharTable s_table;
+		return s_table;
+	}
+}
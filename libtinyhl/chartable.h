@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace glsl {
+	//! 文字の分類表 (英数字かどうかと大文字小文字の畳み込み)
+	/*! 基本多言語面(BMP)の文字だけを扱い、それ以外は英数字でなく畳み込みもしない物とする。
+		既定ではASCIIの範囲だけを設定した表になる。Unicode全体の表はRuleTokenizer::UnicodeTableで作る */
+	class CharTable {
+		using FoldV = std::vector<std::pair<char16_t, char16_t>>;
+		//! 英数字(QChar::isLetterOrNumber)のビット表
+		uint64_t	_alnum[0x10000 / 64];
+		//! 非ASCII文字の畳み込み先 (文字順)
+		FoldV		_fold;
+
+		public:
+			CharTable();
+			//! cを英数字とするか設定
+			void setLetterOrNumber(char16_t c, bool b);
+			//! 非ASCII文字の畳み込み先を登録 (cの昇順に呼ぶこと)
+			void addFold(char16_t c, char16_t folded);
+			bool isLetterOrNumber(char32_t c) const {
+				return c < 0x10000 && (_alnum[c >> 6] >> (c & 63) & 1) != 0;
+			}
+			//! 大文字小文字を区別しない比較用に畳み込む
+			char16_t fold(char16_t c) const;
+			//! ASCIIの範囲だけを設定した表
+			static const CharTable& Ascii();
+	};
+}
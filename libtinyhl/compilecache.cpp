@@ -0,0 +1,222 @@
+#include "compilecache.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <iterator>
+
+namespace glsl {
+	namespace {
+		const quint32	c_magicEntry = 0x474c4345,	// "GLCE"
+						c_magicIndex = 0x474c4349,	// "GLCI"
+						// 書式を変えたら上げる
+						c_version = 5,
+						c_byteOrder = 0x01020304;
+		const char* c_entrySuffix = ".bin";
+
+		void WriteHeader(QDataStream& ds, quint32 magic) {
+			ds.setVersion(QDataStream::Qt_5_0);
+			ds << magic << c_version << c_byteOrder;
+		}
+		bool ReadHeader(QDataStream& ds, quint32 magic) {
+			ds.setVersion(QDataStream::Qt_5_0);
+			quint32 m, version, byteOrder;
+			ds >> m >> version >> byteOrder;
+			return ds.status() == QDataStream::Ok &&
+					m == magic && version == c_version && byteOrder == c_byteOrder;
+		}
+		//! 一時ファイル経由で置き換える
+		bool WriteFile(const QString& path, const QByteArray& data) {
+			QSaveFile file(path);
+			if(!file.open(QFile::WriteOnly))
+				return false;
+			if(file.write(data) != data.size()) {
+				file.cancelWriting();
+				return false;
+			}
+			return file.commit();
+		}
+	}
+	CompileCache::CompileCache(const QString& dir, qint64 maxBytes):
+		_dir(dir),
+		_maxBytes(maxBytes)
+	{
+		QDir().mkpath(_dir);
+		if(!_readIndex())
+			_scanDir();
+		_evict();
+	}
+	CompileCache::~CompileCache() {
+		flush();
+	}
+	QString CompileCache::_entryPath(const QByteArray& key) const {
+		return QString("%1/%2%3").arg(_dir).arg(QString::fromLatin1(key.toHex())).arg(c_entrySuffix);
+	}
+	QString CompileCache::_indexPath() const {
+		return _dir + "/index";
+	}
+	bool CompileCache::_readIndex() {
+		QFile file(_indexPath());
+		if(!file.open(QFile::ReadOnly))
+			return false;
+		QDataStream ds(&file);
+		if(!ReadHeader(ds, c_magicIndex))
+			return false;
+		quint32 n;
+		ds >> n;
+		EntryL lru;
+		for(quint32 i=0 ; i<n && ds.status()==QDataStream::Ok ; i++) {
+			Entry e;
+			ds >> e.key >> e.size;
+			lru.push_back(std::move(e));
+		}
+		if(ds.status() != QDataStream::Ok)
+			return false;
+		for(auto itr = lru.begin() ; itr != lru.end() ; ) {
+			// 他のプロセスが消したエントリは除く
+			if(_map.contains(itr->key) || !QFile::exists(_entryPath(itr->key)))
+				itr = lru.erase(itr);
+			else {
+				_map.insert(itr->key, itr);
+				_totalBytes += itr->size;
+				++itr;
+			}
+		}
+		_lru.swap(lru);
+		return true;
+	}
+	void CompileCache::_scanDir() {
+		_lru.clear();
+		_map.clear();
+		_totalBytes = 0;
+		QDir dir(_dir);
+		// 新しい物から順に並ぶ
+		const QFileInfoList fl = dir.entryInfoList(QStringList() << QString("*%1").arg(c_entrySuffix), QDir::Files, QDir::Time);
+		for(auto& fi : fl) {
+			const QByteArray key = QByteArray::fromHex(fi.completeBaseName().toLatin1());
+			if(key.isEmpty() || _map.contains(key))
+				continue;
+			_lru.push_back(Entry{key, fi.size()});
+			_map.insert(key, std::prev(_lru.end()));
+			_totalBytes += fi.size();
+		}
+		_bDirty = true;
+	}
+	void CompileCache::_remove(EntryL::iterator itr) {
+		QFile::remove(_entryPath(itr->key));
+		_totalBytes -= itr->size;
+		_map.remove(itr->key);
+		_lru.erase(itr);
+		_bDirty = true;
+	}
+	void CompileCache::_evict() {
+		while(_totalBytes > _maxBytes && !_lru.empty())
+			_remove(std::prev(_lru.end()));
+	}
+	QByteArray CompileCache::MakeKey(const ProgramSource& src, const DriverInfo& driver) {
+		QCryptographicHash h(QCryptographicHash::Sha1);
+		// 区切りが曖昧にならないよう長さ付きで連結する
+		QByteArray buff;
+		QDataStream ds(&buff, QIODevice::WriteOnly);
+		ds.setVersion(QDataStream::Qt_5_0);
+		ds << c_version << driver.vendor << driver.renderer << driver.version;
+		for(int i=0 ; i<Shader::_Num ; i++)
+			ds << src.source[i];
+		h.addData(buff);
+		return h.result();
+	}
+	bool CompileCache::find(const QByteArray& key, CompileResult& dst) {
+		QMutexLocker lk(&_mutex);
+		auto itr = _map.find(key);
+		if(itr == _map.end()) {
+			++_stat.miss;
+			return false;
+		}
+		QFile file(_entryPath(key));
+		bool bOk = file.open(QFile::ReadOnly);
+		if(bOk) {
+			QDataStream ds(&file);
+			QByteArray k;
+			bOk = ReadHeader(ds, c_magicEntry);
+			if(bOk) {
+				ds >> k;
+				bOk = (k == key) && dst.deserialize(ds);
+			}
+		}
+		if(!bOk) {
+			// 読めないエントリは捨てる
+			file.close();
+			_remove(itr.value());
+			++_stat.miss;
+			return false;
+		}
+		_lru.splice(_lru.begin(), _lru, itr.value());
+		_bDirty = true;
+		++_stat.hit;
+		return true;
+	}
+	void CompileCache::store(const QByteArray& key, const CompileResult& res) {
+		QByteArray data;
+		{
+			QDataStream ds(&data, QIODevice::WriteOnly);
+			WriteHeader(ds, c_magicEntry);
+			ds << key;
+			res.serialize(ds);
+		}
+		if(!WriteFile(_entryPath(key), data))
+			return;
+		QMutexLocker lk(&_mutex);
+		auto itr = _map.find(key);
+		if(itr != _map.end()) {
+			Entry& e = *itr.value();
+			_totalBytes += data.size() - e.size;
+			e.size = data.size();
+			_lru.splice(_lru.begin(), _lru, itr.value());
+		} else {
+			_lru.push_front(Entry{key, data.size()});
+			_map.insert(key, _lru.begin());
+			_totalBytes += data.size();
+		}
+		_bDirty = true;
+		_evict();
+	}
+	void CompileCache::flush() {
+		QMutexLocker lk(&_mutex);
+		_flush();
+	}
+	void CompileCache::_flush() {
+		if(!_bDirty)
+			return;
+		QByteArray data;
+		{
+			QDataStream ds(&data, QIODevice::WriteOnly);
+			WriteHeader(ds, c_magicIndex);
+			ds << quint32(_lru.size());
+			for(auto& e : _lru)
+				ds << e.key << e.size;
+		}
+		if(WriteFile(_indexPath(), data))
+			_bDirty = false;
+	}
+	void CompileCache::countRejected() {
+		QMutexLocker lk(&_mutex);
+		++_stat.rejected;
+	}
+	CompileCache::Stat CompileCache::stat() const {
+		QMutexLocker lk(&_mutex);
+		return _stat;
+	}
+	qint64 CompileCache::totalBytes() const {
+		QMutexLocker lk(&_mutex);
+		return _totalBytes;
+	}
+	QString CompileCache::DefaultPath() {
+		QString base = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+		if(base.isEmpty())
+			base = QDir::tempPath();
+		return base + "/compile";
+	}
+}
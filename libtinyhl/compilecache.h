@@ -0,0 +1,72 @@
+#pragma once
+#include "compiler.h"
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <list>
+
+namespace glsl {
+	//! コンパイル結果のディスクキャッシュ
+	/*! ソースとドライバ情報のハッシュをキーに、ログ・リンク結果・変数情報・プログラムバイナリをエントリ毎のファイルに保存する。
+		合計サイズが上限を超えたら最も長く使われていないエントリから削除する(LRU)。
+		使用順はindexファイルに記録し、flush又はデストラクタで書き出す。
+		複数のスレッドから同時に呼んでもよい */
+	class CompileCache {
+		public:
+			//! キャッシュの利用状況
+			struct Stat {
+				quint64	hit = 0,
+						miss = 0,
+						rejected = 0;	//!< ヒットしたがドライバがプログラムバイナリを受け付けなかった数
+			};
+		private:
+			struct Entry {
+				QByteArray	key;
+				qint64		size;
+			};
+			//! 先頭ほど最近使われたエントリ
+			using EntryL = std::list<Entry>;
+			using EntryMap = QHash<QByteArray, EntryL::iterator>;
+
+			mutable QMutex	_mutex;
+			QString		_dir;
+			qint64		_maxBytes,
+						_totalBytes = 0;
+			EntryL		_lru;
+			EntryMap	_map;
+			Stat		_stat;
+			bool		_bDirty = false;	//!< indexファイルに書き出していない変更があるか
+
+			QString _entryPath(const QByteArray& key) const;
+			QString _indexPath() const;
+			//! indexファイルを読み込む
+			/*! \return 無い、又は壊れていればfalse */
+			bool _readIndex();
+			//! indexファイルが使えない時にディレクトリ内のエントリを更新日時順に並べる
+			void _scanDir();
+			void _remove(EntryL::iterator itr);
+			//! 合計サイズが上限以下になるまで古いエントリを削除
+			void _evict();
+			void _flush();
+		public:
+			/*! \param[in] dir		キャッシュを置くディレクトリ
+				\param[in] maxBytes	エントリの合計サイズの上限 */
+			CompileCache(const QString& dir, qint64 maxBytes = 64*1024*1024);
+			~CompileCache();
+			//! ソース(ステージ毎)とドライバ情報からキーを作る
+			static QByteArray MakeKey(const ProgramSource& src, const DriverInfo& driver);
+			//! キーに対応する結果を読み込む
+			/*! \return キャッシュに無い、又は壊れていればfalse */
+			bool find(const QByteArray& key, CompileResult& dst);
+			void store(const QByteArray& key, const CompileResult& res);
+			//! ヒットしたエントリのバイナリが使えなかったことを記録する (エントリはstoreで更新する)
+			void countRejected();
+			//! 使用順をindexファイルに書き出す
+			void flush();
+			Stat stat() const;
+			qint64 totalBytes() const;
+			//! デフォルトのキャッシュディレクトリ
+			static QString DefaultPath();
+	};
+}
@@ -0,0 +1,147 @@
+#include "compilepool.h"
+#include "offscreencontext.h"
+#include <QThread>
+#include <algorithm>
+
+namespace glsl {
+	// ------------------ CompilePool::Worker ------------------
+	class CompilePool::Worker : public QThread {
+		CompilePool&	_pool;
+		const int		_index;
+		using UPContext = std::unique_ptr<OffscreenContext>;
+		UPContext		_ctx;
+		QThread*		_owner;
+		protected:
+			void run() override {
+				const bool bCurrent = _ctx->makeCurrent();
+				// Compilerはコンテキストがカレントになってから作る
+				std::unique_ptr<Compiler> compiler;
+				if(bCurrent)
+					compiler.reset(new Compiler());
+				int gen = 0;
+				StageCache::Stat last;
+				for(;;) {
+					{
+						QMutexLocker lk(&_pool._mutex);
+						while(gen == _pool._generation && !_pool._bQuit)
+							_pool._cvStart.wait(&_pool._mutex);
+						if(_pool._bQuit)
+							break;
+						gen = _pool._generation;
+						if(compiler)
+							compiler->setCache(_pool._cache);
+					}
+					int job;
+					while(_pool._pop(_index, job)) {
+						CompileResult& res = (*_pool._result)[job];
+						if(compiler)
+							res = compiler->compile((*_pool._src)[job]);
+						else
+							res.log = "can't make OpenGL context current";
+					}
+					QMutexLocker lk(&_pool._mutex);
+					if(compiler) {
+						// 前回からの増分を足す
+						const StageCache::Stat cur = compiler->stageStat();
+						_pool._stageStat.hit += cur.hit - last.hit;
+						_pool._stageStat.miss += cur.miss - last.miss;
+						last = cur;
+					}
+					if(--_pool._nBusy == 0)
+						_pool._cvDone.wakeAll();
+				}
+				compiler.reset();
+				if(bCurrent)
+					_ctx->doneCurrent();
+				// 破棄は作成したスレッドで行うので戻しておく
+				_ctx->moveToThread(_owner);
+			}
+		public:
+			Worker(CompilePool& pool, int index, const QSurfaceFormat& fmt):
+				_pool(pool),
+				_index(index),
+				_ctx(new OffscreenContext(fmt)),
+				_owner(QThread::currentThread())
+			{
+				_ctx->moveToThread(this);
+			}
+	};
+	// ------------------ CompilePool ------------------
+	CompilePool::CompilePool(int nWorker, const QSurfaceFormat& fmt) {
+		if(nWorker <= 0)
+			nWorker = std::max(1, QThread::idealThreadCount());
+		for(int i=0 ; i<nWorker ; i++) {
+			_queue.emplace_back(new Queue());
+			_worker.emplace_back(new Worker(*this, i, fmt));
+		}
+		for(auto& w : _worker)
+			w->start();
+	}
+	CompilePool::~CompilePool() {
+		{
+			QMutexLocker lk(&_mutex);
+			_bQuit = true;
+			_cvStart.wakeAll();
+		}
+		for(auto& w : _worker)
+			w->wait();
+	}
+	int CompilePool::numWorker() const {
+		return static_cast<int>(_worker.size());
+	}
+	StageCache::Stat CompilePool::stageStat() const {
+		QMutexLocker lk(&_mutex);
+		return _stageStat;
+	}
+	void CompilePool::setCache(CompileCache* cache) {
+		QMutexLocker lk(&_mutex);
+		_cache = cache;
+	}
+	bool CompilePool::_pop(int self, int& job) {
+		{
+			Queue& q = *_queue[self];
+			QMutexLocker lk(&q.mutex);
+			if(!q.job.empty()) {
+				job = q.job.front();
+				q.job.pop_front();
+				return true;
+			}
+		}
+		const int n = numWorker();
+		for(int i=1 ; i<n ; i++) {
+			Queue& q = *_queue[(self + i) % n];
+			QMutexLocker lk(&q.mutex);
+			if(!q.job.empty()) {
+				job = q.job.back();
+				q.job.pop_back();
+				return true;
+			}
+		}
+		return false;
+	}
+	CompilePool::ResultV CompilePool::compileAll(const SourceV& src) {
+		ResultV result(src.size());
+		if(src.empty())
+			return result;
+		// 連続した範囲で割り振る (盗まれるのは末尾から)
+		const int n = numWorker(),
+				nJob = static_cast<int>(src.size());
+		for(int i=0 ; i<n ; i++) {
+			Queue& q = *_queue[i];
+			QMutexLocker lk(&q.mutex);
+			for(int j=nJob*i/n ; j<nJob*(i+1)/n ; j++)
+				q.job.push_back(j);
+		}
+		QMutexLocker lk(&_mutex);
+		_src = &src;
+		_result = &result;
+		_nBusy = n;
+		++_generation;
+		_cvStart.wakeAll();
+		while(_nBusy > 0)
+			_cvDone.wait(&_mutex);
+		_src = nullptr;
+		_result = nullptr;
+		return result;
+	}
+}
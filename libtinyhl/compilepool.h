@@ -0,0 +1,65 @@
+#pragma once
+#include "compiler.h"
+#include <QSurfaceFormat>
+#include <QMutex>
+#include <QWaitCondition>
+#include <deque>
+#include <memory>
+
+namespace glsl {
+	//! 複数のオフスクリーンコンテキストでシェーダーを並列にコンパイルする
+	/*! ワーカースレッド毎に専用のOffscreenContextを持たせ、ジョブはワーカー毎のキューに
+		連続した範囲で割り振る。自分のキューが空になったワーカーは他のキューの末尾から盗む(work-stealing)。
+		コンパイル済みのステージはワーカー毎に使い回すので、同じステージを使うプログラムは隣り合わせて渡すとよい。
+		結果は投入した順に返す */
+	class CompilePool {
+		public:
+			using SourceV = std::vector<ProgramSource>;
+			using ResultV = std::vector<CompileResult>;
+		private:
+			class Worker;
+			using UPWorker = std::unique_ptr<Worker>;
+			using WorkerV = std::vector<UPWorker>;
+			//! ワーカー毎のジョブキュー (ソースのインデックス)
+			struct Queue {
+				QMutex			mutex;
+				std::deque<int>	job;
+			};
+			using UPQueue = std::unique_ptr<Queue>;
+			using QueueV = std::vector<UPQueue>;
+
+			WorkerV			_worker;
+			QueueV			_queue;
+			// ---- 以下は_mutexで保護 ----
+			mutable QMutex	_mutex;
+			QWaitCondition	_cvStart,
+							_cvDone;
+			int				_generation = 0,	//!< compileAllを呼ぶ度に増える
+							_nBusy = 0;			//!< ジョブを処理中のワーカー数
+			bool			_bQuit = false;
+			CompileCache*	_cache = nullptr;
+			StageCache::Stat	_stageStat;		//!< 全ワーカーの合計
+			// ---- 実行中のジョブ (compileAll中のみ有効) ----
+			const SourceV*	_src = nullptr;
+			ResultV*		_result = nullptr;
+
+			//! 次に処理するジョブを取得 (自分のキューの先頭、無ければ他のキューの末尾)
+			/*! \return 全てのキューが空ならfalse */
+			bool _pop(int self, int& job);
+		public:
+			/*! GUIスレッドから呼ぶこと (OffscreenContextの制約)
+				\param[in] nWorker	ワーカー数 (0以下ならQThread::idealThreadCount())
+				\param[in] fmt		各コンテキストに要求するフォーマット */
+			CompilePool(int nWorker = 0, const QSurfaceFormat& fmt = QSurfaceFormat());
+			~CompilePool();
+			int numWorker() const;
+			//! 各ワーカーのCompilerに結果のキャッシュを設定 (nullptrで無効, 所有はしない)
+			/*! 次のcompileAllから有効 */
+			void setCache(CompileCache* cache);
+			//! 全てのプログラムをコンパイル・リンクし、srcと同じ順で結果を返す
+			/*! 完了するまで戻らない。同時に複数のスレッドから呼ばないこと */
+			ResultV compileAll(const SourceV& src);
+			//! 全ワーカーのステージの使い回しの状況 (完了したcompileAllの分)
+			StageCache::Stat stageStat() const;
+	};
+}
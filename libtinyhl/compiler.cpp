@@ -0,0 +1,244 @@
+#include "compiler.h"
+#include "compilecache.h"
+#include "preprocessor.h"
+#include <QDataStream>
+#include <QOpenGLContext>
+#include <QOpenGLShader>
+#include <memory>
+
+namespace glsl {
+	// ------------------ ProgramSource ------------------
+	bool ProgramSource::has(Shader::Type type) const {
+		return !source[type].isEmpty();
+	}
+	// ------------------ CompileResult ------------------
+	void CompileResult::serialize(QDataStream& ds) const {
+		ds << bSuccess << bLinked << log;
+		reflection.serialize(ds);
+		ds << quint32(binary.format) << binary.data;
+	}
+	bool CompileResult::deserialize(QDataStream& ds) {
+		ds >> bSuccess >> bLinked >> log;
+		if(!reflection.deserialize(ds))
+			return false;
+		quint32 format;
+		ds >> format >> binary.data;
+		binary.format = format;
+		return ds.status() == QDataStream::Ok;
+	}
+	// ------------------ Compiler ------------------
+	namespace {
+		const QOpenGLShader::ShaderTypeBit c_shaderType[Shader::_Num] = {
+			QOpenGLShader::Vertex,
+			QOpenGLShader::Fragment,
+			QOpenGLShader::Geometry,
+			QOpenGLShader::TessellationControl,
+			QOpenGLShader::TessellationEvaluation,
+			QOpenGLShader::Compute
+		};
+		//! ログの先頭にステージ名を付ける
+		QString StageLog(const char* stage, const QString& log) {
+			return QString("[%1]\n%2").arg(stage).arg(log);
+		}
+	}
+	Compiler::Compiler() {
+		initializeOpenGLFunctions();
+		auto fnStr = [this](GLenum name) {
+			return QString::fromLatin1(reinterpret_cast<const char*>(glGetString(name)));
+		};
+		_driver = DriverInfo{fnStr(GL_VENDOR), fnStr(GL_RENDERER), fnStr(GL_VERSION)};
+
+		QOpenGLContext* ctx = QOpenGLContext::currentContext();
+		if(ctx->format().version() >= qMakePair(4,1) || ctx->hasExtension("GL_ARB_get_program_binary")) {
+			// 拡張があってもバイナリ形式が1つも無いドライバがある
+			GLint nFormat = 0;
+			glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &nFormat);
+			if(nFormat > 0) {
+				_programParameteri = reinterpret_cast<ProgramParameteri>(ctx->getProcAddress("glProgramParameteri"));
+				_getProgramBinary = reinterpret_cast<GetProgramBinary>(ctx->getProcAddress("glGetProgramBinary"));
+				_programBinary = reinterpret_cast<ProgramBinaryF>(ctx->getProcAddress("glProgramBinary"));
+				if(!_programParameteri || !_getProgramBinary || !_programBinary)
+					_programBinary = nullptr;
+			}
+		}
+	}
+	bool Compiler::hasProgramBinary() const {
+		return _programBinary != nullptr;
+	}
+	void Compiler::setCache(CompileCache* cache) {
+		_cache = cache;
+	}
+	CompileResult Compiler::compile(const ProgramSource& src, const CancelFn& cancel) {
+		CompileResult res = _lookup(src, cancel, nullptr);
+		// バイナリはキャッシュ用なので、大量の結果を保持する呼び出し元に持たせない
+		res.binary = ProgramBinary();
+		// ファイル名はキーに含まれないので、キャッシュには番号のままのログを置く
+		if(!src.files.isEmpty())
+			res.log = MapSourceLog(res.log, src.files);
+		return res;
+	}
+	std::unique_ptr<QOpenGLShaderProgram> Compiler::compileProgram(const ProgramSource& src, CompileResult& res,
+																	const CancelFn& cancel) {
+		UPProgram prog;
+		res = _lookup(src, cancel, &prog);
+		res.binary = ProgramBinary();
+		if(!src.files.isEmpty())
+			res.log = MapSourceLog(res.log, src.files);
+		return prog;
+	}
+	CompileResult Compiler::_lookup(const ProgramSource& src, const CancelFn& cancel, UPProgram* prog) {
+		if(!_cache)
+			return _compile(src, cancel, prog);
+		// キャッシュの結果は時間を持たないので別に計り、最後に設定する
+		Timing timing;
+		const QByteArray key = CompileCache::MakeKey(src, _driver);
+		CompileResult res;
+		bool bFound;
+		{
+			ScopedTiming st(timing, Phase::CacheFind);
+			bFound = _cache->find(key, res);
+		}
+		if(bFound) {
+			// 失敗した結果にはプログラムが無い
+			if(!res.bSuccess) {
+				res.timing = timing;
+				return res;
+			}
+			if(hasProgramBinary() && !res.binary.data.isEmpty()) {
+				UPProgram p;
+				{
+					ScopedTiming st(timing, Phase::Restore);
+					p = _restore(res.binary);
+				}
+				if(p) {
+					if(prog)
+						*prog = std::move(p);
+					res.timing = timing;
+					return res;
+				}
+				// ドライバが変わったなどで受け付けられなかったので作り直す
+				_cache->countRejected();
+			} else if(!prog) {
+				res.timing = timing;
+				return res;
+			}
+		}
+		res = _compile(src, cancel, prog);
+		// 打ち切った結果は途中までの物なので置かない
+		if(res.bCanceled)
+			return res;
+		{
+			ScopedTiming st(timing, Phase::CacheStore);
+			_cache->store(key, res);
+		}
+		res.timing += timing;
+		return res;
+	}
+	void Compiler::_readBinary(GLuint prog, ProgramBinary& dst) {
+		GLint len = 0;
+		glGetProgramiv(prog, GL_PROGRAM_BINARY_LENGTH, &len);
+		if(len <= 0)
+			return;
+		dst.data.resize(len);
+		GLsizei got = 0;
+		_getProgramBinary(prog, len, &got, &dst.format, dst.data.data());
+		dst.data.resize(got);
+	}
+	Compiler::UPProgram Compiler::_restore(const ProgramBinary& bin) {
+		UPProgram prog(new QOpenGLShaderProgram);
+		if(!prog->create())
+			return nullptr;
+		_programBinary(prog->programId(), bin.format, bin.data.constData(), GLsizei(bin.data.size()));
+		// シェーダーを追加していなければ、link()はリンク済みかを確認するだけ
+		if(!prog->link())
+			return nullptr;
+		return prog;
+	}
+	StageCache::Stage Compiler::_compileStage(Shader::Type type, const QString& src, Timing& timing) {
+		const QByteArray key = StageCache::MakeKey(type, src);
+		StageCache::Stage stage;
+		if(_stage.find(key, stage))
+			return stage;
+		if(!QOpenGLShader::hasOpenGLShaders(c_shaderType[type]))
+			stage = StageCache::Stage{nullptr, false, "this stage is not supported by the context"};
+		else {
+			StageCache::SPShader sh(new QOpenGLShader(c_shaderType[type]));
+			bool bOk;
+			{
+				ScopedTiming st(timing, Phase::CompileOf(type));
+				bOk = sh->compileSourceCode(src);
+			}
+			stage = StageCache::Stage{sh, bOk, sh->log()};
+		}
+		_stage.store(key, stage);
+		return stage;
+	}
+	StageCache::Stat Compiler::stageStat() const {
+		return _stage.stat();
+	}
+	CompileResult Compiler::_compile(const ProgramSource& src, const CancelFn& cancel, UPProgram* prog) {
+		CompileResult res;
+		const auto fnCancel = [&res, &cancel]() {
+			if(cancel && cancel())
+				res.bCanceled = true;
+			return res.bCanceled;
+		};
+		// キャッシュから追い出されてもリンクが終わるまで保持する
+		std::vector<StageCache::SPShader> shV;
+		bool bOk = true;
+		int nStage = 0;
+		for(int i=0 ; i<Shader::_Num ; i++) {
+			auto type = static_cast<Shader::Type>(i);
+			if(!src.has(type))
+				continue;
+			if(fnCancel())
+				return res;
+			++nStage;
+			const StageCache::Stage stage = _compileStage(type, src.source[i], res.timing);
+			// 失敗しても他のステージのエラーも出せるよう続ける
+			if(!stage.bOk)
+				bOk = false;
+			if(!stage.log.isEmpty())
+				res.log.append(StageLog(GetStageName(type), stage.log));
+			if(stage.shader)
+				shV.push_back(stage.shader);
+		}
+		if(nStage == 0) {
+			res.log.append("no shader source");
+			return res;
+		}
+		if(!bOk)
+			return res;
+		if(src.has(Shader::Compute) && nStage > 1) {
+			res.log.append(StageLog("Link", "a compute shader can't be linked with other stages"));
+			return res;
+		}
+
+		if(fnCancel())
+			return res;
+		UPProgram p(new QOpenGLShaderProgram);
+		for(auto& sh : shV)
+			p->addShader(sh.get());
+		if(hasProgramBinary())
+			_programParameteri(p->programId(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		res.bLinked = true;
+		{
+			ScopedTiming st(res.timing, Phase::Link);
+			res.bSuccess = p->link();
+		}
+		if(!p->log().isEmpty())
+			res.log.append(StageLog("Link", p->log()));
+		if(res.bSuccess) {
+			ScopedTiming st(res.timing, Phase::Reflect);
+			res.reflection = _reflector.reflect(p->programId());
+			if(hasProgramBinary())
+				_readBinary(p->programId(), res.binary);
+		}
+		if(res.bSuccess && prog)
+			*prog = std::move(p);
+		return res;
+	}
+	const DriverInfo& Compiler::driverInfo() const {
+		return _driver;
+	}
+}
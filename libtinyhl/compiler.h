@@ -0,0 +1,108 @@
+#pragma once
+#include "glsl.h"
+#include "reflection.h"
+#include "stagecache.h"
+#include "timing.h"
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QOpenGLShaderProgram>
+#include <functional>
+#include <memory>
+#include <vector>
+
+class QDataStream;
+namespace glsl {
+	class CompileCache;
+	//! プログラムを構成するステージ毎のソース
+	struct ProgramSource {
+		QString		source[Shader::_Num];
+		//! ソース文字列番号に対応するファイル名 (Preprocessorが設定する。空ならログをそのまま返す)
+		QStringList	files;
+		//! ソースが空でないステージか
+		bool has(Shader::Type type) const;
+	};
+	//! glGetProgramBinaryで取り出したリンク済みプログラム
+	struct ProgramBinary {
+		GLenum		format = 0;
+		QByteArray	data;		//!< 取得できなかったら空
+	};
+	//! コンパイル・リンク結果
+	struct CompileResult {
+		bool		bSuccess = false;	//!< 全ステージのコンパイルとリンクが成功したか
+		bool		bLinked = false;	//!< リンクまで進んだか
+		bool		bCanceled = false;	//!< 途中で打ち切ったか (キャッシュには置かない)
+		QString		log;				//!< ドライバが出力したログ (エラー・警告)
+		Reflection	reflection;
+		ProgramBinary	binary;		//!< CompileCacheに置くバイナリ (compileが返す結果では空)
+		Timing		timing;				//!< 今回の工程毎の処理時間 (キャッシュには置かない)
+
+		//! CompileCache用に書き出す
+		void serialize(QDataStream& ds) const;
+		//! \return データが壊れていればfalse
+		bool deserialize(QDataStream& ds);
+	};
+	//! OpenGLドライバの識別情報
+	struct DriverInfo {
+		QString		vendor,
+					renderer,
+					version;
+	};
+	//! trueを返したらコンパイルを打ち切る (各ステージのコンパイルとリンクの前に呼ぶ)
+	using CancelFn = std::function<bool ()>;
+	//! カレントのOpenGLコンテキストでシェーダーをコンパイル・リンクし、変数情報を取得する
+	/*! キャッシュにヒットしたプログラムはコンパイルもリンクもせずに結果を返す(キーにドライバ情報を含む)。
+		GL4.1又はGL_ARB_get_program_binaryがあればリンク済みプログラムのバイナリもキャッシュに置き、
+		ヒット時はglProgramBinaryで復元できた場合だけキャッシュの結果を使う。
+		ドライバが受け付けなければ(更新されたなど)コンパイルし直してキャッシュを更新する。
+		コンパイルしたステージはStageCacheに置き、同じソースのステージを使う他のプログラムでも使い回す
+		(リンクはプログラム毎に行うので、ステージ間の整合性の検査は変わらない)。
+		使用中はコンストラクタを呼んだ時と同じコンテキストがカレントであること */
+	class Compiler : protected QOpenGLFunctions {
+		typedef void (QOPENGLF_APIENTRYP ProgramParameteri)(GLuint program, GLenum pname, GLint value);
+		typedef void (QOPENGLF_APIENTRYP GetProgramBinary)(GLuint program, GLsizei bufSize, GLsizei* length,
+															GLenum* binaryFormat, void* binary);
+		typedef void (QOPENGLF_APIENTRYP ProgramBinaryF)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+		ProgramParameteri	_programParameteri = nullptr;
+		GetProgramBinary	_getProgramBinary = nullptr;
+		ProgramBinaryF		_programBinary = nullptr;
+
+		DriverInfo		_driver;
+		Reflector		_reflector;
+		StageCache		_stage;
+		CompileCache*	_cache = nullptr;
+		using UPProgram = std::unique_ptr<QOpenGLShaderProgram>;
+		//! ステージをコンパイルする (同じソースをコンパイル済みならそれを返す)
+		StageCache::Stage _compileStage(Shader::Type type, const QString& src, Timing& timing);
+		//! キャッシュを使わずにコンパイル・リンクする
+		/*! \param[out] prog nullptrでなければリンクに成功したプログラムを受け取る */
+		CompileResult _compile(const ProgramSource& src, const CancelFn& cancel, UPProgram* prog);
+		//! リンク済みプログラムのバイナリを取り出す
+		void _readBinary(GLuint prog, ProgramBinary& dst);
+		//! バイナリからプログラムを復元する
+		/*! \return ドライバが受け付けなければnullptr */
+		UPProgram _restore(const ProgramBinary& bin);
+		//! キャッシュを引いて、無いか復元できなければコンパイルする
+		CompileResult _lookup(const ProgramSource& src, const CancelFn& cancel, UPProgram* prog);
+		public:
+			Compiler();
+			//! 結果をキャッシュする (nullptrで無効, 所有はしない)
+			void setCache(CompileCache* cache);
+			//! ソースが空でない全ステージをコンパイルし、1つのプログラムとしてリンクする
+			/*! キャッシュが設定されていて、同じソースとドライバの結果があればそれを返す。
+				src.filesがあればログのソース文字列番号をファイル名に置き換える
+				\param[in] cancel	指定すれば途中で呼び、trueならbCanceledを立てた結果を返す */
+			CompileResult compile(const ProgramSource& src, const CancelFn& cancel = CancelFn());
+			//! compileと同じだが、リンク済みのプログラムも返す
+			/*! キャッシュにバイナリがあればコンパイル・リンクせずに復元する
+				\return リンクに失敗したか打ち切ったらnullptr */
+			std::unique_ptr<QOpenGLShaderProgram> compileProgram(const ProgramSource& src, CompileResult& res,
+																	const CancelFn& cancel = CancelFn());
+			//! プログラムバイナリを扱えるか
+			bool hasProgramBinary() const;
+			//! ステージの使い回しの状況
+			StageCache::Stat stageStat() const;
+			//! カレントコンテキストのドライバ情報
+			const DriverInfo& driverInfo() const;
+	};
+}
@@ -1,50 +1,170 @@
 #include "glsl.h"
+#include <unordered_map>
 
 namespace glsl {
 	namespace {
-		std::pair<GLenum, const char*> c_valueType[] = {
-			{GL_FLOAT, "GL_FLOAT"},
-			{GL_FLOAT_VEC2, "GL_FLOAT_VEC2"},
-			{GL_FLOAT_VEC3, "GL_FLOAT_VEC3"},
-			{GL_FLOAT_VEC4, "GL_FLOAT_VEC4"},
-			{GL_FLOAT_MAT2, "GL_FLOAT_MAT2"},
-			{GL_FLOAT_MAT3, "GL_FLOAT_MAT3"},
-			{GL_FLOAT_MAT4, "GL_FLOAT_MAT4"},
-			{GL_FLOAT_MAT2x3, "GL_FLOAT_MAT2x3"},
-			{GL_FLOAT_MAT2x4, "GL_FLOAT_MAT2x4"},
-			{GL_FLOAT_MAT3x2, "GL_FLOAT_MAT3x2"},
-			{GL_FLOAT_MAT3x4, "GL_FLOAT_MAT3x4"},
-			{GL_FLOAT_MAT4x2, "GL_FLOAT_MAT4x2"},
-			{GL_FLOAT_MAT4x3, "GL_FLOAT_MAT4x3"},
-			{GL_INT, "GL_INT"},
-			{GL_INT_VEC2, "GL_INT_VEC2"},
-			{GL_INT_VEC3, "GL_INT_VEC3"},
-			{GL_INT_VEC4, "GL_INT_VEC4"},
-			{GL_UNSIGNED_INT, "GL_UNSIGNED_INT"},
-			{GL_UNSIGNED_INT_VEC2, "GL_UNSIGNED_INT_VEC2"},
-			{GL_UNSIGNED_INT_VEC3, "GL_UNSIGNED_INT_VEC3"},
-			{GL_UNSIGNED_INT_VEC4, "GL_UNSIGNED_INT_VEC4"},
-			{GL_DOUBLE, "GL_DOUBLE"},
-			{GL_DOUBLE_VEC2, "GL_DOUBLE_VEC2"},
-			{GL_DOUBLE_VEC3, "GL_DOUBLE_VEC3"},
-			{GL_DOUBLE_VEC4, "GL_DOUBLE_VEC4"},
-			{GL_DOUBLE_MAT2, "GL_DOUBLE_MAT2"},
-			{GL_DOUBLE_MAT3, "GL_DOUBLE_MAT3"},
-			{GL_DOUBLE_MAT4, "GL_DOUBLE_MAT4"},
-			{GL_DOUBLE_MAT2x3, "GL_DOUBLE_MAT2x3"},
-			{GL_DOUBLE_MAT2x4, "GL_DOUBLE_MAT2x4"},
-			{GL_DOUBLE_MAT3x2, "GL_DOUBLE_MAT3x2"},
-			{GL_DOUBLE_MAT3x4, "GL_DOUBLE_MAT3x4"},
-			{GL_DOUBLE_MAT4x2, "GL_DOUBLE_MAT4x2"},
-			{GL_DOUBLE_MAT4x3, "GL_DOUBLE_MAT4x3"}
+#define DEF_TYPE(e, name)	{e, #e, #name}
+		const ValueType c_valueType[] = {
+			DEF_TYPE(GL_FLOAT, float),
+			DEF_TYPE(GL_FLOAT_VEC2, vec2),
+			DEF_TYPE(GL_FLOAT_VEC3, vec3),
+			DEF_TYPE(GL_FLOAT_VEC4, vec4),
+			DEF_TYPE(GL_FLOAT_MAT2, mat2),
+			DEF_TYPE(GL_FLOAT_MAT3, mat3),
+			DEF_TYPE(GL_FLOAT_MAT4, mat4),
+			DEF_TYPE(GL_FLOAT_MAT2x3, mat2x3),
+			DEF_TYPE(GL_FLOAT_MAT2x4, mat2x4),
+			DEF_TYPE(GL_FLOAT_MAT3x2, mat3x2),
+			DEF_TYPE(GL_FLOAT_MAT3x4, mat3x4),
+			DEF_TYPE(GL_FLOAT_MAT4x2, mat4x2),
+			DEF_TYPE(GL_FLOAT_MAT4x3, mat4x3),
+			DEF_TYPE(GL_INT, int),
+			DEF_TYPE(GL_INT_VEC2, ivec2),
+			DEF_TYPE(GL_INT_VEC3, ivec3),
+			DEF_TYPE(GL_INT_VEC4, ivec4),
+			DEF_TYPE(GL_UNSIGNED_INT, uint),
+			DEF_TYPE(GL_UNSIGNED_INT_VEC2, uvec2),
+			DEF_TYPE(GL_UNSIGNED_INT_VEC3, uvec3),
+			DEF_TYPE(GL_UNSIGNED_INT_VEC4, uvec4),
+			DEF_TYPE(GL_BOOL, bool),
+			DEF_TYPE(GL_BOOL_VEC2, bvec2),
+			DEF_TYPE(GL_BOOL_VEC3, bvec3),
+			DEF_TYPE(GL_BOOL_VEC4, bvec4),
+			DEF_TYPE(GL_DOUBLE, double),
+			DEF_TYPE(GL_DOUBLE_VEC2, dvec2),
+			DEF_TYPE(GL_DOUBLE_VEC3, dvec3),
+			DEF_TYPE(GL_DOUBLE_VEC4, dvec4),
+			DEF_TYPE(GL_DOUBLE_MAT2, dmat2),
+			DEF_TYPE(GL_DOUBLE_MAT3, dmat3),
+			DEF_TYPE(GL_DOUBLE_MAT4, dmat4),
+			DEF_TYPE(GL_DOUBLE_MAT2x3, dmat2x3),
+			DEF_TYPE(GL_DOUBLE_MAT2x4, dmat2x4),
+			DEF_TYPE(GL_DOUBLE_MAT3x2, dmat3x2),
+			DEF_TYPE(GL_DOUBLE_MAT3x4, dmat3x4),
+			DEF_TYPE(GL_DOUBLE_MAT4x2, dmat4x2),
+			DEF_TYPE(GL_DOUBLE_MAT4x3, dmat4x3),
+			DEF_TYPE(GL_SAMPLER_1D, sampler1D),
+			DEF_TYPE(GL_SAMPLER_2D, sampler2D),
+			DEF_TYPE(GL_SAMPLER_3D, sampler3D),
+			DEF_TYPE(GL_SAMPLER_CUBE, samplerCube),
+			DEF_TYPE(GL_SAMPLER_1D_ARRAY, sampler1DArray),
+			DEF_TYPE(GL_SAMPLER_2D_ARRAY, sampler2DArray),
+			DEF_TYPE(GL_SAMPLER_2D_MULTISAMPLE, sampler2DMS),
+			DEF_TYPE(GL_SAMPLER_2D_MULTISAMPLE_ARRAY, sampler2DMSArray),
+			DEF_TYPE(GL_SAMPLER_BUFFER, samplerBuffer),
+			DEF_TYPE(GL_SAMPLER_2D_RECT, sampler2DRect),
+			DEF_TYPE(GL_SAMPLER_CUBE_MAP_ARRAY, samplerCubeArray),
+			DEF_TYPE(GL_SAMPLER_1D_SHADOW, sampler1DShadow),
+			DEF_TYPE(GL_SAMPLER_2D_SHADOW, sampler2DShadow),
+			DEF_TYPE(GL_SAMPLER_1D_ARRAY_SHADOW, sampler1DArrayShadow),
+			DEF_TYPE(GL_SAMPLER_2D_ARRAY_SHADOW, sampler2DArrayShadow),
+			DEF_TYPE(GL_SAMPLER_CUBE_SHADOW, samplerCubeShadow),
+			DEF_TYPE(GL_SAMPLER_2D_RECT_SHADOW, sampler2DRectShadow),
+			DEF_TYPE(GL_SAMPLER_CUBE_MAP_ARRAY_SHADOW, samplerCubeArrayShadow),
+			DEF_TYPE(GL_INT_SAMPLER_1D, isampler1D),
+			DEF_TYPE(GL_INT_SAMPLER_2D, isampler2D),
+			DEF_TYPE(GL_INT_SAMPLER_3D, isampler3D),
+			DEF_TYPE(GL_INT_SAMPLER_CUBE, isamplerCube),
+			DEF_TYPE(GL_INT_SAMPLER_1D_ARRAY, isampler1DArray),
+			DEF_TYPE(GL_INT_SAMPLER_2D_ARRAY, isampler2DArray),
+			DEF_TYPE(GL_INT_SAMPLER_2D_MULTISAMPLE, isampler2DMS),
+			DEF_TYPE(GL_INT_SAMPLER_2D_MULTISAMPLE_ARRAY, isampler2DMSArray),
+			DEF_TYPE(GL_INT_SAMPLER_BUFFER, isamplerBuffer),
+			DEF_TYPE(GL_INT_SAMPLER_2D_RECT, isampler2DRect),
+			DEF_TYPE(GL_INT_SAMPLER_CUBE_MAP_ARRAY, isamplerCubeArray),
+			DEF_TYPE(GL_UNSIGNED_INT_SAMPLER_1D, usampler1D),
+			DEF_TYPE(GL_UNSIGNED_INT_SAMPLER_2D, usampler2D),
+			DEF_TYPE(GL_UNSIGNED_INT_SAMPLER_3D, usampler3D),
+			DEF_TYPE(GL_UNSIGNED_INT_SAMPLER_CUBE, usamplerCube),
+			DEF_TYPE(GL_UNSIGNED_INT_SAMPLER_1D_ARRAY, usampler1DArray),
+			DEF_TYPE(GL_UNSIGNED_INT_SAMPLER_2D_ARRAY, usampler2DArray),
+			DEF_TYPE(GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE, usampler2DMS),
+			DEF_TYPE(GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE_ARRAY, usampler2DMSArray),
+			DEF_TYPE(GL_UNSIGNED_INT_SAMPLER_BUFFER, usamplerBuffer),
+			DEF_TYPE(GL_UNSIGNED_INT_SAMPLER_2D_RECT, usampler2DRect),
+			DEF_TYPE(GL_UNSIGNED_INT_SAMPLER_CUBE_MAP_ARRAY, usamplerCubeArray),
+			DEF_TYPE(GL_IMAGE_1D, image1D),
+			DEF_TYPE(GL_IMAGE_2D, image2D),
+			DEF_TYPE(GL_IMAGE_3D, image3D),
+			DEF_TYPE(GL_IMAGE_2D_RECT, image2DRect),
+			DEF_TYPE(GL_IMAGE_CUBE, imageCube),
+			DEF_TYPE(GL_IMAGE_BUFFER, imageBuffer),
+			DEF_TYPE(GL_IMAGE_1D_ARRAY, image1DArray),
+			DEF_TYPE(GL_IMAGE_2D_ARRAY, image2DArray),
+			DEF_TYPE(GL_IMAGE_CUBE_MAP_ARRAY, imageCubeArray),
+			DEF_TYPE(GL_IMAGE_2D_MULTISAMPLE, image2DMS),
+			DEF_TYPE(GL_IMAGE_2D_MULTISAMPLE_ARRAY, image2DMSArray),
+			DEF_TYPE(GL_INT_IMAGE_1D, iimage1D),
+			DEF_TYPE(GL_INT_IMAGE_2D, iimage2D),
+			DEF_TYPE(GL_INT_IMAGE_3D, iimage3D),
+			DEF_TYPE(GL_INT_IMAGE_2D_RECT, iimage2DRect),
+			DEF_TYPE(GL_INT_IMAGE_CUBE, iimageCube),
+			DEF_TYPE(GL_INT_IMAGE_BUFFER, iimageBuffer),
+			DEF_TYPE(GL_INT_IMAGE_1D_ARRAY, iimage1DArray),
+			DEF_TYPE(GL_INT_IMAGE_2D_ARRAY, iimage2DArray),
+			DEF_TYPE(GL_INT_IMAGE_CUBE_MAP_ARRAY, iimageCubeArray),
+			DEF_TYPE(GL_INT_IMAGE_2D_MULTISAMPLE, iimage2DMS),
+			DEF_TYPE(GL_INT_IMAGE_2D_MULTISAMPLE_ARRAY, iimage2DMSArray),
+			DEF_TYPE(GL_UNSIGNED_INT_IMAGE_1D, uimage1D),
+			DEF_TYPE(GL_UNSIGNED_INT_IMAGE_2D, uimage2D),
+			DEF_TYPE(GL_UNSIGNED_INT_IMAGE_3D, uimage3D),
+			DEF_TYPE(GL_UNSIGNED_INT_IMAGE_2D_RECT, uimage2DRect),
+			DEF_TYPE(GL_UNSIGNED_INT_IMAGE_CUBE, uimageCube),
+			DEF_TYPE(GL_UNSIGNED_INT_IMAGE_BUFFER, uimageBuffer),
+			DEF_TYPE(GL_UNSIGNED_INT_IMAGE_1D_ARRAY, uimage1DArray),
+			DEF_TYPE(GL_UNSIGNED_INT_IMAGE_2D_ARRAY, uimage2DArray),
+			DEF_TYPE(GL_UNSIGNED_INT_IMAGE_CUBE_MAP_ARRAY, uimageCubeArray),
+			DEF_TYPE(GL_UNSIGNED_INT_IMAGE_2D_MULTISAMPLE, uimage2DMS),
+			DEF_TYPE(GL_UNSIGNED_INT_IMAGE_2D_MULTISAMPLE_ARRAY, uimage2DMSArray),
+			DEF_TYPE(GL_UNSIGNED_INT_ATOMIC_COUNTER, atomic_uint)
 		};
+#undef DEF_TYPE
+	}
+	const ValueType* GetValueType(GLenum type) {
+		// 値が飛び飛びなので、初回に表から引けるようにしておく
+		static const std::unordered_map<GLenum, const ValueType*> c_map = [](){
+			std::unordered_map<GLenum, const ValueType*> m;
+			for(auto& t : c_valueType)
+				m.emplace(t.type, &t);
+			return m;
+		}();
+		auto itr = c_map.find(type);
+		return itr != c_map.end() ? itr->second : nullptr;
 	}
 	const char* GetValueTypeStr(GLenum type) {
-		for(auto& p : c_valueType) {
-			if(p.first == type)
-				return p.second;
+		auto* t = GetValueType(type);
+		return t ? t->name : nullptr;
+	}
+	namespace {
+		const char* c_stageName[Shader::_Num] = {
+			"Vertex",
+			"Fragment",
+			"Geometry",
+			"TessControl",
+			"TessEvaluation",
+			"Compute"
+		};
+		const char* c_stageExt[Shader::_Num] = {
+			"vsh",
+			"fsh",
+			"gsh",
+			"tcsh",
+			"tesh",
+			"csh"
+		};
+	}
+	const char* GetStageName(Shader::Type type) {
+		return c_stageName[type];
+	}
+	const char* GetStageExtension(Shader::Type type) {
+		return c_stageExt[type];
+	}
+	Shader::Type GetStageFromPath(const QString& path) {
+		for(int i=0 ; i<Shader::_Num ; i++) {
+			if(path.endsWith(QString(".") + c_stageExt[i]))
+				return static_cast<Shader::Type>(i);
 		}
-		return nullptr;
+		return Shader::_Num;
 	}
 	// ------------------ MissingEntry ------------------
 	MissingEntry::MissingEntry(const QString& entName):
@@ -3,10 +3,15 @@
 
 namespace glsl {
 	//! シェーダー種別
+	/*! 値はGUIのタブの並びを兼ねるので、新しい種別は末尾に足す */
 	struct Shader {
 		enum Type {
 			Vertex,
 			Fragment,
+			Geometry,
+			TessControl,
+			TessEvaluation,
+			Compute,		//!< 他のステージとはリンクできない
 			_Num
 		};
 	};
@@ -18,6 +23,22 @@ namespace glsl {
 		public:
 			InvalidFormat(const QString& entName, const QString& type);
 	};
+	//! GLSLの値の型
+	struct ValueType {
+		GLenum		type;
+		const char	*name,		//!< Enum値の名前 (GL_FLOAT_VEC3)
+					*glslName;	//!< GLSLでの型名 (vec3)
+	};
+	//! GLSL値フォーマットを示すEnum値の情報を取得
+	/*! \return 表に無い値ならnullptr */
+	const ValueType* GetValueType(GLenum type);
 	//! GLSL値フォーマットを示すEnum値の文字列表現を取得
 	const char* GetValueTypeStr(GLenum type);
+	//! シェーダー種別の名前を取得
+	const char* GetStageName(Shader::Type type);
+	//! シェーダー種別に対応するファイル拡張子を取得 (ドット無し)
+	const char* GetStageExtension(Shader::Type type);
+	//! ファイルパスの拡張子からシェーダー種別を判定
+	/*! \return 該当する種別が無ければShader::_Num */
+	Shader::Type GetStageFromPath(const QString& path);
 }
@@ -0,0 +1,95 @@
+#include "keywordindex.h"
+#include <algorithm>
+
+namespace glsl {
+	KeywordIndex::KeywordIndex() {
+		clear();
+	}
+	void KeywordIndex::clear() {
+		_node.clear();
+		_edge.clear();
+		_terminal.clear();
+		std::fill(_bFirstChar, _bFirstChar+128, false);
+		_bAllAutoSpacing = true;
+	}
+	bool KeywordIndex::empty() const {
+		return _terminal.empty();
+	}
+	uint32_t KeywordIndex::_child(uint32_t node, uint16_t ch) const {
+		const Node& n = _node[node];
+		auto* beg = _edge.data() + n.edgeBegin;
+		auto* end = beg + n.edgeCount;
+		auto* itr = std::lower_bound(beg, end, ch, [](const Edge& e, uint16_t c){
+			return e.ch < c;
+		});
+		if(itr != end && itr->ch == ch)
+			return itr->target;
+		// ノード0(ルート)へ戻る事は無いので0を「子が無い」として使う
+		return 0;
+	}
+	template <class Ch>
+	int KeywordIndex::_longestAt(BasicTextView<Ch> text, size_t pos, const CharTable& table, int& category) const {
+		if(_node.empty())
+			return -1;
+		// キーワード手前が境界かどうかは位置で決まるので先に調べておく
+		const bool bLeftOk = (pos == 0 || !table.isLetterOrNumber(PrevChar(text, pos)));
+		int best = -1;
+		for(uint32_t root=0 ; root<_NumRoot ; root++) {
+			uint32_t cur = root;
+			for(size_t i=pos ; i<text.size ; ) {
+				char16_t u[2];
+				const int nu = ToUtf16(NextChar(text, i), u);
+				bool bEdge = true;
+				for(int k=0 ; k<nu && bEdge ; k++) {
+					cur = _child(cur, root==CaseSensitive ? u[k] : table.fold(u[k]));
+					bEdge = (cur != 0);
+				}
+				if(!bEdge)
+					break;
+				const int32_t ti = _node[cur].terminal;
+				if(ti >= 0) {
+					const Terminal& t = _terminal[ti];
+					// auto_spacingフラグが立っている時はキーワードの両側が非wordかをチェック
+					if(t.bAutoSpacing) {
+						if(!bLeftOk || (i < text.size && table.isLetterOrNumber(PeekChar(text, i))))
+							continue;
+					}
+					const int len = int(i - pos);
+					if(best < len) {
+						best = len;
+						category = t.category;
+					}
+				}
+			}
+		}
+		return best;
+	}
+	template <class Ch>
+	MatchHit KeywordIndex::find(BasicTextView<Ch> text, size_t offset, const CharTable& table) const {
+		for(size_t i=offset ; i<text.size ; ) {
+			const uint32_t u = UnitOf(text.data[i]);
+			size_t next = i+1;
+			if(u < 0x80) {
+				// どのキーワードの先頭にもならない文字は飛ばす
+				if(!_bFirstChar[u]) {
+					i = next;
+					continue;
+				}
+			} else {
+				next = i;
+				NextChar(text, next);
+			}
+			// 全てauto_spacing指定なら単語の途中から始まるキーワードは有り得ない
+			if(!(_bAllAutoSpacing && i > 0 && table.isLetterOrNumber(PrevChar(text, i)))) {
+				int category;
+				const int len = _longestAt(text, i, table, category);
+				if(len >= 0)
+					return MatchHit{int(i), len, category};
+			}
+			i = next;
+		}
+		return MatchHit{-1, -1, -1};
+	}
+	template MatchHit KeywordIndex::find(U8View, size_t, const CharTable&) const;
+	template MatchHit KeywordIndex::find(U16View, size_t, const CharTable&) const;
+}
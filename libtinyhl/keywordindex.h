@@ -0,0 +1,78 @@
+#pragma once
+#include "matcher.h"
+#include <vector>
+#include <cstdint>
+
+namespace glsl {
+	class KeywordTrie;
+	//! 構築済みのキーワード検索表 (KeywordTrieの検索部分)
+	/*! 構築と保存はKeywordTrieが行う。辺はUTF-16の単位なので、UTF-8の入力は1文字ずつUTF-16に直して辿る */
+	class KeywordIndex {
+		friend class KeywordTrie;
+		public:
+			//! 終端ノードに付与するキーワード情報
+			struct Terminal {
+				int		category,		//!< 所属するカテゴリ番号
+						length;			//!< キーワード長 (UTF-16)
+				bool	bAutoSpacing;	//!< キーワード前後の非wordを想定するか
+			};
+		private:
+			//! ノード (子は_edgeの[edgeBegin, edgeBegin+edgeCount)に文字順で並ぶ)
+			struct Node {
+				uint32_t	edgeBegin;
+				uint16_t	edgeCount;
+				int32_t		terminal;	//!< _terminalのインデックス (負数は非終端)
+			};
+			struct Edge {
+				uint16_t	ch;
+				uint32_t	target;
+			};
+			// ルートは大文字小文字を区別する側(0)としない側(1)の2つ
+			enum Root : uint32_t {
+				CaseSensitive,
+				CaseInsensitive,
+				_NumRoot
+			};
+			using NodeV = std::vector<Node>;
+			using EdgeV = std::vector<Edge>;
+			using TermV = std::vector<Terminal>;
+
+			NodeV		_node;
+			EdgeV		_edge;
+			TermV		_terminal;
+			//! キーワード先頭に成り得るASCII文字 (非ASCIIは常に候補とする)
+			bool		_bFirstChar[128];
+			//! 全てのキーワードがauto_spacing指定か
+			bool		_bAllAutoSpacing;
+
+			uint32_t _child(uint32_t node, uint16_t ch) const;
+			//! text[pos]から始まる最長のキーワードを探す
+			/*! \return 一致した長さ (見つからなければ負数) */
+			template <class Ch>
+			int _longestAt(BasicTextView<Ch> text, size_t pos, const CharTable& table, int& category) const;
+		public:
+			KeywordIndex();
+			void clear();
+			bool empty() const;
+			//! offset以降で最も手前にあるキーワードを探す
+			/*! 同じ位置なら長い方を採用
+				\param[in] table	auto_spacingの境界判定と大文字小文字の畳み込みに使う表 */
+			template <class Ch>
+			MatchHit find(BasicTextView<Ch> text, size_t offset, const CharTable& table) const;
+	};
+	//! KeywordIndexをBasicMatcherとして使う
+	template <class Ch>
+	class BasicKeywordMatcher : public BasicMatcher<Ch> {
+		using View = BasicTextView<Ch>;
+		const KeywordIndex&	_index;
+		const CharTable&	_table;
+		public:
+			BasicKeywordMatcher(const KeywordIndex& index, const CharTable& table):
+				_index(index),
+				_table(table)
+			{}
+			MatchHit find(View line, int offset, uint64_t /*lineId*/) const override {
+				return _index.find(line, offset, _table);
+			}
+	};
+}
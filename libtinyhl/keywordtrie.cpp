@@ -0,0 +1,176 @@
+#include "keywordtrie.h"
+#include <QDataStream>
+#include <QIODevice>
+#include <algorithm>
+
+namespace glsl {
+	KeywordTrie::KeywordTrie() {
+		clear();
+	}
+	void KeywordTrie::clear() {
+		_build.clear();
+		_build.resize(KeywordIndex::_NumRoot);
+		_index.clear();
+	}
+	uint16_t KeywordTrie::_Fold(QChar c) {
+		const uint16_t u = c.unicode();
+		// ASCIIは表引きせずに変換
+		if(u < 0x80) {
+			if(u >= 'A' && u <= 'Z')
+				return u - 'A' + 'a';
+			return u;
+		}
+		return c.toCaseFolded().unicode();
+	}
+	void KeywordTrie::add(const QString& word, int category, bool bCaseSensitive, bool bAutoSpacing) {
+		if(word.isEmpty())
+			return;
+		uint32_t cur = bCaseSensitive ? KeywordIndex::CaseSensitive : KeywordIndex::CaseInsensitive;
+		for(QChar c : word) {
+			const uint16_t ch = bCaseSensitive ? c.unicode() : _Fold(c);
+			auto& ch_v = _build[cur].child;
+			auto itr = std::find_if(ch_v.begin(), ch_v.end(), [ch](const std::pair<uint16_t,uint32_t>& p){
+				return p.first == ch;
+			});
+			if(itr != ch_v.end())
+				cur = itr->second;
+			else {
+				uint32_t next = _build.size();
+				// push_backで参照が無効になるので先に子を登録
+				ch_v.emplace_back(ch, next);
+				_build.emplace_back();
+				cur = next;
+			}
+		}
+		// 同じ綴りが複数カテゴリにあれば先に登録された方を優先
+		auto& term = _index._terminal;
+		if(_build[cur].terminal < 0) {
+			_build[cur].terminal = term.size();
+			term.push_back(KeywordIndex::Terminal{category, word.length(), bAutoSpacing});
+		}
+		// 先頭文字の候補を記録 (大文字小文字を区別しない場合は両方)
+		const uint16_t c0 = bCaseSensitive ? word.at(0).unicode() : _Fold(word.at(0));
+		if(c0 < 0x80) {
+			_index._bFirstChar[c0] = true;
+			if(!bCaseSensitive && c0 >= 'a' && c0 <= 'z')
+				_index._bFirstChar[c0 - 'a' + 'A'] = true;
+		}
+		_index._bAllAutoSpacing &= bAutoSpacing;
+	}
+	void KeywordTrie::build() {
+		_flatten();
+	}
+	void KeywordTrie::_flatten() {
+		auto& node = _index._node;
+		auto& edge = _index._edge;
+		node.resize(_build.size());
+		edge.clear();
+		for(uint32_t i=0 ; i<_build.size() ; i++) {
+			auto& b = _build[i];
+			// 二分探索できるよう文字順に並べる
+			std::sort(b.child.begin(), b.child.end());
+			KeywordIndex::Node& n = node[i];
+			n.edgeBegin = edge.size();
+			n.edgeCount = b.child.size();
+			n.terminal = b.terminal;
+			for(auto& c : b.child)
+				edge.push_back(KeywordIndex::Edge{c.first, c.second});
+		}
+		// 構築用の木はもう要らない
+		BuildNodeV().swap(_build);
+	}
+	bool KeywordTrie::empty() const {
+		return _index.empty();
+	}
+	const KeywordIndex& KeywordTrie::index() const {
+		return _index;
+	}
+	namespace {
+		// 構造体のパディングやエンディアンに依らないよう、要素はメンバ毎に書き出す
+		template <class T, class F>
+		void WriteArray(QDataStream& ds, const std::vector<T>& v, F write) {
+			ds << quint32(v.size());
+			for(auto& e : v)
+				write(e);
+		}
+		/*! \param[in] unit	1要素の書き出し後のバイト数 */
+		template <class T, class F>
+		bool ReadArray(QDataStream& ds, std::vector<T>& v, int unit, F read) {
+			quint32 n;
+			ds >> n;
+			if(ds.status() != QDataStream::Ok)
+				return false;
+			// 壊れた要素数で巨大な確保をしないよう残りのデータ量と比べる
+			if(ds.device() && qint64(n)*unit > ds.device()->bytesAvailable())
+				return false;
+			v.resize(n);
+			for(auto& e : v)
+				read(e);
+			return ds.status() == QDataStream::Ok;
+		}
+	}
+	void KeywordTrie::serialize(QDataStream& ds) const {
+		const KeywordIndex& ix = _index;
+		WriteArray(ds, ix._node, [&ds](const KeywordIndex::Node& n){
+			ds << quint32(n.edgeBegin) << quint16(n.edgeCount) << qint32(n.terminal);
+		});
+		WriteArray(ds, ix._edge, [&ds](const KeywordIndex::Edge& e){
+			ds << quint16(e.ch) << quint32(e.target);
+		});
+		WriteArray(ds, ix._terminal, [&ds](const KeywordIndex::Terminal& t){
+			ds << qint32(t.category) << qint32(t.length) << t.bAutoSpacing;
+		});
+		for(bool b : ix._bFirstChar)
+			ds << b;
+		ds << ix._bAllAutoSpacing;
+	}
+	bool KeywordTrie::deserialize(QDataStream& ds, int nCategory) {
+		clear();
+		BuildNodeV().swap(_build);
+		KeywordIndex& ix = _index;
+		const bool bOk =
+			ReadArray(ds, ix._node, 4+2+4, [&ds](KeywordIndex::Node& n){
+				quint32 begin;
+				quint16 count;
+				qint32 term;
+				ds >> begin >> count >> term;
+				n = KeywordIndex::Node{begin, count, term};
+			}) &&
+			ReadArray(ds, ix._edge, 2+4, [&ds](KeywordIndex::Edge& e){
+				quint16 ch;
+				quint32 target;
+				ds >> ch >> target;
+				e = KeywordIndex::Edge{ch, target};
+			}) &&
+			ReadArray(ds, ix._terminal, 4+4+1, [&ds](KeywordIndex::Terminal& t){
+				qint32 category, length;
+				bool bAutoSpacing;
+				ds >> category >> length >> bAutoSpacing;
+				t = KeywordIndex::Terminal{category, length, bAutoSpacing};
+			});
+		if(!bOk)
+			return false;
+		for(bool& b : ix._bFirstChar)
+			ds >> b;
+		ds >> ix._bAllAutoSpacing;
+		// 壊れたデータや別の定義の物で範囲外を参照しないよう添字を検証
+		if(!ix._node.empty() && ix._node.size() < KeywordIndex::_NumRoot)
+			return false;
+		for(auto& n : ix._node) {
+			if(size_t(n.edgeBegin) + n.edgeCount > ix._edge.size())
+				return false;
+			if(n.terminal >= int32_t(ix._terminal.size()))
+				return false;
+		}
+		for(auto& e : ix._edge) {
+			// ルートへは戻らない
+			if(e.target < KeywordIndex::_NumRoot || e.target >= ix._node.size())
+				return false;
+		}
+		for(auto& t : ix._terminal) {
+			if(t.category < 0 || t.category >= nCategory || t.length <= 0)
+				return false;
+		}
+		return ds.status() == QDataStream::Ok;
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "keywordindex.h"
+#include <QString>
+#include <vector>
+#include <cstdint>
+
+class QDataStream;
+namespace glsl {
+	//! 全カテゴリの文字列キーワードを纏めたトライ木
+	/*! loadDefine時に一度だけ構築し、トークン長に比例した一回の探索で
+		どのカテゴリのキーワードかを判定する。検索はKeywordIndexで行う */
+	class KeywordTrie {
+		private:
+			//! 構築中のノード
+			struct BuildNode {
+				std::vector<std::pair<uint16_t, uint32_t>>	child;
+				int32_t		terminal = -1;
+			};
+			using BuildNodeV = std::vector<BuildNode>;
+
+			BuildNodeV		_build;
+			KeywordIndex	_index;
+
+			static uint16_t _Fold(QChar c);
+			//! 構築用ノードを検索用の配列に詰め直す
+			void _flatten();
+		public:
+			KeywordTrie();
+			void clear();
+			//! キーワードを登録
+			/*! 同じ綴りが既に登録されていれば先に登録した方を優先 */
+			void add(const QString& word, int category, bool bCaseSensitive, bool bAutoSpacing);
+			//! 登録したキーワードから検索用の表を作る
+			void build();
+			bool empty() const;
+			//! 構築済みの検索表
+			const KeywordIndex& index() const;
+			//! 構築済みの検索表を書き出す
+			void serialize(QDataStream& ds) const;
+			//! serializeで書き出した検索表を読み込む
+			/*! \param[in] nCategory	ルールセットのカテゴリ数 (範囲外のカテゴリ番号があれば失敗)
+				\return データが壊れていればfalse */
+			bool deserialize(QDataStream& ds, int nCategory);
+	};
+}
@@ -4,19 +4,63 @@
 #
 #-------------------------------------------------
 
-QT       += core gui opengl
+QT       += core gui opengl concurrent
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
 TARGET = tinyhl
 TEMPLATE = lib
 CONFIG += staticlib
 
-SOURCES += glctxnotify.cpp \
+SOURCES += asynccompiler.cpp \
+	    chartable.cpp \
+	    compilecache.cpp \
+	    compilepool.cpp \
+	    compiler.cpp \
+	    glctxnotify.cpp \
 	    glsl.cpp \
-	    syntaxhighlighter.cpp
-HEADERS += glctxnotify.h \
+	    keywordindex.cpp \
+	    keywordtrie.cpp \
+	    linehighlighter.cpp \
+	    matcher.cpp \
+	    offscreencontext.cpp \
+	    permutation.cpp \
+	    preprocessor.cpp \
+	    reflection.cpp \
+	    regexset.cpp \
+	    rulecache.cpp \
+	    ruleset.cpp \
+	    ruletokenizer.cpp \
+	    simdscan.cpp \
+	    stagecache.cpp \
+	    syntaxhighlighter.cpp \
+	    textview.cpp \
+	    timing.cpp \
+	    tokenizer.cpp
+HEADERS += asynccompiler.h \
+	    chartable.h \
+	    compilecache.h \
+	    compilepool.h \
+	    compiler.h \
+	    glctxnotify.h \
 	    glsl.h \
-	    syntaxhighlighter.h
+	    keywordindex.h \
+	    keywordtrie.h \
+	    linehighlighter.h \
+	    matcher.h \
+	    offscreencontext.h \
+	    permutation.h \
+	    preprocessor.h \
+	    reflection.h \
+	    regexset.h \
+	    rulecache.h \
+	    ruleset.h \
+	    ruletokenizer.h \
+	    simdscan.h \
+	    stagecache.h \
+	    syntaxhighlighter.h \
+	    textview.h \
+	    timing.h \
+	    tokenizer.h
 QMAKE_CXXFLAGS += -std=c++11
 
 unix {
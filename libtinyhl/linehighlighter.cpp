@@ -0,0 +1,68 @@
+#include "linehighlighter.h"
+#include <QThread>
+#include <QtConcurrent/QtConcurrentMap>
+#include <algorithm>
+
+namespace glsl {
+	namespace {
+		//! 並列処理で1チャンクに含める最低行数
+		const int c_minChunkLines = 256;
+	}
+	LineHighlighter::LineHighlighter(const SPRuleSet& rules):
+		_tokenizer(std::make_shared<RuleTokenizer>(rules))
+	{}
+	const SPRuleSet& LineHighlighter::ruleSet() const {
+		return _tokenizer->ruleSet();
+	}
+	const RuleTokenizer& LineHighlighter::tokenizer() const {
+		return *_tokenizer;
+	}
+	int LineHighlighter::highlight(const QString& text, int inState, SpanV& span) const {
+		return _tokenizer->utf16().tokenize(MakeView(text), inState, span);
+	}
+	int LineHighlighter::scanState(const QString& text, int inState) const {
+		return _tokenizer->utf16().scanState(MakeView(text), inState);
+	}
+	LineHighlighter::LineResultV LineHighlighter::highlightAll(const QStringList& lines) const {
+		const int n = lines.size();
+		LineResultV res(n);
+		if(n == 0)
+			return res;
+		struct Chunk {
+			int		begin,
+					end,
+					inState;	//!< 先頭行が受け取る状態
+		};
+		std::vector<Chunk> chunk;
+		// スレッド数より多めに分けて負荷を均す
+		const int nChunkLine = std::max(c_minChunkLines, n / (std::max(1, QThread::idealThreadCount()) * 4));
+		// 各チャンクの開始状態をコメントとディレクティブだけ見て先に求めておく
+		int state = 0;
+		for(int i=0 ; i<n ; i+=nChunkLine) {
+			const int end = std::min(n, i+nChunkLine);
+			chunk.push_back(Chunk{i, end, state});
+			for(int j=i ; j<end ; j++)
+				state = scanState(lines[j], state);
+		}
+		const auto fnRun = [this, &lines, &res](const Chunk& c) {
+			int st = c.inState;
+			for(int i=c.begin ; i<c.end ; i++) {
+				LineResult& r = res[i];
+				r.inState = st;
+				r.span.clear();
+				st = r.outState = highlight(lines[i], st, r.span);
+			}
+		};
+		QtConcurrent::blockingMap(chunk, fnRun);
+		// 先読みした開始状態が実際と違ったチャンクはやり直す
+		// (キーワードのパターンがコメント記号を含む様な定義の場合のみ起こる)
+		for(size_t k=1 ; k<chunk.size() ; k++) {
+			const int actual = res[chunk[k].begin-1].outState;
+			if(chunk[k].inState != actual) {
+				chunk[k].inState = actual;
+				fnRun(chunk[k]);
+			}
+		}
+		return res;
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "ruletokenizer.h"
+#include <QStringList>
+#include <vector>
+
+namespace glsl {
+	//! QStringの行をハイライトする (色付けする範囲を求めるだけで、書式は設定しない)
+	/*! 処理はRuleTokenizerのUTF-16用Tokenizerが行う。
+		コピーしてもTokenizerは共有し、同じインスタンスを複数のスレッドから同時に使ってよい */
+	class LineHighlighter {
+		public:
+			//! 色付けする範囲
+			using Span = TokenSpan;
+			using SpanV = TokenSpanV;
+			//! 1行分の結果
+			struct LineResult {
+				SpanV	span;
+				int		inState,
+						outState;
+			};
+			using LineResultV = std::vector<LineResult>;
+			enum : int {
+				//! Span::kind: コメント (#if 0の中の行も含む)
+				Comment = TokenizerBase::Comment,
+				//! まだハイライトしていない行の状態 (どの状態とも一致せず、初期状態とみなす)
+				UnknownState = TokenizerBase::UnknownState
+			};
+		private:
+			std::shared_ptr<const RuleTokenizer>	_tokenizer;
+		public:
+			/*! \param[in] rules	block.jsonを読み込んだルールセット (blockDef()がnullptrでない事) */
+			LineHighlighter(const SPRuleSet& rules);
+			const SPRuleSet& ruleSet() const;
+			const RuleTokenizer& tokenizer() const;
+			//! 1行をハイライトして次の行へ渡す状態を返す
+			/*! \param[in] inState	前の行の状態 (最初の行は0) */
+			int highlight(const QString& text, int inState, SpanV& span) const;
+			//! 色付けはせずに次の行へ渡す状態だけを求める
+			/*! キーワードを調べない分highlightより速い */
+			int scanState(const QString& text, int inState) const;
+			//! 全ての行をチャンクに分けて並列にハイライトする
+			/*! 各チャンクの開始状態はscanStateで先に求め、実際の状態と違ったチャンクだけやり直す */
+			LineResultV highlightAll(const QStringList& lines) const;
+	};
+}
@@ -0,0 +1,155 @@
+#include "matcher.h"
+#include "simdscan.h"
+#include <algorithm>
+#include <cstring>
+
+namespace glsl {
+	namespace {
+		const MatchHit c_noHit = {-1, -1, -1};
+		//! ASCIIの英数字, '_', '.'か
+		inline bool IsAsciiWord(uint32_t u) {
+			const uint32_t low = u | 0x20;
+			return (u >= '0' && u <= '9') || (low >= 'a' && low <= 'z') || u == '_' || u == '.';
+		}
+		// UTF-16はSIMD命令で纏めて調べ、UTF-8は1バイトずつ調べる
+		// (短い区間では呼び出しの方が高く付くので、先頭のc_headUnit単位は1つずつ調べる)
+		const size_t c_headUnit = 8;
+		//! [p, p+n)で最初にcと等しい単位の位置 (無ければn)
+		size_t FindUnit(const char* p, size_t n, char c) {
+			const void* r = std::memchr(p, c, n);
+			return r ? static_cast<const char*>(r) - p : n;
+		}
+		size_t FindUnit(const char16_t* p, size_t n, char16_t c) {
+			const size_t head = std::min(n, c_headUnit);
+			for(size_t i=0 ; i<head ; i++) {
+				if(p[i] == c)
+					return i;
+			}
+			return head + SimdFindUnit(p+head, n-head, c);
+		}
+		//! 最初にASCIIの英数字, '_', '.'か非ASCIIの単位の位置 (無ければn)
+		size_t FindWordCandidate(const char* p, size_t n) {
+			size_t i = 0;
+			for( ; i<n ; i++) {
+				const uint32_t u = UnitOf(p[i]);
+				if(u >= 0x80 || IsAsciiWord(u))
+					break;
+			}
+			return i;
+		}
+		size_t FindWordCandidate(const char16_t* p, size_t n) {
+			const size_t head = std::min(n, c_headUnit);
+			for(size_t i=0 ; i<head ; i++) {
+				if(p[i] >= 0x80 || IsAsciiWord(p[i]))
+					return i;
+			}
+			return head + SimdFindWordCandidate(p+head, n-head);
+		}
+		//! 最初にASCIIの英数字, '_', '.'以外の単位の位置 (無ければn)
+		size_t SkipAsciiWord(const char* p, size_t n) {
+			size_t i = 0;
+			for( ; i<n ; i++) {
+				if(!IsAsciiWord(UnitOf(p[i])))
+					break;
+			}
+			return i;
+		}
+		size_t SkipAsciiWord(const char16_t* p, size_t n) {
+			const size_t head = std::min(n, c_headUnit);
+			for(size_t i=0 ; i<head ; i++) {
+				if(!IsAsciiWord(p[i]))
+					return i;
+			}
+			return head + SimdSkipAsciiWord(p+head, n-head);
+		}
+	}
+	// ------------------ BasicLiteralMatcher ------------------
+	template <class Ch>
+	BasicLiteralMatcher<Ch>::BasicLiteralMatcher(const Str& word):
+		_word(word)
+	{}
+	template <class Ch>
+	MatchHit BasicLiteralMatcher<Ch>::find(View line, int offset, uint64_t /*lineId*/) const {
+		const size_t len = _word.size();
+		if(len == 0)
+			return c_noHit;
+		// 先頭の単位が一致する位置だけ残りを比べる
+		for(size_t i=offset ; i+len <= line.size ; i++) {
+			i += FindUnit(line.data + i, line.size - len + 1 - i, _word[0]);
+			if(i + len > line.size)
+				break;
+			if(std::equal(_word.begin()+1, _word.end(), line.data + i + 1))
+				return MatchHit{int(i), int(len), 0};
+		}
+		return c_noHit;
+	}
+	// ------------------ BasicWordMatcher ------------------
+	template <class Ch>
+	BasicWordMatcher<Ch>::BasicWordMatcher(const CharTable& table):
+		_table(table),
+		_bAsciiFast(true)
+	{
+		for(uint32_t u=0 ; u<0x80 ; u++) {
+			if(_isWord(u) != IsAsciiWord(u))
+				_bAsciiFast = false;
+		}
+	}
+	template <class Ch>
+	bool BasicWordMatcher<Ch>::_isWord(char32_t c) const {
+		return c == '_' || c == '.' || _table.isLetterOrNumber(c);
+	}
+	template <class Ch>
+	MatchHit BasicWordMatcher<Ch>::find(View line, int offset, uint64_t /*lineId*/) const {
+		if(_bAsciiFast) {
+			const Ch* p = line.data;
+			const size_t n = line.size;
+			for(size_t i=offset ; i<n ; ) {
+				i += FindWordCandidate(p+i, n-i);
+				if(i >= n)
+					break;
+				size_t end = i+1;
+				// 非ASCIIの文字は表を引く
+				if(UnitOf(p[i]) >= 0x80) {
+					end = i;
+					if(!_isWord(NextChar(line, end))) {
+						i = end;
+						continue;
+					}
+				}
+				// 並びの終わりまで進める
+				for(;;) {
+					end += SkipAsciiWord(p+end, n-end);
+					if(end >= n || UnitOf(p[end]) < 0x80)
+						break;
+					size_t next = end;
+					if(!_isWord(NextChar(line, next)))
+						break;
+					end = next;
+				}
+				return MatchHit{int(i), int(end-i), 0};
+			}
+			return c_noHit;
+		}
+		for(size_t i=offset ; i<line.size ; ) {
+			size_t next = i;
+			if(!_isWord(NextChar(line, next))) {
+				i = next;
+				continue;
+			}
+			// 並びの終わりまで進める
+			size_t end = next;
+			while(end < line.size) {
+				size_t n = end;
+				if(!_isWord(NextChar(line, n)))
+					break;
+				end = n;
+			}
+			return MatchHit{int(i), int(end-i), 0};
+		}
+		return c_noHit;
+	}
+	template class BasicLiteralMatcher<char>;
+	template class BasicLiteralMatcher<char16_t>;
+	template class BasicWordMatcher<char>;
+	template class BasicWordMatcher<char16_t>;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include "textview.h"
+#include "chartable.h"
+#include <string>
+
+namespace glsl {
+	//! 行内の検索結果
+	struct MatchHit {
+		int		offset,		//!< 一致した位置 (負数は一致無し)
+				length,
+				category;	//!< キーワードのカテゴリ番号 (それ以外の検索では0)
+	};
+	//! 行内の検索 (コメント記号, キーワード境界, キーワードの種別)
+	/*! 正規表現エンジン等はこれを実装して差し替える。
+		複数のスレッドから同時に呼ばれるので、findで状態を変えないこと */
+	template <class Ch>
+	class BasicMatcher {
+		public:
+			using View = BasicTextView<Ch>;
+			virtual ~BasicMatcher() {}
+			//! line[offset]以降で最も手前の一致を探す
+			/*! 一致するかどうかは位置だけで決まり、検索開始位置には依存しない事
+				\param[in] lineId	行毎に異なる番号 (同じ番号なら同じ行なので、行単位の前処理を使い回してよい。0なら使い回さない) */
+			virtual MatchHit find(View line, int offset, uint64_t lineId) const = 0;
+	};
+	//! 固定の文字列を探す
+	/*! 先頭の単位の候補はUTF-16ならSIMD命令で纏めて探す */
+	template <class Ch>
+	class BasicLiteralMatcher : public BasicMatcher<Ch> {
+		using View = BasicTextView<Ch>;
+		using Str = std::basic_string<Ch>;
+		Str		_word;
+		public:
+			BasicLiteralMatcher(const Str& word);
+			MatchHit find(View line, int offset, uint64_t lineId) const override;
+	};
+	//! 英数字, '_', '.'の並び ("[\\w\\.]+"と同じ) を探す
+	/*! 表のASCIIの分類が既定通りなら、ASCIIの部分は表を引かずに(UTF-16ならSIMD命令で纏めて)分類し、
+		非ASCIIの文字だけ表を引く */
+	template <class Ch>
+	class BasicWordMatcher : public BasicMatcher<Ch> {
+		using View = BasicTextView<Ch>;
+		const CharTable&	_table;
+		bool				_bAsciiFast;	//!< ASCIIの英数字が表と一致するか
+		bool _isWord(char32_t c) const;
+		public:
+			BasicWordMatcher(const CharTable& table);
+			MatchHit find(View line, int offset, uint64_t lineId) const override;
+	};
+	extern template class BasicLiteralMatcher<char>;
+	extern template class BasicLiteralMatcher<char16_t>;
+	extern template class BasicWordMatcher<char>;
+	extern template class BasicWordMatcher<char16_t>;
+}
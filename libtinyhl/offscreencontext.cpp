@@ -0,0 +1,52 @@
+#include "offscreencontext.h"
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QStringList>
+#include <stdexcept>
+
+namespace glsl {
+	OffscreenContext::OffscreenContext(const QSurfaceFormat& fmt, QOpenGLContext* share):
+		_surface(new QOffscreenSurface()),
+		_context(new QOpenGLContext())
+	{
+		_context->setFormat(fmt);
+		if(share)
+			_context->setShareContext(share);
+		if(!_context->create())
+			throw std::runtime_error("can't create OpenGL context");
+		// 実際に作られたフォーマットに合わせる
+		_surface->setFormat(_context->format());
+		_surface->create();
+		if(!_surface->isValid())
+			throw std::runtime_error("can't create offscreen surface");
+	}
+	OffscreenContext::~OffscreenContext() {}
+	bool OffscreenContext::makeCurrent() {
+		return _context->makeCurrent(_surface.get());
+	}
+	void OffscreenContext::doneCurrent() {
+		_context->doneCurrent();
+	}
+	QOpenGLContext* OffscreenContext::context() const {
+		return _context.get();
+	}
+	void OffscreenContext::moveToThread(QThread* th) {
+		_context->moveToThread(th);
+	}
+	QSurfaceFormat MakeSurfaceFormat(const QString& version, bool bCore) {
+		QSurfaceFormat fmt = QSurfaceFormat();
+		if(!version.isEmpty()) {
+			QStringList ls = version.split('.');
+			bool bMajor = false,
+				bMinor = true;
+			int major = ls.value(0).toInt(&bMajor),
+				minor = ls.size() > 1 ? ls[1].toInt(&bMinor) : 0;
+			if(!bMajor || !bMinor)
+				throw std::runtime_error("invalid OpenGL version: " + version.toStdString());
+			fmt.setVersion(major, minor);
+		}
+		if(bCore)
+			fmt.setProfile(QSurfaceFormat::CoreProfile);
+		return fmt;
+	}
+}
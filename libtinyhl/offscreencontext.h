@@ -0,0 +1,32 @@
+#pragma once
+#include <QSurfaceFormat>
+#include <memory>
+
+class QOpenGLContext;
+class QOffscreenSurface;
+class QThread;
+namespace glsl {
+	//! ウィンドウを持たないOpenGLコンテキスト
+	/*! バッチ処理などGUIの無い所でシェーダーをコンパイルする時に使用。
+		QOffscreenSurfaceの生成はGUIスレッドで行う必要があるので、別スレッドで使う場合も
+		GUIスレッドで作ってからmoveToThreadで渡す */
+	class OffscreenContext {
+		using UPSurface = std::unique_ptr<QOffscreenSurface>;
+		using UPContext = std::unique_ptr<QOpenGLContext>;
+		UPSurface	_surface;
+		UPContext	_context;
+		public:
+			/*! \param[in] fmt		要求するコンテキストのバージョンやプロファイル
+				\param[in] share	リソースを共有するコンテキスト (無ければnullptr) */
+			OffscreenContext(const QSurfaceFormat& fmt = QSurfaceFormat(), QOpenGLContext* share = nullptr);
+			~OffscreenContext();
+			bool makeCurrent();
+			void doneCurrent();
+			QOpenGLContext* context() const;
+			//! 以降の操作をthで行う (コンテキストがカレントでない時にGUIスレッドから呼ぶ)
+			void moveToThread(QThread* th);
+	};
+	//! コマンドライン等で指定された"major.minor"とプロファイルから要求フォーマットを作る
+	/*! versionが空ならデフォルトのフォーマットを返す */
+	QSurfaceFormat MakeSurfaceFormat(const QString& version, bool bCore);
+}
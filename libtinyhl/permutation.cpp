@@ -0,0 +1,595 @@
+#include "permutation.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QHash>
+#include <QRegularExpression>
+#include <limits>
+#include <stdexcept>
+
+namespace glsl {
+	Axis ParseAxis(const QString& str) {
+		const int eq = str.indexOf('=');
+		const QString name = str.left(eq).trimmed();
+		const QRegularExpression reName(R"(^[A-Za-z_]\w*$)");
+		if(eq < 0 || !reName.match(name).hasMatch())
+			throw std::runtime_error("invalid axis (expected NAME=v1,v2,...): " + str.toStdString());
+		Axis ax;
+		ax.name = name;
+		for(auto& v : str.mid(eq+1).split(',')) {
+			const QString t = v.trimmed();
+			ax.value.append(t.isEmpty() ? QString() : t);
+		}
+		return ax;
+	}
+	DefineVV ExpandAxes(const AxisV& axes) {
+		DefineVV ret(1);
+		for(auto& ax : axes) {
+			DefineVV next;
+			next.reserve(ret.size() * ax.value.size());
+			for(auto& d : ret) {
+				for(auto& v : ax.value) {
+					next.push_back(d);
+					next.back().push_back(Define{ax.name, v});
+				}
+			}
+			ret.swap(next);
+		}
+		return ret;
+	}
+	QString MakePrologue(const DefineV& def) {
+		QString ret;
+		for(auto& d : def) {
+			if(!d.value.isNull())
+				ret.append(QString("#define %1 %2").arg(d.name).arg(d.value));
+			ret.append('\n');
+		}
+		return ret;
+	}
+	QString DefineString(const DefineV& def) {
+		QStringList sl;
+		for(auto& d : def)
+			sl.append(QString("%1=%2").arg(d.name).arg(d.value.isNull() ? QString("(undef)") : d.value));
+		return sl.join(' ');
+	}
+	QByteArray HashSource(const ProgramSource& src) {
+		// ファイル名の対応表はログを置き換えるだけなので含めない (呼び出し側で組み合わせ毎に置き換える)
+		QByteArray buff;
+		QDataStream ds(&buff, QIODevice::WriteOnly);
+		ds.setVersion(QDataStream::Qt_5_0);
+		for(auto& s : src.source)
+			ds << s;
+		return QCryptographicHash::hash(buff, QCryptographicHash::Sha1);
+	}
+
+	namespace {
+		struct Macro {
+			bool		bDefined = false,
+						bOpaque = false;	//!< 定義が条件次第、又は関数形式で値が分からない
+			QString		value;
+		};
+		using MacroMap = QHash<QString, Macro>;
+
+		//! #if式の字句
+		struct Token {
+			enum Type {
+				Number,
+				Ident,
+				Op,
+				End
+			} type;
+			qint64		num;
+			QString		text;
+		};
+		using TokenV = std::vector<Token>;
+		//! 判定できない式
+		struct Unknown {};
+
+		bool IsIdentBegin(QChar c) {
+			return c.isLetter() || c == '_';
+		}
+		bool IsIdent(QChar c) {
+			return c.isLetterOrNumber() || c == '_';
+		}
+		void Tokenize(const QString& s, TokenV& dst) {
+			static const char* c_op2[] = {"&&", "||", "==", "!=", "<=", ">=", "<<", ">>"};
+			const int n = s.size();
+			for(int i=0 ; i<n ; ) {
+				const QChar c = s[i];
+				if(c.isSpace()) {
+					++i;
+					continue;
+				}
+				const int begin = i;
+				if(c.isDigit()) {
+					while(i < n && IsIdent(s[i]))
+						++i;
+					QString t = s.mid(begin, i-begin);
+					if(t.endsWith('u') || t.endsWith('U'))
+						t.chop(1);
+					bool bOk;
+					const qint64 num = t.toLongLong(&bOk, 0);
+					if(!bOk)
+						throw Unknown();
+					dst.push_back(Token{Token::Number, num, QString()});
+				} else if(IsIdentBegin(c)) {
+					while(i < n && IsIdent(s[i]))
+						++i;
+					dst.push_back(Token{Token::Ident, 0, s.mid(begin, i-begin)});
+				} else {
+					QString op;
+					if(i+1 < n) {
+						const QString t = s.mid(i, 2);
+						for(auto* o : c_op2) {
+							if(t == QLatin1String(o)) {
+								op = t;
+								break;
+							}
+						}
+					}
+					if(op.isEmpty()) {
+						if(!QString("!~-+*/%<>&^|()?:").contains(c))
+							throw Unknown();
+						op = c;
+					}
+					i += op.size();
+					dst.push_back(Token{Token::Op, 0, op});
+				}
+			}
+		}
+		//! 値の分かるマクロだけで#if式を評価する
+		/*! 判定できなければUnknownを投げる */
+		class Evaluator {
+			const MacroMap&	_macro;
+			TokenV			_tok;
+			size_t			_pos = 0;
+
+			const Macro& _lookup(const QString& name) const {
+				auto itr = _macro.find(name);
+				// ドライバが定義する名前や、条件次第で定義される名前
+				if(itr == _macro.end() || itr->bOpaque)
+					throw Unknown();
+				return *itr;
+			}
+			void _expand(const TokenV& src, TokenV& dst, QSet<QString>& disabled) {
+				const int c_maxDepth = 32;
+				if(disabled.size() > c_maxDepth)
+					throw Unknown();
+				for(size_t i=0 ; i<src.size() ; i++) {
+					const Token& t = src[i];
+					if(t.type != Token::Ident) {
+						dst.push_back(t);
+						continue;
+					}
+					if(t.text == QLatin1String("defined")) {
+						// defined X, defined(X)
+						const bool bParen = i+1 < src.size() && src[i+1].type == Token::Op && src[i+1].text == QLatin1String("(");
+						const size_t idx = bParen ? i+2 : i+1;
+						if(idx >= src.size() || src[idx].type != Token::Ident)
+							throw Unknown();
+						if(bParen && (idx+1 >= src.size() || src[idx+1].text != QLatin1String(")")))
+							throw Unknown();
+						dst.push_back(Token{Token::Number, _lookup(src[idx].text).bDefined ? 1 : 0, QString()});
+						i = bParen ? idx+1 : idx;
+						continue;
+					}
+					// 未定義の名前はGLSLではエラーになるので、判定はドライバに任せる
+					const Macro& m = _lookup(t.text);
+					if(!m.bDefined || disabled.contains(t.text))
+						throw Unknown();
+					TokenV val;
+					Tokenize(m.value, val);
+					disabled.insert(t.text);
+					_expand(val, dst, disabled);
+					disabled.remove(t.text);
+				}
+			}
+			bool _isOp(const char* op) const {
+				return _pos < _tok.size() && _tok[_pos].type == Token::Op && _tok[_pos].text == QLatin1String(op);
+			}
+			void _expect(const char* op) {
+				if(!_isOp(op))
+					throw Unknown();
+				++_pos;
+			}
+			static qint64 _Apply(const QString& op, qint64 a, qint64 b) {
+				// 桁あふれで未定義動作にならないよう符号無しで計算する
+				const quint64 ua = a,
+							ub = b;
+				if(op == "||")	return (a || b) ? 1 : 0;
+				if(op == "&&")	return (a && b) ? 1 : 0;
+				if(op == "|")	return a | b;
+				if(op == "^")	return a ^ b;
+				if(op == "&")	return a & b;
+				if(op == "==")	return a == b;
+				if(op == "!=")	return a != b;
+				if(op == "<")	return a < b;
+				if(op == ">")	return a > b;
+				if(op == "<=")	return a <= b;
+				if(op == ">=")	return a >= b;
+				if(op == "+")	return qint64(ua + ub);
+				if(op == "-")	return qint64(ua - ub);
+				if(op == "*")	return qint64(ua * ub);
+				if(op == "<<" || op == ">>") {
+					if(b < 0 || b >= 64)
+						throw Unknown();
+					return (op == "<<") ? qint64(ua << b) : (a >> b);
+				}
+				// / %
+				if(b == 0 || (a == std::numeric_limits<qint64>::min() && b == -1))
+					throw Unknown();
+				return (op == "/") ? a / b : a % b;
+			}
+			//! 優先順位の低い順
+			qint64 _binary(int level) {
+				static const char* c_level[][4] = {
+					{"||"},
+					{"&&"},
+					{"|"},
+					{"^"},
+					{"&"},
+					{"==", "!="},
+					{"<", ">", "<=", ">="},
+					{"<<", ">>"},
+					{"+", "-"},
+					{"*", "/", "%"}
+				};
+				const int nLevel = sizeof(c_level)/sizeof(c_level[0]);
+				if(level >= nLevel)
+					return _unary();
+				qint64 lhs = _binary(level+1);
+				for(;;) {
+					const char* op = nullptr;
+					for(auto* o : c_level[level]) {
+						if(o && _isOp(o)) {
+							op = o;
+							break;
+						}
+					}
+					if(!op)
+						return lhs;
+					++_pos;
+					lhs = _Apply(QString(op), lhs, _binary(level+1));
+				}
+			}
+			qint64 _unary() {
+				if(_isOp("!")) {
+					++_pos;
+					return !_unary();
+				}
+				if(_isOp("~")) {
+					++_pos;
+					return ~_unary();
+				}
+				if(_isOp("-")) {
+					++_pos;
+					return qint64(0 - quint64(_unary()));
+				}
+				if(_isOp("+")) {
+					++_pos;
+					return _unary();
+				}
+				return _primary();
+			}
+			qint64 _primary() {
+				if(_isOp("(")) {
+					++_pos;
+					const qint64 v = _ternary();
+					_expect(")");
+					return v;
+				}
+				if(_pos < _tok.size() && _tok[_pos].type == Token::Number)
+					return _tok[_pos++].num;
+				throw Unknown();
+			}
+			qint64 _ternary() {
+				const qint64 c = _binary(0);
+				if(!_isOp("?"))
+					return c;
+				++_pos;
+				const qint64 a = _ternary();
+				_expect(":");
+				const qint64 b = _ternary();
+				return c ? a : b;
+			}
+			public:
+				Evaluator(const MacroMap& m):
+					_macro(m)
+				{}
+				//! \return 1=真, 0=偽, -1=判定できない
+				int eval(const QString& expr) {
+					try {
+						TokenV tok;
+						Tokenize(expr, tok);
+						QSet<QString> disabled;
+						_tok.clear();
+						_expand(tok, _tok, disabled);
+						_pos = 0;
+						const qint64 v = _ternary();
+						if(_pos != _tok.size())
+							return -1;
+						return v ? 1 : 0;
+					} catch(const Unknown&) {
+						return -1;
+					}
+				}
+				//! \return 1=定義されている, 0=されていない, -1=判定できない
+				int defined(const QString& name) const {
+					try {
+						return _lookup(name).bDefined ? 1 : 0;
+					} catch(const Unknown&) {
+						return -1;
+					}
+				}
+		};
+
+		//! 次の行に持ち越すブロックコメントの状態を更新
+		void UpdateComment(const QString& s, bool& bComment) {
+			const int n = s.size();
+			for(int i=0 ; i<n ; ) {
+				if(bComment) {
+					if(s[i] == '*' && i+1 < n && s[i+1] == '/') {
+						bComment = false;
+						i += 2;
+					} else
+						++i;
+				} else if(s[i] == '/' && i+1 < n) {
+					if(s[i+1] == '/')
+						return;
+					if(s[i+1] == '*') {
+						bComment = true;
+						i += 2;
+					} else
+						++i;
+				} else
+					++i;
+			}
+		}
+		//! 行内のコメントを空白に置き換える
+		/*! \return 行末までにコメントが閉じていなければfalse */
+		bool StripComment(QString& s) {
+			bool bComment = false;
+			QString ret;
+			const int n = s.size();
+			for(int i=0 ; i<n ; ) {
+				if(bComment) {
+					if(s[i] == '*' && i+1 < n && s[i+1] == '/') {
+						bComment = false;
+						ret.append(' ');
+						i += 2;
+					} else
+						++i;
+				} else if(s[i] == '/' && i+1 < n && s[i+1] == '/')
+					break;
+				else if(s[i] == '/' && i+1 < n && s[i+1] == '*') {
+					bComment = true;
+					i += 2;
+				} else
+					ret.append(s[i++]);
+			}
+			s = ret;
+			return !bComment;
+		}
+		struct Directive {
+			QString		name,
+						rest;			//!< 指令名より後 (コメントは除く)
+			int			namePos;
+			bool		bComplete;		//!< 1行で完結している (継続行もコメントの持ち越しも無い)
+		};
+		bool ParseDirective(const QString& line, Directive& d) {
+			int i = 0;
+			const int n = line.size();
+			while(i < n && line[i].isSpace())
+				++i;
+			if(i >= n || line[i] != '#')
+				return false;
+			++i;
+			while(i < n && line[i].isSpace())
+				++i;
+			d.namePos = i;
+			while(i < n && IsIdent(line[i]))
+				++i;
+			d.name = line.mid(d.namePos, i-d.namePos);
+			d.rest = line.mid(i);
+			d.bComplete = StripComment(d.rest);
+			d.rest = d.rest.trimmed();
+			if(d.rest.endsWith('\\'))
+				d.bComplete = false;
+			return true;
+		}
+		//! 先頭の識別子
+		QString LeadingIdent(const QString& s, int* end = nullptr) {
+			int i = 0;
+			if(i < s.size() && IsIdentBegin(s[i])) {
+				while(i < s.size() && IsIdent(s[i]))
+					++i;
+			}
+			if(end)
+				*end = i;
+			return s.left(i);
+		}
+		void CollectIdent(const QStringRef& s, QSet<QString>& dst) {
+			const int n = s.size();
+			for(int i=0 ; i<n ; ) {
+				if(IsIdentBegin(s.at(i))) {
+					const int begin = i;
+					while(i < n && IsIdent(s.at(i)))
+						++i;
+					dst.insert(QString(s.constData()+begin, i-begin));
+				} else if(s.at(i).isDigit()) {
+					// 数値の接尾辞は識別子ではない
+					while(i < n && IsIdent(s.at(i)))
+						++i;
+				} else
+					++i;
+			}
+		}
+	}
+	QString ResolveConditionals(const QString& src, const QSet<QString>& known) {
+		MacroMap macro;
+		for(auto& k : known)
+			macro.insert(k, Macro());
+		Evaluator eval(macro);
+
+		struct Group {
+			bool	bParentActive,
+					bParentUncertain,
+					bKept,		//!< 判定できない条件があったので、以降の指令と中身はドライバに任せる
+					bTaken,		//!< 真になった分岐があった
+					bActive;	//!< 現在の分岐が有効
+		};
+		std::vector<Group> group;
+		auto fnActive = [&group]() {
+			if(group.empty())
+				return true;
+			auto& g = group.back();
+			return g.bParentActive && (g.bKept || g.bActive);
+		};
+		// 有効かどうかが分からない位置か
+		auto fnUncertain = [&group]() {
+			return !group.empty() && (group.back().bKept || group.back().bParentUncertain);
+		};
+
+		//! knownの名前を定義している行と、名前の末尾の位置
+		struct DefLine {
+			int		line,
+					nameEnd;
+			QString	name;
+		};
+		std::vector<DefLine> defLine;
+		QStringList lines = src.split('\n');
+		bool bComment = false;
+		for(int ln=0 ; ln<lines.size() ; ln++) {
+			QString& line = lines[ln];
+			const bool bStartComment = bComment;
+			UpdateComment(line, bComment);
+			const bool bActive = fnActive();
+			Directive d;
+			if(bStartComment || !ParseDirective(line, d)) {
+				if(!bActive)
+					line.clear();
+				continue;
+			}
+			// 後の行番号を保つため#lineは常に残す
+			if(d.name == QLatin1String("line"))
+				continue;
+			if(d.name == QLatin1String("if") || d.name == QLatin1String("ifdef") || d.name == QLatin1String("ifndef")) {
+				Group g{bActive, fnUncertain(), false, false, false};
+				if(bActive) {
+					int r = -1;
+					if(d.bComplete) {
+						if(d.name == QLatin1String("if"))
+							r = eval.eval(d.rest);
+						else {
+							r = eval.defined(LeadingIdent(d.rest));
+							if(r >= 0 && d.name == QLatin1String("ifndef"))
+								r = 1-r;
+						}
+					}
+					if(r < 0)
+						g.bKept = true;
+					else
+						g.bTaken = g.bActive = (r == 1);
+				}
+				if(!g.bKept)
+					line.clear();
+				group.push_back(g);
+			} else if(d.name == QLatin1String("elif")) {
+				// 対応する#ifが無い物はドライバに任せる
+				if(group.empty())
+					continue;
+				Group& g = group.back();
+				if(!g.bParentActive)
+					line.clear();
+				else if(g.bKept) {}
+				else if(g.bTaken) {
+					g.bActive = false;
+					line.clear();
+				} else {
+					const int r = d.bComplete ? eval.eval(d.rest) : -1;
+					if(r < 0) {
+						// それまでの分岐は全て偽で消してあるので#ifから始め直す
+						g.bKept = true;
+						line.replace(d.namePos, 4, "if");
+					} else {
+						g.bTaken = g.bActive = (r == 1);
+						line.clear();
+					}
+				}
+			} else if(d.name == QLatin1String("else")) {
+				if(group.empty())
+					continue;
+				Group& g = group.back();
+				if(!g.bParentActive)
+					line.clear();
+				else if(!g.bKept) {
+					g.bActive = !g.bTaken;
+					g.bTaken = true;
+					line.clear();
+				}
+			} else if(d.name == QLatin1String("endif")) {
+				if(group.empty())
+					continue;
+				if(!group.back().bKept)
+					line.clear();
+				group.pop_back();
+			} else if(!bActive)
+				line.clear();
+			else if(d.name == QLatin1String("define") || d.name == QLatin1String("undef")) {
+				int nameEnd;
+				const QString name = LeadingIdent(d.rest, &nameEnd);
+				if(name.isEmpty())
+					continue;
+				Macro& m = macro[name];
+				if(!d.bComplete || fnUncertain()) {
+					m.bOpaque = true;
+					continue;
+				}
+				if(d.name == QLatin1String("undef")) {
+					m = Macro();
+					continue;
+				}
+				// 関数形式のマクロは名前の直後に括弧が来る
+				if(nameEnd < d.rest.size() && d.rest[nameEnd] == '(') {
+					m.bOpaque = true;
+					continue;
+				}
+				m.bDefined = true;
+				m.bOpaque = false;
+				m.value = d.rest.mid(nameEnd).trimmed();
+				if(known.contains(name))
+					defLine.push_back(DefLine{ln, int(line.indexOf(name, d.namePos+6) + name.size()), name});
+			}
+		}
+		// 解決した条件でしか使われていない定義を消す (定義同士の参照が無くなるまで繰り返す)
+		for(bool bChanged=true ; bChanged && !defLine.empty() ; ) {
+			bChanged = false;
+			QSet<int> defIndex;
+			for(auto& d : defLine)
+				defIndex.insert(d.line);
+			QSet<QString> used;
+			for(int ln=0 ; ln<lines.size() ; ln++) {
+				const QString& line = lines[ln];
+				if(line.isEmpty())
+					continue;
+				if(defIndex.contains(ln)) {
+					// 定義している名前自体は参照に数えない
+					for(auto& d : defLine) {
+						if(d.line == ln)
+							CollectIdent(line.midRef(d.nameEnd), used);
+					}
+				} else
+					CollectIdent(line.midRef(0), used);
+			}
+			for(auto itr = defLine.begin() ; itr != defLine.end() ; ) {
+				if(used.contains(itr->name))
+					++itr;
+				else {
+					lines[itr->line].clear();
+					itr = defLine.erase(itr);
+					bChanged = true;
+				}
+			}
+		}
+		return lines.join('\n');
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "compiler.h"
+#include <QByteArray>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <vector>
+
+namespace glsl {
+	//! マクロ定義 (valueがnullなら未定義)
+	struct Define {
+		QString		name,
+					value;
+	};
+	using DefineV = std::vector<Define>;
+	using DefineVV = std::vector<DefineV>;
+	//! 1つのマクロが取り得る値
+	struct Axis {
+		QString		name;
+		QStringList	value;	//!< nullの文字列は未定義を表す
+	};
+	using AxisV = std::vector<Axis>;
+
+	//! "NAME=v1,v2,..."形式の軸を読む (空の値は未定義)
+	/*! \throw std::runtime_error 書式が正しくない */
+	Axis ParseAxis(const QString& str);
+	//! 全ての値の組み合わせを列挙する (先頭の軸ほどゆっくり変わる)
+	/*! 軸が無ければ空の組み合わせを1つ返す */
+	DefineVV ExpandAxes(const AxisV& axes);
+	//! 定義を#define行にする (未定義の物は空行にして、組み合わせに依らず行数を揃える)
+	QString MakePrologue(const DefineV& def);
+	//! "NAME=value NAME2=(undef)"形式の表示用文字列
+	QString DefineString(const DefineV& def);
+
+	//! 値が分かるマクロだけで決まる条件分岐(#if, #ifdef, #ifndef, #elif, #else)を解決する
+	/*! 無効な行は空行にするので行番号は変わらない。#lineは常に残す。
+		knownに含まれる名前はsrc中の#define/#undefで定義の有無が決まり、それ以外の名前はドライバが定義する物として扱う。
+		そうした名前を含む条件は判定せずにそのまま残す。
+		knownの名前の#defineのうち、条件の解決後にどこからも参照されない物は空行にする。
+		これにより、使われない値だけが違う組み合わせは同じテキストになる */
+	QString ResolveConditionals(const QString& src, const QSet<QString>& known);
+	//! 全ステージのソースのハッシュ値 (同じ内容のプログラムをまとめる)
+	/*! src.filesは含めないので、ファイルが違っても内容が同じならまとまる */
+	QByteArray HashSource(const ProgramSource& src);
+}
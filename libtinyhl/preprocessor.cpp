@@ -0,0 +1,328 @@
+#include "preprocessor.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+
+namespace glsl {
+	// ------------------ IncludeGraph ------------------
+	QStringList IncludeGraph::_Collect(const Edge& e, const QString& file) {
+		QSet<QString> visited;
+		QStringList stack(file),
+					ret;
+		while(!stack.isEmpty()) {
+			const QString cur = stack.takeLast();
+			for(auto& next : e.value(cur)) {
+				if(next == file || visited.contains(next))
+					continue;
+				visited.insert(next);
+				ret.append(next);
+				stack.append(next);
+			}
+		}
+		ret.sort();
+		return ret;
+	}
+	void IncludeGraph::set(const QString& file, const QStringList& include) {
+		remove(file);
+		QSet<QString>& dst = _include[file];
+		for(auto& inc : include) {
+			dst.insert(inc);
+			_includedBy[inc].insert(file);
+		}
+	}
+	void IncludeGraph::remove(const QString& file) {
+		auto itr = _include.find(file);
+		if(itr == _include.end())
+			return;
+		for(auto& inc : itr.value())
+			_includedBy[inc].remove(file);
+		_include.erase(itr);
+	}
+	QStringList IncludeGraph::includes(const QString& file) const {
+		return _Collect(_include, file);
+	}
+	QStringList IncludeGraph::dependents(const QString& file) const {
+		return _Collect(_includedBy, file);
+	}
+
+	// ------------------ Preprocessor ------------------
+	namespace {
+		//! インクルードの入れ子の上限
+		const int c_maxDepth = 64;
+
+		bool IsBlank(QChar c) {
+			return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+		}
+		int SkipBlank(const QString& s, int pos, int end) {
+			while(pos < end && IsBlank(s[pos]))
+				++pos;
+			return pos;
+		}
+		//! 識別子を読む
+		QStringRef ReadWord(const QString& s, int& pos, int end) {
+			const int begin = pos;
+			while(pos < end && (s[pos].isLetterOrNumber() || s[pos] == '_'))
+				++pos;
+			return s.midRef(begin, pos-begin);
+		}
+	}
+	struct Preprocessor::Context {
+		QString			out;
+		QStringList*	files;
+		QStringList		stack;		//!< 展開中のファイル
+		QSet<QString>	once;		//!< 展開済みの#pragma onceのファイル
+		bool			bNextLine;	//!< #lineが次の行の番号を指定するか (GLSL 3.30以降とES。それ以前は次の行が番号+1)
+
+		int fileIndex(const QString& name) {
+			int idx = files->indexOf(name);
+			if(idx < 0) {
+				idx = files->size();
+				files->append(name);
+			}
+			return idx;
+		}
+		//! 次の行をindex番のファイルのnext行目とする
+		void line(int next, int index) {
+			out.append(QString("#line %1 %2\n").arg(bNextLine ? next : next-1).arg(index));
+		}
+	};
+	void Preprocessor::_Parse(File& f) {
+		const QString& s = f.text;
+		const int n = s.size();
+		bool bComment = false;
+		int line = 1;
+		for(int pos=0 ; pos<n ; ++line) {
+			const int lineBegin = pos;
+			int lineEnd = s.indexOf('\n', pos);
+			if(lineEnd < 0)
+				lineEnd = n;
+			pos = (lineEnd < n) ? lineEnd+1 : n;
+
+			int cur = SkipBlank(s, lineBegin, lineEnd);
+			if(!bComment && cur < lineEnd && s[cur] == '#') {
+				cur = SkipBlank(s, cur+1, lineEnd);
+				const QStringRef dir = ReadWord(s, cur, lineEnd);
+				cur = SkipBlank(s, cur, lineEnd);
+				if(dir == QLatin1String("include")) {
+					if(cur < lineEnd && (s[cur] == '"' || s[cur] == '<')) {
+						const bool bSystem = s[cur] == '<';
+						const int close = s.indexOf(bSystem ? '>' : '"', cur+1);
+						if(close > cur && close < lineEnd)
+							f.include.push_back(Include{line, lineBegin, pos, s.mid(cur+1, close-cur-1), bSystem});
+					}
+				} else if(dir == QLatin1String("pragma")) {
+					if(ReadWord(s, cur, lineEnd) == QLatin1String("once"))
+						f.bOnce = true;
+				} else if(dir == QLatin1String("version") && f.versionLine == 0) {
+					f.version = ReadWord(s, cur, lineEnd).toInt();
+					cur = SkipBlank(s, cur, lineEnd);
+					f.bES = ReadWord(s, cur, lineEnd) == QLatin1String("es");
+					f.versionLine = line;
+					f.versionEnd = pos;
+				}
+			}
+			// 次の行に持ち越すブロックコメントの状態
+			for(int i=lineBegin ; i<lineEnd ; ) {
+				if(bComment) {
+					if(s[i] == '*' && i+1 < lineEnd && s[i+1] == '/') {
+						bComment = false;
+						i += 2;
+					} else
+						++i;
+				} else if(s[i] == '/' && i+1 < lineEnd) {
+					if(s[i+1] == '/')
+						break;
+					if(s[i+1] == '*') {
+						bComment = true;
+						i += 2;
+					} else
+						++i;
+				} else
+					++i;
+			}
+		}
+	}
+	Preprocessor::SPFile Preprocessor::_load(const QString& path) {
+		const QFileInfo fi(path);
+		auto itr = _file.find(path);
+		if(itr != _file.end()) {
+			File& f = *itr.value();
+			if(f.mtime == fi.lastModified() && f.size == fi.size()) {
+				++_stat.reused;
+				return itr.value();
+			}
+		}
+		QFile file(path);
+		if(!file.open(QFile::ReadOnly)) {
+			_file.remove(path);
+			return nullptr;
+		}
+		const QByteArray data = file.readAll();
+		const QByteArray hash = QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+		if(itr != _file.end() && itr.value()->hash == hash) {
+			// 更新日時だけが変わった
+			File& f = *itr.value();
+			f.mtime = fi.lastModified();
+			f.size = fi.size();
+			++_stat.reused;
+			return itr.value();
+		}
+		SPFile f = std::make_shared<File>();
+		f->mtime = fi.lastModified();
+		f->size = fi.size();
+		f->hash = hash;
+		f->text = QString::fromUtf8(data);
+		_Parse(*f);
+		++_stat.parsed;
+		_file.insert(path, f);
+		return f;
+	}
+	QString Preprocessor::_resolve(const Include& inc, const QString& from) const {
+		auto fnFind = [&inc](const QString& dir) {
+			const QFileInfo fi(QDir(dir), inc.name);
+			return fi.isFile() ? fi.canonicalFilePath() : QString();
+		};
+		if(QDir::isAbsolutePath(inc.name)) {
+			const QFileInfo fi(inc.name);
+			return fi.isFile() ? fi.canonicalFilePath() : QString();
+		}
+		if(!inc.bSystem && !from.isEmpty()) {
+			const QString ret = fnFind(QFileInfo(from).absolutePath());
+			if(!ret.isEmpty())
+				return ret;
+		}
+		for(auto& dir : _searchPath) {
+			const QString ret = fnFind(dir);
+			if(!ret.isEmpty())
+				return ret;
+		}
+		return QString();
+	}
+	void Preprocessor::_expand(Context& ctx, const File& f, const QString& path, int index, int begin) {
+		ctx.stack.append(path);
+		QStringList dep;
+		int pos = begin;
+		for(auto& inc : f.include) {
+			if(inc.begin < pos)
+				continue;
+			ctx.out.append(f.text.midRef(pos, inc.begin-pos));
+			pos = inc.end;
+			// 展開しない指令は1行に置き換えて行番号を保つ
+			const QString target = _resolve(inc, path);
+			if(target.isEmpty()) {
+				ctx.out.append(QString("#error cannot find include file \"%1\"\n").arg(inc.name));
+				continue;
+			}
+			dep.append(target);
+			if(ctx.stack.contains(target)) {
+				ctx.out.append(QString("#error recursive include \"%1\"\n").arg(inc.name));
+				continue;
+			}
+			if(ctx.once.contains(target)) {
+				ctx.out.append('\n');
+				continue;
+			}
+			if(ctx.stack.size() >= c_maxDepth) {
+				ctx.out.append(QString("#error include nested too deeply \"%1\"\n").arg(inc.name));
+				continue;
+			}
+			SPFile sub = _load(target);
+			if(!sub) {
+				ctx.out.append(QString("#error cannot read include file \"%1\"\n").arg(inc.name));
+				continue;
+			}
+			if(sub->bOnce)
+				ctx.once.insert(target);
+			const int subIndex = ctx.fileIndex(target);
+			ctx.line(1, subIndex);
+			_expand(ctx, *sub, target, subIndex, 0);
+			if(!ctx.out.endsWith('\n'))
+				ctx.out.append('\n');
+			ctx.line(inc.line+1, index);
+		}
+		ctx.out.append(f.text.midRef(pos));
+		if(!path.isEmpty())
+			_graph.set(path, dep);
+		ctx.stack.removeLast();
+	}
+	void Preprocessor::setSearchPaths(const QStringList& paths) {
+		_searchPath = paths;
+	}
+	const QStringList& Preprocessor::searchPaths() const {
+		return _searchPath;
+	}
+	void Preprocessor::setPrologue(const QString& text) {
+		_prologue = text;
+	}
+	QString Preprocessor::expand(const QString& text, const QString& path, const QString& name, QStringList& files) {
+		File f;
+		f.text = text;
+		_Parse(f);
+		QString key;
+		if(!path.isEmpty()) {
+			const QFileInfo fi(path);
+			key = fi.exists() ? fi.canonicalFilePath() : fi.absoluteFilePath();
+		}
+		Context ctx;
+		ctx.files = &files;
+		ctx.bNextLine = f.bES || f.version >= 330;
+		const int index = ctx.fileIndex(name.isEmpty() ? key : name);
+		if(index == 0 && f.include.empty() && _prologue.isEmpty()) {
+			if(!key.isEmpty())
+				_graph.set(key, QStringList());
+			return text;
+		}
+		int begin = 0;
+		if(index != 0 || !_prologue.isEmpty()) {
+			// #versionより前には何も置けないので、その次の行から番号を付け直す
+			begin = f.versionEnd;
+			ctx.out.append(text.midRef(0, begin));
+			if(begin > 0 && !ctx.out.endsWith('\n'))
+				ctx.out.append('\n');
+			ctx.out.append(_prologue);
+			if(!ctx.out.endsWith('\n'))
+				ctx.out.append('\n');
+			ctx.line(f.versionLine+1, index);
+		}
+		_expand(ctx, f, key, index, begin);
+		return ctx.out;
+	}
+	void Preprocessor::expand(ProgramSource& src, const QString (&path)[Shader::_Num]) {
+		src.files.clear();
+		for(int i=0 ; i<Shader::_Num ; i++) {
+			auto type = static_cast<Shader::Type>(i);
+			if(!src.has(type))
+				continue;
+			src.source[i] = expand(src.source[i], path[i], path[i].isEmpty() ? QString(GetStageName(type)) : QString(), src.files);
+		}
+	}
+	void Preprocessor::invalidate(const QString& path) {
+		_file.remove(QFileInfo(path).canonicalFilePath());
+	}
+	const IncludeGraph& Preprocessor::graph() const {
+		return _graph;
+	}
+	Preprocessor::Stat Preprocessor::stat() const {
+		return _stat;
+	}
+
+	QString MapSourceLog(const QString& log, const QStringList& files) {
+		const QRegularExpression re(R"(^((?:ERROR|WARNING): )?(\d+)(?=[:(]\d))", QRegularExpression::MultilineOption);
+		QString ret;
+		int pos = 0;
+		auto itr = re.globalMatch(log);
+		while(itr.hasNext()) {
+			const auto m = itr.next();
+			const int idx = m.captured(2).toInt();
+			if(idx >= files.size())
+				continue;
+			ret.append(log.midRef(pos, m.capturedStart(2)-pos));
+			ret.append(files[idx]);
+			pos = m.capturedEnd(2);
+		}
+		ret.append(log.midRef(pos));
+		return ret;
+	}
+}
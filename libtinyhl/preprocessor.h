@@ -0,0 +1,107 @@
+#pragma once
+#include "compiler.h"
+#include <QByteArray>
+#include <QDateTime>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <memory>
+#include <vector>
+
+namespace glsl {
+	//! #includeによるファイル間の依存関係
+	/*! ファイルは正規化した絶対パスで表す */
+	class IncludeGraph {
+		using Edge = QHash<QString, QSet<QString>>;
+		Edge	_include,		//!< ファイル -> 直接インクルードしているファイル
+				_includedBy;	//!< ファイル -> 直接インクルードされているファイル
+		//! eを辿って到達できるファイルを全て集める (fileは含まない)
+		static QStringList _Collect(const Edge& e, const QString& file);
+		public:
+			//! fileが直接インクルードするファイルを置き換える
+			void set(const QString& file, const QStringList& include);
+			void remove(const QString& file);
+			//! fileが(間接的な物も含めて)インクルードしているファイル
+			QStringList includes(const QString& file) const;
+			//! fileを(間接的な物も含めて)インクルードしているファイル
+			/*! ヘッダを変更した時に検査し直す必要があるファイルが分かる */
+			QStringList dependents(const QString& file) const;
+	};
+	//! #includeを展開し、ドライバのエラー位置が元のファイルを指すよう#lineを挿入する
+	/*! インクルードする側のファイルのディレクトリ("..."のみ)、検索パスの順にファイルを探す。
+		#pragma onceのファイルは1ステージにつき1度だけ展開する。
+		見つからないインクルードは#errorに置き換えるので、有効な分岐の物だけドライバがエラーにする。
+		読み込んだヘッダは更新日時と内容のハッシュで判定してキャッシュし、解析は内容が変わった時だけ行う。
+		1つのスレッドから使うこと */
+	class Preprocessor {
+		public:
+			//! ヘッダキャッシュの利用状況
+			struct Stat {
+				quint64	parsed = 0,		//!< 読み込んで解析した回数
+						reused = 0;		//!< 解析済みの物を使った回数
+			};
+		private:
+			//! #include指令
+			struct Include {
+				int			line,		//!< 行番号 (1始まり)
+							begin,		//!< 行の先頭
+							end;		//!< 次の行の先頭
+				QString		name;
+				bool		bSystem;	//!< <name>形式か
+			};
+			using IncludeV = std::vector<Include>;
+			struct File {
+				QDateTime	mtime;
+				qint64		size = 0;
+				QByteArray	hash;
+				QString		text;
+				IncludeV	include;
+				bool		bOnce = false;		//!< #pragma onceがあるか
+				int			version = 0,		//!< #versionの番号 (無ければ0)
+							versionEnd = 0,		//!< #versionの次の行の先頭
+							versionLine = 0;	//!< #versionの行番号
+				bool		bES = false;		//!< #version xxx es
+			};
+			using SPFile = std::shared_ptr<File>;
+			using FileMap = QHash<QString, SPFile>;
+			struct Context;
+
+			FileMap			_file;
+			QStringList		_searchPath;
+			QString			_prologue;
+			IncludeGraph	_graph;
+			Stat			_stat;
+
+			static void _Parse(File& f);
+			//! ヘッダを読み込む (変わっていなければキャッシュを返す)
+			/*! \return 読めなければnullptr */
+			SPFile _load(const QString& path);
+			//! \return 見つからなければ空文字列
+			QString _resolve(const Include& inc, const QString& from) const;
+			//! fのbegin以降をctxに書き出す
+			/*! \param[in] index	fのソース文字列番号 */
+			void _expand(Context& ctx, const File& f, const QString& path, int index, int begin);
+		public:
+			void setSearchPaths(const QStringList& paths);
+			const QStringList& searchPaths() const;
+			//! 各ステージの#versionの次(無ければ先頭)に挿入するテキスト
+			/*! 後に続く行の番号は変わらない */
+			void setPrologue(const QString& text);
+			//! textのインクルードを展開する
+			/*! \param[in] path		textのファイルパス (空ならファイルに保存されていないテキスト)
+				\param[in] name		ログでtextを示す名前 (空ならpath)
+				\param[in,out] files	ソース文字列番号に対応するファイル名 (新しいファイルは末尾に追加する) */
+			QString expand(const QString& text, const QString& path, const QString& name, QStringList& files);
+			//! プログラムの全ステージを展開し、src.filesに対応表を設定する
+			/*! \param[in] path	ステージ毎のファイルパス (保存されていなければ空) */
+			void expand(ProgramSource& src, const QString (&path)[Shader::_Num]);
+			//! キャッシュしているファイルを捨てる
+			void invalidate(const QString& path);
+			const IncludeGraph& graph() const;
+			Stat stat() const;
+	};
+	//! ドライバのログに含まれるソース文字列番号をファイル名に置き換える
+	/*! "0:12(3): ", "0(12) : ", "ERROR: 0:12: "の形式に対応 */
+	QString MapSourceLog(const QString& log, const QStringList& files);
+}
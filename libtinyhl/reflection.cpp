@@ -0,0 +1,174 @@
+#include "reflection.h"
+#include <QDataStream>
+#include <QOpenGLContext>
+#include <algorithm>
+
+namespace glsl {
+	// ------------------ Reflection ------------------
+	namespace {
+		QDataStream& operator << (QDataStream& ds, const VariableV& v) {
+			ds << quint32(v.size());
+			for(auto& a : v) {
+				ds << a.name << quint32(a.type) << qint32(a.size) << qint32(a.location)
+					<< qint32(a.block) << qint32(a.offset);
+			}
+			return ds;
+		}
+		QDataStream& operator >> (QDataStream& ds, VariableV& v) {
+			quint32 n;
+			ds >> n;
+			v.clear();
+			for(quint32 i=0 ; i<n && ds.status()==QDataStream::Ok ; i++) {
+				Variable a;
+				quint32 type;
+				qint32 size, location, block, offset;
+				ds >> a.name >> type >> size >> location >> block >> offset;
+				a.type = type;
+				a.size = size;
+				a.location = location;
+				a.block = block;
+				a.offset = offset;
+				v.push_back(std::move(a));
+			}
+			return ds;
+		}
+		QDataStream& operator << (QDataStream& ds, const BlockV& v) {
+			ds << quint32(v.size());
+			for(auto& b : v)
+				ds << b.name << qint32(b.binding) << qint32(b.dataSize) << qint32(b.nVariable);
+			return ds;
+		}
+		QDataStream& operator >> (QDataStream& ds, BlockV& v) {
+			quint32 n;
+			ds >> n;
+			v.clear();
+			for(quint32 i=0 ; i<n && ds.status()==QDataStream::Ok ; i++) {
+				Block b;
+				qint32 binding, dataSize, nVariable;
+				ds >> b.name >> binding >> dataSize >> nVariable;
+				b.binding = binding;
+				b.dataSize = dataSize;
+				b.nVariable = nVariable;
+				v.push_back(std::move(b));
+			}
+			return ds;
+		}
+	}
+	void Reflection::serialize(QDataStream& ds) const {
+		ds << attribute << uniform << bufferVariable
+			<< uniformBlock << storageBlock;
+	}
+	bool Reflection::deserialize(QDataStream& ds) {
+		ds >> attribute >> uniform >> bufferVariable
+			>> uniformBlock >> storageBlock;
+		return ds.status() == QDataStream::Ok;
+	}
+	// ------------------ Reflector ------------------
+	Reflector::Reflector() {
+		initializeOpenGLFunctions();
+		QOpenGLContext* ctx = QOpenGLContext::currentContext();
+		const bool b43 = ctx->format().version() >= qMakePair(4,3);
+		if(b43 || ctx->hasExtension("GL_ARB_program_interface_query")) {
+			_getInterface = reinterpret_cast<GetProgramInterfaceiv>(ctx->getProcAddress("glGetProgramInterfaceiv"));
+			_getResource = reinterpret_cast<GetProgramResourceiv>(ctx->getProcAddress("glGetProgramResourceiv"));
+			_getName = reinterpret_cast<GetProgramResourceName>(ctx->getProcAddress("glGetProgramResourceName"));
+			if(!_getInterface || !_getResource || !_getName)
+				_getInterface = nullptr;
+			_bStorage = b43 || ctx->hasExtension("GL_ARB_shader_storage_buffer_object");
+		}
+	}
+	bool Reflector::hasResourceQuery() const {
+		return _getInterface != nullptr;
+	}
+	Reflection Reflector::reflect(GLuint prog) {
+		return hasResourceQuery() ? _reflectInterface(prog) : _reflectLegacy(prog);
+	}
+	VariableV Reflector::_variables(GLuint prog, GLenum iface) {
+		// バッファ変数にはロケーションが、attributeにはブロックが無い
+		const bool	bLocation = iface != GL_BUFFER_VARIABLE,
+					bBlock = iface != GL_PROGRAM_INPUT;
+		std::vector<GLenum> prop = {GL_TYPE, GL_ARRAY_SIZE};
+		if(bLocation)
+			prop.push_back(GL_LOCATION);
+		if(bBlock) {
+			prop.push_back(GL_BLOCK_INDEX);
+			prop.push_back(GL_OFFSET);
+		}
+		GLint n = 0,
+			maxLen = 0;
+		_getInterface(prog, iface, GL_ACTIVE_RESOURCES, &n);
+		_getInterface(prog, iface, GL_MAX_NAME_LENGTH, &maxLen);
+		std::vector<GLchar> name(std::max(maxLen, 1));
+		std::vector<GLint> val(prop.size());
+		VariableV ret;
+		ret.reserve(n);
+		for(GLint i=0 ; i<n ; i++) {
+			_getResource(prog, iface, i, GLsizei(prop.size()), prop.data(), GLsizei(val.size()), nullptr, val.data());
+			GLsizei len = 0;
+			_getName(prog, iface, i, GLsizei(name.size()), &len, name.data());
+			Variable v;
+			v.name = QString::fromLatin1(name.data(), len);
+			v.type = val[0];
+			v.size = val[1];
+			int k = 2;
+			v.location = bLocation ? val[k++] : -1;
+			v.block = bBlock ? val[k++] : -1;
+			v.offset = bBlock ? val[k++] : -1;
+			ret.push_back(std::move(v));
+		}
+		return ret;
+	}
+	BlockV Reflector::_blocks(GLuint prog, GLenum iface) {
+		const GLenum prop[] = {GL_BUFFER_BINDING, GL_BUFFER_DATA_SIZE, GL_NUM_ACTIVE_VARIABLES};
+		const GLsizei nProp = sizeof(prop)/sizeof(prop[0]);
+		GLint n = 0,
+			maxLen = 0;
+		_getInterface(prog, iface, GL_ACTIVE_RESOURCES, &n);
+		_getInterface(prog, iface, GL_MAX_NAME_LENGTH, &maxLen);
+		std::vector<GLchar> name(std::max(maxLen, 1));
+		GLint val[nProp];
+		BlockV ret;
+		ret.reserve(n);
+		for(GLint i=0 ; i<n ; i++) {
+			_getResource(prog, iface, i, nProp, prop, nProp, nullptr, val);
+			GLsizei len = 0;
+			_getName(prog, iface, i, GLsizei(name.size()), &len, name.data());
+			ret.push_back(Block{QString::fromLatin1(name.data(), len), val[0], val[1], val[2]});
+		}
+		return ret;
+	}
+	Reflection Reflector::_reflectInterface(GLuint prog) {
+		Reflection ref;
+		ref.attribute = _variables(prog, GL_PROGRAM_INPUT);
+		ref.uniform = _variables(prog, GL_UNIFORM);
+		ref.uniformBlock = _blocks(prog, GL_UNIFORM_BLOCK);
+		if(_bStorage) {
+			ref.bufferVariable = _variables(prog, GL_BUFFER_VARIABLE);
+			ref.storageBlock = _blocks(prog, GL_SHADER_STORAGE_BLOCK);
+		}
+		return ref;
+	}
+	Reflection Reflector::_reflectLegacy(GLuint prog) {
+		Reflection ref;
+		GLint n, maxLen;
+		GLsizei len;
+		GLint size;
+		GLenum type;
+		std::vector<GLchar> buff;
+		glGetProgramiv(prog, GL_ACTIVE_ATTRIBUTES, &n);
+		glGetProgramiv(prog, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxLen);
+		buff.resize(std::max(maxLen, 1));
+		for(int i=0 ; i<n ; i++) {
+			glGetActiveAttrib(prog, i, GLsizei(buff.size()), &len, &size, &type, buff.data());
+			ref.attribute.push_back(Variable{QString::fromLatin1(buff.data(), len), type, size, glGetAttribLocation(prog, buff.data()), -1, -1});
+		}
+		glGetProgramiv(prog, GL_ACTIVE_UNIFORMS, &n);
+		glGetProgramiv(prog, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLen);
+		buff.resize(std::max(maxLen, 1));
+		for(int i=0 ; i<n ; i++) {
+			glGetActiveUniform(prog, i, GLsizei(buff.size()), &len, &size, &type, buff.data());
+			ref.uniform.push_back(Variable{QString::fromLatin1(buff.data(), len), type, size, glGetUniformLocation(prog, buff.data()), -1, -1});
+		}
+		return ref;
+	}
+}
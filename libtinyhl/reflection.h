@@ -0,0 +1,68 @@
+#pragma once
+#include <QOpenGLFunctions>
+#include <QString>
+#include <vector>
+
+class QDataStream;
+namespace glsl {
+	//! シェーダーの変数 (attribute / uniform / バッファ変数)
+	struct Variable {
+		QString		name;
+		GLenum		type;
+		GLint		size,
+					location,	//!< ロケーション (ブロックのメンバやバッファ変数は-1)
+					block,		//!< 所属するブロックのインデックス (無ければ-1)
+					offset;		//!< ブロック内のバイトオフセット (無ければ-1)
+	};
+	using VariableV = std::vector<Variable>;
+	//! uniformブロック / シェーダーストレージブロック
+	struct Block {
+		QString		name;
+		GLint		binding,
+					dataSize,	//!< バッファに必要なバイト数
+					nVariable;	//!< 有効なメンバの数
+	};
+	using BlockV = std::vector<Block>;
+	//! リンク済みプログラムから取得した変数情報
+	struct Reflection {
+		VariableV	attribute,
+					uniform,
+					bufferVariable;	//!< シェーダーストレージブロックのメンバ
+		BlockV		uniformBlock,
+					storageBlock;
+
+		//! CompileCache用に書き出す
+		void serialize(QDataStream& ds) const;
+		//! \return データが壊れていればfalse
+		bool deserialize(QDataStream& ds);
+	};
+	//! リンク済みプログラムの変数情報を取得する
+	/*! GL4.3又はGL_ARB_program_interface_queryがあればglGetProgramResourceivで1つの変数につき
+		型・配列サイズ・ロケーション・ブロックを1回で問い合わせ、uniformブロックやシェーダーストレージブロックも取得する。
+		無ければglGetActiveAttrib/glGetActiveUniformでattributeとuniformだけを取得する。
+		名前はどちらも最長の名前に合わせたバッファで受け取るので切り詰められない。
+		使用中はコンストラクタを呼んだ時と同じコンテキストがカレントであること */
+	class Reflector : protected QOpenGLFunctions {
+		typedef void (QOPENGLF_APIENTRYP GetProgramInterfaceiv)(GLuint program, GLenum iface, GLenum pname, GLint* params);
+		typedef void (QOPENGLF_APIENTRYP GetProgramResourceiv)(GLuint program, GLenum iface, GLuint index, GLsizei propCount,
+																const GLenum* props, GLsizei bufSize, GLsizei* length, GLint* params);
+		typedef void (QOPENGLF_APIENTRYP GetProgramResourceName)(GLuint program, GLenum iface, GLuint index, GLsizei bufSize,
+																	GLsizei* length, GLchar* name);
+		GetProgramInterfaceiv	_getInterface = nullptr;
+		GetProgramResourceiv	_getResource = nullptr;
+		GetProgramResourceName	_getName = nullptr;
+		bool					_bStorage = false;	//!< シェーダーストレージブロックを問い合わせられるか
+
+		//! ifaceの全ての変数を取得
+		VariableV _variables(GLuint prog, GLenum iface);
+		//! ifaceの全てのブロックを取得
+		BlockV _blocks(GLuint prog, GLenum iface);
+		Reflection _reflectInterface(GLuint prog);
+		Reflection _reflectLegacy(GLuint prog);
+		public:
+			Reflector();
+			//! glGetProgramResourceivを使えるか
+			bool hasResourceQuery() const;
+			Reflection reflect(GLuint prog);
+	};
+}
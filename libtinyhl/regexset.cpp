@@ -0,0 +1,477 @@
+#include "regexset.h"
+#include <QStringList>
+#include <QDataStream>
+#include <QDebug>
+#include <algorithm>
+
+namespace glsl {
+	namespace {
+		//! 正規表現の先頭に成り得る文字を、実際より多めに求める
+		/*! 構文は入れ子の対応が取れる程度にだけ解釈し、先頭の文字が決められない構文
+			(否定の文字クラス, \\p{..}, 後方参照, 未対応のフラグ等)があれば失敗とする */
+		class FirstCharParser {
+			using FirstChar = RegexSet::FirstChar;
+			const QString&	_p;
+			int				_i = 0;
+			bool			_bFail = false;
+
+			bool _end() const {
+				return _i >= _p.length();
+			}
+			QChar _peek() const {
+				return _p.at(_i);
+			}
+			void _addChar(FirstChar& dst, ushort u, bool bCase) {
+				if(u >= 0x80) {
+					// 大文字小文字を区別しない時は非ASCIIがASCIIと一致する事がある (U+017F等)
+					if(!bCase)
+						_bFail = true;
+					return;
+				}
+				dst.ch[u] = true;
+				if(!bCase) {
+					if(u >= 'a' && u <= 'z')
+						dst.ch[u - 'a' + 'A'] = true;
+					else if(u >= 'A' && u <= 'Z')
+						dst.ch[u - 'A' + 'a'] = true;
+				}
+			}
+			void _addRange(FirstChar& dst, ushort lo, ushort hi, bool bCase) {
+				for(uint u=lo ; u<=hi && u<0x80 ; u++)
+					_addChar(dst, ushort(u), bCase);
+				if(hi >= 0x80)
+					_addChar(dst, hi, bCase);
+			}
+			//! \d, \w, \sを加える
+			/*! \return それ以外の文字 */
+			bool _addClass(FirstChar& dst, QChar e) {
+				switch(e.unicode()) {
+					case 'd':
+						_addRange(dst, '0', '9', true);
+						return true;
+					case 'w':
+						_addRange(dst, '0', '9', true);
+						_addRange(dst, 'a', 'z', false);
+						_addChar(dst, '_', true);
+						return true;
+					case 's':
+						for(const char* c = " \t\n\v\f\r" ; *c ; c++)
+							_addChar(dst, ushort(*c), true);
+						return true;
+				}
+				return false;
+			}
+			//! \\p{..}や\\x{..}の括弧を読み飛ばして失敗とする
+			void _skipBrace() {
+				if(!_end() && _peek() == '{') {
+					while(!_end() && _peek() != '}')
+						++_i;
+					++_i;
+				}
+				_bFail = true;
+			}
+			//! '['の後ろから']'まで
+			void _class(FirstChar& dst, bool bCase) {
+				if(!_end() && _peek() == '^')
+					_bFail = true;
+				bool bFirst = true;
+				while(!_end()) {
+					QChar c = _p.at(_i++);
+					if(c == ']' && !bFirst)
+						return;
+					bFirst = false;
+					if(c == '[' && !_end() && _peek() == ':') {
+						_bFail = true;
+						continue;
+					}
+					if(c == '\\') {
+						if(_end())
+							break;
+						const QChar e = _p.at(_i++);
+						if(_addClass(dst, e))
+							continue;
+						if(e.isLetterOrNumber()) {
+							_skipBrace();
+							continue;
+						}
+						c = e;
+					}
+					// 範囲 (終端がエスケープの物は扱わない)
+					if(_i+1 < _p.length() && _peek() == '-' && _p.at(_i+1) != ']') {
+						const QChar hi = _p.at(_i+1);
+						_i += 2;
+						if(hi == '\\' || hi < c)
+							_bFail = true;
+						else
+							_addRange(dst, c.unicode(), hi.unicode(), bCase);
+						continue;
+					}
+					_addChar(dst, c.unicode(), bCase);
+				}
+				_bFail = true;
+			}
+			//! 量指定子を読む
+			/*! \return 0回を許すか */
+			bool _quantifier() {
+				if(_end())
+					return false;
+				bool bZero = false;
+				const QChar q = _peek();
+				if(q == '?' || q == '*') {
+					++_i;
+					bZero = true;
+				} else if(q == '+')
+					++_i;
+				else if(q == '{') {
+					// {n}, {n,}, {n,m}以外は文字として扱われる
+					int k = _i+1;
+					const int top = k;
+					while(k < _p.length() && _p.at(k).isDigit())
+						++k;
+					if(k == top)
+						return false;
+					const bool bMin0 = _p.midRef(top, k-top).toInt() == 0;
+					if(k < _p.length() && _p.at(k) == ',') {
+						++k;
+						while(k < _p.length() && _p.at(k).isDigit())
+							++k;
+					}
+					if(k >= _p.length() || _p.at(k) != '}')
+						return false;
+					_i = k+1;
+					bZero = bMin0;
+				} else
+					return false;
+				// 最短一致・強欲指定
+				if(!_end() && (_peek() == '?' || _peek() == '+'))
+					++_i;
+				return bZero;
+			}
+			//! "(?"の後ろから')'の手前まで
+			/*! \return 空文字列に一致し得るか */
+			bool _special(FirstChar& dst, bool bCase) {
+				// 先読み・後読み (幅0なので先頭の文字には関わらない)
+				if(!_end() && (_peek() == '=' || _peek() == '!' ||
+					(_peek() == '<' && _i+1 < _p.length() && (_p.at(_i+1) == '=' || _p.at(_i+1) == '!'))))
+				{
+					_i += (_peek() == '<') ? 2 : 1;
+					const bool bFail = _bFail;
+					FirstChar tmp;
+					tmp.fill(false);
+					_alternation(tmp, bCase);
+					_bFail = bFail;
+					return true;
+				}
+				// フラグ付きのグループ (iとその打ち消しだけを解釈する)
+				bool bNeg = false,
+					bInner = bCase;
+				while(!_end() && _peek() != ':') {
+					const QChar f = _p.at(_i++);
+					if(f == '-')
+						bNeg = true;
+					else if(f == 'i')
+						bInner = bNeg;
+					else if(f != 'm' && f != 's' && f != 'U')
+						_bFail = true;
+					if(f == ')') {
+						// (?i)等の以降全体に掛かるフラグ
+						--_i;
+						return true;
+					}
+				}
+				++_i;
+				return _alternation(dst, bInner);
+			}
+			//! アトム1つと量指定子
+			/*! \return 空文字列に一致し得るか */
+			bool _atom(FirstChar& dst, bool bCase) {
+				const QChar c = _p.at(_i++);
+				bool bEmpty = false;
+				switch(c.unicode()) {
+					case '\\': {
+						if(_end()) {
+							_bFail = true;
+							break;
+						}
+						const QChar e = _p.at(_i++);
+						if(_addClass(dst, e))
+							break;
+						if(QString("bBAzZG").contains(e))
+							bEmpty = true;
+						else if(e.isLetterOrNumber())
+							_skipBrace();
+						else
+							_addChar(dst, e.unicode(), bCase);
+					} break;
+					case '[':
+						_class(dst, bCase);
+						break;
+					case '(':
+						if(!_end() && _peek() == '?') {
+							++_i;
+							bEmpty = _special(dst, bCase);
+						} else
+							bEmpty = _alternation(dst, bCase);
+						if(_end() || _peek() != ')')
+							_bFail = true;
+						else
+							++_i;
+						break;
+					case '^':
+					case '$':
+						bEmpty = true;
+						break;
+					case '.':
+					case '*':
+					case '+':
+					case '?':
+						_bFail = true;
+						break;
+					default:
+						_addChar(dst, c.unicode(), bCase);
+						break;
+				}
+				return _quantifier() || bEmpty;
+			}
+			//! 連接を'|'か')'の手前まで
+			bool _sequence(FirstChar& dst, bool bCase) {
+				bool bEmpty = true;
+				while(!_end() && _peek() != '|' && _peek() != ')') {
+					FirstChar f;
+					f.fill(false);
+					const bool b = _atom(f, bCase);
+					// 手前が全て空文字列に一致し得る間は、このアトムの先頭も候補になる
+					if(bEmpty)
+						dst |= f;
+					bEmpty &= b;
+				}
+				return bEmpty;
+			}
+			//! 選択を')'の手前まで
+			bool _alternation(FirstChar& dst, bool bCase) {
+				bool bEmpty = false;
+				for(;;) {
+					bEmpty |= _sequence(dst, bCase);
+					if(_end() || _peek() != '|')
+						break;
+					++_i;
+				}
+				return bEmpty;
+			}
+			public:
+				FirstCharParser(const QString& pattern):
+					_p(pattern)
+				{}
+				FirstChar parse() {
+					FirstChar ret;
+					ret.fill(false);
+					const bool bEmpty = _alternation(ret, true);
+					if(_bFail || bEmpty || !_end())
+						ret.fill(true);
+					return ret;
+				}
+		};
+	}
+	// ------------------ RegexSet::FirstChar ------------------
+	void RegexSet::FirstChar::fill(bool b) {
+		std::fill(ch, ch+128, b);
+	}
+	RegexSet::FirstChar& RegexSet::FirstChar::operator |= (const FirstChar& f) {
+		for(int i=0 ; i<128 ; i++)
+			ch[i] |= f.ch[i];
+		return *this;
+	}
+	// ------------------ RegexSet ------------------
+	QString RegexSet::_Decorate(const QString& pattern, bool bCaseSensitive, bool bAutoSpacing) {
+		QString ret = QString(bCaseSensitive ? "(?:%1)" : "(?i:%1)").arg(pattern);
+		// auto_spacing: キーワードの両側が非word(QChar::isLetterOrNumber()がfalse)であること
+		if(bAutoSpacing)
+			ret = QString("(?<![\\p{L}\\p{N}])%1(?![\\p{L}\\p{N}])").arg(ret);
+		return ret;
+	}
+	void RegexSet::_Optimize(const QRegularExpression& re) {
+	#if QT_VERSION >= QT_VERSION_CHECK(5,4,0)
+		// 初回の検索を待たずにJITコンパイルしておく
+		re.optimize();
+	#else
+		Q_UNUSED(re)
+	#endif
+	}
+	RegexSet::FirstChar RegexSet::_FirstChar(const QString& pattern) {
+		return FirstCharParser(pattern).parse();
+	}
+	bool RegexSet::_CanCombine(const QString& pattern) {
+		const int len = pattern.length();
+		bool bClass = false;
+		for(int i=0 ; i<len ; i++) {
+			const QChar c = pattern.at(i);
+			if(c == '\\') {
+				if(++i >= len)
+					break;
+				const QChar e = pattern.at(i);
+				// 文字クラスの中の\数字は8進数
+				if(bClass)
+					continue;
+				// \0は8進数, \1以降は後方参照, \g, \kは番号・名前による参照
+				if((e >= '1' && e <= '9') || e == 'g' || e == 'k')
+					return false;
+				// \Q..\Eの中は文字として扱われる
+				if(e == 'Q') {
+					const int end = pattern.indexOf("\\E", i+1);
+					if(end < 0)
+						break;
+					i = end+1;
+				}
+				continue;
+			}
+			if(bClass) {
+				if(c == ']')
+					bClass = false;
+				continue;
+			}
+			if(c == '[') {
+				bClass = true;
+				// 先頭の']'(否定の後も)は文字として扱われる
+				if(i+1 < len && pattern.at(i+1) == '^')
+					++i;
+				if(i+1 < len && pattern.at(i+1) == ']')
+					++i;
+				continue;
+			}
+			if(c == '(' && i+2 < len && pattern.at(i+1) == '?') {
+				const QChar f = pattern.at(i+2);
+				// 名前付きグループ (?<name>..), (?'name'..), (?P<name>..)と
+				// (?P=name), (?P>name), (?&name), (?R), (?1), (?+1), (?-1), (?(1)..), (?(<name>)..)
+				if(f == 'P' || f == '\'')
+					return false;
+				if(f == '<') {
+					// 後読み(?<=, (?<!は除く
+					if(i+3 < len && pattern.at(i+3) != '=' && pattern.at(i+3) != '!')
+						return false;
+				} else if(f == '&' || f == 'R' || f.isDigit() || f == '+' || f == '-' || f == '(') {
+					// (?-i)等のフラグの打ち消しは除く
+					if(f == '-' && i+3 < len && !pattern.at(i+3).isDigit())
+						continue;
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+	void RegexSet::_addEntry(const QRegularExpression& re, int category) {
+		_entry.push_back(Entry{re, category, _FirstChar(re.pattern())});
+		_pattern.push_back(re.pattern());
+	}
+	void RegexSet::clear() {
+		_entry.clear();
+		_pattern.clear();
+		_any = QRegularExpression();
+		_anyFirst.fill(false);
+	}
+	void RegexSet::add(const QString& pattern, int category, bool bCaseSensitive, bool bAutoSpacing) {
+		if(!_CanCombine(pattern)) {
+			// 選択に纏めると別のパターンのグループを参照したり、名前が重複して選択全体が無効になる
+			qWarning() << "keyword regex with group references or named groups is not supported:" << pattern;
+			return;
+		}
+		QString deco = _Decorate(pattern, bCaseSensitive, bAutoSpacing);
+		// QRegExpと同じく\wや\dがUnicodeの文字にも一致するようにする
+		QRegularExpression re(deco, QRegularExpression::UseUnicodePropertiesOption);
+		if(!re.isValid()) {
+			// 一つでも不正なパターンがあると選択全体が無効になるので除外する
+			qWarning() << "invalid keyword regex:" << pattern << re.errorString();
+			return;
+		}
+		_addEntry(re, category);
+	}
+	void RegexSet::build() {
+		QStringList ls;
+		for(auto& p : _pattern)
+			ls << p;
+		_any = QRegularExpression(ls.join('|'), QRegularExpression::UseUnicodePropertiesOption);
+		_Optimize(_any);
+		_anyFirst.fill(false);
+		for(auto& e : _entry) {
+			_Optimize(e.re);
+			_anyFirst |= e.first;
+		}
+		StrV().swap(_pattern);
+	}
+	void RegexSet::serialize(QDataStream& ds) const {
+		// auto_spacing等を埋め込んだ後のパターンをそのまま書き出す
+		ds << quint32(_entry.size());
+		for(auto& e : _entry)
+			ds << e.re.pattern() << qint32(e.category);
+	}
+	bool RegexSet::deserialize(QDataStream& ds, int nCategory) {
+		clear();
+		quint32 n;
+		ds >> n;
+		for(quint32 i=0 ; i<n && ds.status()==QDataStream::Ok ; i++) {
+			QString pattern;
+			qint32 category;
+			ds >> pattern >> category;
+			if(category < 0 || category >= nCategory)
+				return false;
+			QRegularExpression re(pattern, QRegularExpression::UseUnicodePropertiesOption);
+			// 以前のバージョンが書き出した、纏められないパターンも読み直させる
+			if(!re.isValid() || !_CanCombine(pattern))
+				return false;
+			_addEntry(re, category);
+		}
+		if(ds.status() != QDataStream::Ok)
+			return false;
+		build();
+		return true;
+	}
+	bool RegexSet::empty() const {
+		return _entry.empty();
+	}
+	namespace {
+		thread_local quint64 t_nMatch = 0;
+	}
+	quint64 RegexSet::MatchCount() {
+		return t_nMatch;
+	}
+	RegexSet::Result RegexSet::find(const QString& text, int offset) const {
+		Result res{-1, -1, -1};
+		if(_entry.empty())
+			return res;
+		const int length = text.length();
+		const QChar* str = text.constData();
+		while(offset <= length) {
+			// どのパターンも始まり得ない文字は正規表現を呼ばずに飛ばす
+			while(offset < length && !_anyFirst.test(str[offset]))
+				++offset;
+			if(offset >= length)
+				break;
+			++t_nMatch;
+			auto m = _any.match(text, offset);
+			if(!m.hasMatch())
+				break;
+			// 選択は先に書いた方が優先されるので、その位置で全パターンを比べて最長を取る
+			const int pos = m.capturedStart();
+			for(auto& e : _entry) {
+				if(pos < length && !e.first.test(str[pos]))
+					continue;
+				++t_nMatch;
+				auto m2 = e.re.match(text, pos, QRegularExpression::NormalMatch,
+										QRegularExpression::AnchoredMatchOption);
+				if(m2.hasMatch()) {
+					const int len = m2.capturedLength();
+					if(len > res.length) {
+						res.offset = pos;
+						res.length = len;
+						res.category = e.category;
+					}
+				}
+			}
+			// 長さ0の一致しか無ければ次の位置から探し直す
+			if(res.length > 0)
+				return res;
+			res = Result{-1, -1, -1};
+			offset = pos + 1;
+		}
+		return res;
+	}
+}
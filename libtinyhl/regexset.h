@@ -0,0 +1,80 @@
+#pragma once
+#include <QRegularExpression>
+#include <vector>
+
+class QDataStream;
+namespace glsl {
+	//! 全カテゴリの正規表現キーワードを一つの選択パターンに纏めた物
+	/*! 最も手前の一致位置は結合した正規表現一回の検索で求め、
+		その位置に限って個別パターンをアンカー付きで評価して最長一致とカテゴリを決める。
+		QRegularExpressionは検索毎に結果をヒープに確保するので、各パターンの先頭に成り得る文字を
+		登録時に求めておき、どのパターンも始まり得ない位置では正規表現を呼ばない */
+	class RegexSet {
+		public:
+			//! 検索結果
+			struct Result {
+				int		offset,		//!< キーワードのオフセット(負数は無効)
+						length,		//!< キーワード長
+						category;	//!< 所属するカテゴリ番号
+			};
+			//! パターンの先頭に成り得るASCII文字 (非ASCIIは常に候補とする)
+			struct FirstChar {
+				bool	ch[128];
+
+				void fill(bool b);
+				FirstChar& operator |= (const FirstChar& f);
+				bool test(QChar c) const {
+					return c.unicode() >= 0x80 || ch[c.unicode()];
+				}
+			};
+		private:
+			struct Entry {
+				QRegularExpression	re;
+				int					category;
+				FirstChar			first;
+			};
+			using EntryV = std::vector<Entry>;
+			using StrV = std::vector<QString>;
+
+			//! 個別パターン (一致位置でのカテゴリ判定用)
+			EntryV				_entry;
+			//! 全パターンの選択 (一致位置の検索用)
+			QRegularExpression	_any;
+			//! 全パターンの先頭文字の和
+			FirstChar			_anyFirst;
+			//! 構築前のパターン
+			StrV				_pattern;
+
+			//! auto_spacingと大文字小文字の指定をパターン自体に埋め込む
+			static QString _Decorate(const QString& pattern, bool bCaseSensitive, bool bAutoSpacing);
+			static void _Optimize(const QRegularExpression& re);
+			//! パターンの先頭に成り得る文字を求める
+			/*! 解釈できない構文を含む時と空文字列に一致し得る時は全ての文字を候補とする */
+			static FirstChar _FirstChar(const QString& pattern);
+			//! 選択に纏めても同じ意味になるか
+			/*! 纏めるとグループの番号が後ろにずれ、名前は他のパターンと重複し得るので、
+				後方参照・サブルーチン呼び出し・条件分岐でグループを参照する物と名前付きグループを持つ物はfalse */
+			static bool _CanCombine(const QString& pattern);
+			void _addEntry(const QRegularExpression& re, int category);
+		public:
+			void clear();
+			//! パターンを登録
+			/*! 単独でコンパイルできないパターンと、グループを参照するパターン(\\1, \\k<name>等)、名前付きグループを持つパターンは無視する */
+			void add(const QString& pattern, int category, bool bCaseSensitive, bool bAutoSpacing);
+			//! 登録したパターンから検索用の正規表現を作る
+			void build();
+			bool empty() const;
+			//! offset以降で最も手前にあるキーワードを探す
+			/*! 同じ位置なら長い方、長さも同じならカテゴリ番号が小さい方を採用 */
+			Result find(const QString& text, int offset) const;
+			//! 呼び出したスレッドでfindがQRegularExpressionを評価した回数
+			/*! 評価毎にヒープを確保するので、確保回数の検査でこの分を他と分けて数えるのに使う */
+			static quint64 MatchCount();
+			//! 構築済みのパターンを書き出す
+			void serialize(QDataStream& ds) const;
+			//! serializeで書き出したパターンを読み込んで構築する
+			/*! \param[in] nCategory	ルールセットのカテゴリ数 (範囲外のカテゴリ番号があれば失敗)
+				\return データが壊れていればfalse */
+			bool deserialize(QDataStream& ds, int nCategory);
+	};
+}
@@ -0,0 +1,128 @@
+#include "rulecache.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace glsl {
+	namespace {
+		const quint32	c_magic = 0x474c5243,	// "GLRC"
+						// 書式を変えたら上げる (2: 検索表を構造体のメモリ配置に依らない形式にした)
+						c_version = 2,
+						c_byteOrder = 0x01020304;
+
+		QDataStream& operator << (QDataStream& ds, const RuleCache::Source& s) {
+			return ds << s.path << s.size << s.mtime << s.hash;
+		}
+		QDataStream& operator >> (QDataStream& ds, RuleCache::Source& s) {
+			return ds >> s.path >> s.size >> s.mtime >> s.hash;
+		}
+		RuleCache::Source MakeSource(const QString& path) {
+			QFileInfo fi(path);
+			return RuleCache::Source{fi.absoluteFilePath(), fi.size(), fi.lastModified().toMSecsSinceEpoch(), QByteArray()};
+		}
+	}
+	RuleCache::RuleCache(const QString& cachePath, const QString& userFormat, const QString& define, const QString& blockDefine):
+		_cachePath(cachePath)
+	{
+		_source.push_back(MakeSource(userFormat));
+		_source.push_back(MakeSource(blockDefine));
+		QDir dir(define);
+		for(auto& f : dir.entryList(QStringList() << "*.json", QDir::Files, QDir::Name))
+			_source.push_back(MakeSource(dir.filePath(f)));
+	}
+	QByteArray RuleCache::_Hash(const QString& path) {
+		QFile file(path);
+		if(!file.open(QFile::ReadOnly))
+			return QByteArray();
+		QCryptographicHash h(QCryptographicHash::Sha1);
+		h.addData(&file);
+		return h.result();
+	}
+	bool RuleCache::_isValid(SourceV& cached) {
+		if(cached.size() != _source.size())
+			return false;
+		for(size_t i=0 ; i<_source.size() ; i++) {
+			auto& cur = _source[i];
+			auto& c = cached[i];
+			if(c.path != cur.path)
+				return false;
+			if(c.size == cur.size && c.mtime == cur.mtime)
+				continue;
+			// 更新日時が違っても内容が同じなら有効
+			if(cur.hash.isEmpty())
+				cur.hash = _Hash(cur.path);
+			if(c.hash != cur.hash)
+				return false;
+		}
+		return true;
+	}
+	SPRuleSet RuleCache::read() {
+		QFile file(_cachePath);
+		if(!file.open(QFile::ReadOnly))
+			return nullptr;
+		const qint64 size = file.size();
+		uchar* ptr = file.map(0, size);
+		if(!ptr)
+			return nullptr;
+		// マップしたメモリをコピーせずにストリームとして読む
+		QByteArray raw = QByteArray::fromRawData(reinterpret_cast<const char*>(ptr), size);
+		QDataStream ds(raw);
+		ds.setVersion(QDataStream::Qt_5_0);
+
+		SPRuleSet ret;
+		quint32 magic, version, byteOrder;
+		ds >> magic >> version >> byteOrder;
+		if(ds.status() == QDataStream::Ok &&
+			magic == c_magic && version == c_version && byteOrder == c_byteOrder)
+		{
+			SourceV cached;
+			quint32 n;
+			ds >> n;
+			for(quint32 i=0 ; i<n && ds.status()==QDataStream::Ok ; i++) {
+				Source s;
+				ds >> s;
+				cached.push_back(std::move(s));
+			}
+			if(ds.status() == QDataStream::Ok && _isValid(cached))
+				ret = RuleSet::Deserialize(ds);
+		}
+		file.unmap(ptr);
+		return ret;
+	}
+	bool RuleCache::write(const RuleSet& rs) {
+		for(auto& s : _source) {
+			if(s.hash.isEmpty())
+				s.hash = _Hash(s.path);
+		}
+		QDir().mkpath(QFileInfo(_cachePath).absolutePath());
+		// 書き込み途中のファイルを読まないよう一時ファイル経由で置き換える
+		QSaveFile file(_cachePath);
+		if(!file.open(QFile::WriteOnly))
+			return false;
+		QDataStream ds(&file);
+		ds.setVersion(QDataStream::Qt_5_0);
+		ds << c_magic << c_version << c_byteOrder;
+		ds << quint32(_source.size());
+		for(auto& s : _source)
+			ds << s;
+		rs.serialize(ds);
+		if(ds.status() != QDataStream::Ok) {
+			file.cancelWriting();
+			return false;
+		}
+		return file.commit();
+	}
+	QString RuleCache::DefaultPath(const QString& dir) {
+		QString base = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+		if(base.isEmpty())
+			base = QDir::tempPath();
+		// 定義ディレクトリ毎に別のファイルにする
+		QByteArray key = QCryptographicHash::hash(QFileInfo(dir).absoluteFilePath().toUtf8(), QCryptographicHash::Sha1);
+		return QString("%1/rules-%2.bin").arg(base).arg(QString::fromLatin1(key.toHex().left(16)));
+	}
+}
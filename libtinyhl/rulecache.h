@@ -0,0 +1,44 @@
+#pragma once
+#include "ruleset.h"
+#include <QByteArray>
+#include <QString>
+#include <vector>
+
+namespace glsl {
+	//! コンパイル済みRuleSetのバイナリキャッシュ
+	/*! ファイル先頭に定義ファイル毎の(サイズ, 更新日時, 内容ハッシュ)を記録しておき、
+		全て一致すればJSONを一切読まずにキャッシュから復元する。
+		更新日時が変わっていても内容ハッシュが同じなら有効とみなす。
+		書式のバージョンが違う、又はカテゴリ番号や検索表の添字が範囲外のキャッシュは捨てて定義ファイルから作り直す */
+	class RuleCache {
+		public:
+			//! キャッシュの元になった定義ファイル
+			struct Source {
+				QString		path;
+				qint64		size,
+							mtime;	//!< 更新日時 (msecs since epoch)
+				QByteArray	hash;	//!< 内容のSHA-1 (必要になるまで計算しない)
+			};
+			using SourceV = std::vector<Source>;
+		private:
+			QString		_cachePath;
+			SourceV		_source;
+
+			static QByteArray _Hash(const QString& path);
+			//! キャッシュに記録された定義ファイルが今のファイルと同じか
+			bool _isValid(SourceV& cached);
+		public:
+			/*! \param[in] cachePath	キャッシュファイルのパス
+				\param[in] userFormat	テキスト装飾定義(usercfg.json)のパス
+				\param[in] define		キーワード定義(*.json)が置いてあるディレクトリパス
+				\param[in] blockDefine	コメント/キーワード境界定義(block.json)のパス */
+			RuleCache(const QString& cachePath, const QString& userFormat, const QString& define, const QString& blockDefine);
+			//! 定義ファイルが変わっていなければキャッシュから読み込む
+			/*! \return キャッシュが無い、又は無効ならnullptr */
+			SPRuleSet read();
+			//! ルールセットをキャッシュファイルに書き出す
+			bool write(const RuleSet& rs);
+			//! 定義ディレクトリに対応するデフォルトのキャッシュファイルパス
+			static QString DefaultPath(const QString& dir);
+	};
+}
@@ -0,0 +1,303 @@
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QMutex>
+#include <QDataStream>
+#include <algorithm>
+#include <unordered_map>
+#include "ruleset.h"
+#include "rulecache.h"
+
+#define DEF_STRING(str)	const QString str = #str;
+// JSONファイルのエントリ文字列
+namespace JEnt {
+	// キーワード定義ファイルで使用
+	namespace Keyword {
+		DEF_STRING(type)
+		DEF_STRING(string)
+		DEF_STRING(regex)
+		DEF_STRING(case_sensitive)
+		DEF_STRING(auto_spacing)
+		DEF_STRING(words)
+	}
+	// ハイライト定義ファイルで使用
+	namespace Highlight {
+		DEF_STRING(highlights)
+		DEF_STRING(italic)
+		DEF_STRING(bold)
+		DEF_STRING(underline)
+		DEF_STRING(color)
+	}
+	// ハイライト定義における"コメント"用エントリ名
+	const std::string comment("comment");
+	// コメントブロックとキーワード境界定義ファイルで使用
+	namespace Block {
+		DEF_STRING(comment_line)
+		DEF_STRING(comment_begin)
+		DEF_STRING(comment_end)
+		DEF_STRING(keyword)
+	}
+}
+#undef DEF_STRING
+
+namespace glsl {
+	// ------------------ RuleSet ------------------
+	RuleSet::TextFormat::TextFormat(const QJsonObject& o) {
+		loadFromJson(o);
+	}
+	void RuleSet::TextFormat::loadFromJson(const QJsonObject& o) {
+		namespace Highlight = JEnt::Highlight;
+		// Italicフラグ: デフォルト値=false
+		auto itr = o.find(Highlight::italic);
+		bool b = false;
+		if(itr != o.end())
+			b = itr.value().toBool(false);
+		setFontItalic(b);
+		// Boldフラグ: デフォルト値=QFont::Normal
+		int w = QFont::Normal;
+		itr = o.find(Highlight::bold);
+		if(itr != o.end())
+			w = itr.value().toBool(false) ? QFont::Bold : QFont::Normal;
+		setFontWeight(w);
+		// Underlineフラグ: デフォルト値=false
+		b = false;
+		itr = o.find(Highlight::underline);
+		if(itr != o.end())
+			b = itr.value().toBool(false);
+		setFontUnderline(b);
+		// Color RGB: デフォルト値=(128,128,128)
+		QColor col(128,128,128);
+		itr = o.find(Highlight::color);
+		if(itr != o.end()) {
+			QJsonArray ar = itr.value().toArray();
+			if(ar.size() == 3)
+				col.setRgb(ar[0].toInt(), ar[1].toInt(), ar[2].toInt());
+		}
+		setForeground(col);
+	}
+	RuleSet::Keywords::Keywords(const QJsonObject& o) {
+		loadFromJson(o);
+	}
+	void RuleSet::Keywords::loadFromJson(const QJsonObject& o) {
+		namespace Keyword = JEnt::Keyword;
+		_wordV.clear();
+		// AutoSpacingフラグ: デフォルト値=false
+		bool b = false;
+		auto itr = o.find(Keyword::auto_spacing);
+		if(itr != o.end())
+			b = itr.value().toBool(false);
+		_bAutoSpacing = b;
+		// CaseSensitiveフラグ: デフォルト値=false
+		b = false;
+		itr = o.find(Keyword::case_sensitive);
+		if(itr != o.end())
+			b = itr.value().toBool(false);
+		_bCaseSensitive = b;
+		// String or RegEx: デフォルト値=string
+		QString strType = o.value(Keyword::type).toString(Keyword::string);
+		_bRegex = strType == Keyword::regex;
+
+		QJsonArray ar = o.value(Keyword::words).toArray();
+		for(const auto& w : ar) {
+			QString word = w.toString();
+			if(!word.isEmpty())
+				_wordV.emplace_back(word);
+		}
+	}
+	void RuleSet::Keywords::addTo(KeywordTrie& trie, RegexSet& regex, int category) const {
+		for(auto& w : _wordV) {
+			if(_bRegex) {
+				// 正規表現によるキーワード指定
+				regex.add(w, category, _bCaseSensitive, _bAutoSpacing);
+			} else {
+				// 文字列によるキーワード指定
+				trie.add(w, category, _bCaseSensitive, _bAutoSpacing);
+			}
+		}
+	}
+	namespace {
+		//! コメント・キーワード境界の正規表現
+		/*! QRegExpと同じく\wや\dがUnicodeの文字にも一致するようにする */
+		QRegularExpression MakeBlockRE(const QString& pattern) {
+			QRegularExpression re(pattern, QRegularExpression::UseUnicodePropertiesOption);
+		#if QT_VERSION >= QT_VERSION_CHECK(5,4,0)
+			re.optimize();
+		#endif
+			return re;
+		}
+	}
+	RuleSet::BlockDef::BlockDef(const QJsonObject& o) {
+		namespace Block = JEnt::Block;
+		_cmmLine = MakeBlockRE(o.value(Block::comment_line).toString("//"));
+		_cmmBegin = MakeBlockRE(o.value(Block::comment_begin).toString("/\\*"));
+		_cmmEnd = MakeBlockRE(o.value(Block::comment_end).toString("\\*/"));
+		_keyword = MakeBlockRE(o.value(Block::keyword).toString("[\\w\\.]+"));
+	}
+	const QRegularExpression& RuleSet::BlockDef::getCommentLine() const { return _cmmLine; }
+	const QRegularExpression& RuleSet::BlockDef::getCommentBegin() const { return _cmmBegin; }
+	const QRegularExpression& RuleSet::BlockDef::getCommentEnd() const { return _cmmEnd; }
+	const QRegularExpression& RuleSet::BlockDef::getKeyword() const { return _keyword; }
+	void RuleSet::BlockDef::serialize(QDataStream& ds) const {
+		ds << _cmmLine.pattern() << _cmmBegin.pattern() << _cmmEnd.pattern() << _keyword.pattern();
+	}
+	bool RuleSet::BlockDef::deserialize(QDataStream& ds) {
+		QString line, begin, end, keyword;
+		ds >> line >> begin >> end >> keyword;
+		_cmmLine = MakeBlockRE(line);
+		_cmmBegin = MakeBlockRE(begin);
+		_cmmEnd = MakeBlockRE(end);
+		_keyword = MakeBlockRE(keyword);
+		return ds.status() == QDataStream::Ok;
+	}
+
+	QJsonDocument RuleSet::_LoadJson(const QString& path) {
+		QFile file;
+		file.setFileName(path);
+		if(!file.open(QFile::ReadOnly))
+			throw std::runtime_error("can't read file");
+
+		QJsonParseError err;
+		QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &err);
+		if(err.error != QJsonParseError::NoError)
+			throw std::runtime_error(err.errorString().toStdString());
+		return doc;
+	}
+	SPRuleSet RuleSet::Load(const QString& userFormat, const QString& define, const QString& blockDefine) {
+		std::shared_ptr<RuleSet> rs(new RuleSet());
+		// テキスト装飾定義
+		using FormatMap = std::unordered_map<std::string, TextFormat>;
+		FormatMap formatMap;
+		{
+			QJsonObject root = _LoadJson(userFormat).object();
+			auto itr = root.find(JEnt::Highlight::highlights);
+			if(itr != root.end()) {
+				QJsonObject ent = itr.value().toObject();
+				for(auto itr2 = ent.begin() ; itr2 != ent.end() ; itr2++)
+					formatMap.emplace(itr2.key().toStdString(), TextFormat(itr2.value().toObject()));
+			}
+			auto itrC = formatMap.find(JEnt::comment);
+			if(itrC != formatMap.end()) {
+				rs->_bCommentFormat = true;
+				rs->_commentFormat = itrC->second;
+			}
+		}
+		// キーワード定義 (同じ位置・同じ長さのキーワードが複数カテゴリにある場合に備えて定義名順)
+		{
+			QDir dir(define);
+			QStringList files = dir.entryList(QStringList() << "*.json", QDir::Files);
+			using KeywordsV = std::vector<std::pair<std::string, Keywords>>;
+			KeywordsV kwV;
+			for(auto& f : files) {
+				// ファイル名から拡張子を除く
+				QString name = QFileInfo(f).completeBaseName();
+				kwV.emplace_back(name.toStdString(), Keywords(_LoadJson(dir.filePath(f)).object()));
+			}
+			std::sort(kwV.begin(), kwV.end(), [](const KeywordsV::value_type& k0, const KeywordsV::value_type& k1){
+				return k0.first < k1.first;
+			});
+			for(size_t i=0 ; i<kwV.size() ; i++) {
+				Category c;
+				c.name = kwV[i].first;
+				auto itr = formatMap.find(c.name);
+				c.bFormat = itr != formatMap.end();
+				if(c.bFormat)
+					c.format = itr->second;
+				rs->_category.push_back(std::move(c));
+				kwV[i].second.addTo(rs->_trie, rs->_regex, i);
+			}
+			rs->_trie.build();
+			rs->_regex.build();
+		}
+		// コメント/キーワード境界定義
+		rs->_blockDef = BlockDef(_LoadJson(blockDefine).object());
+		rs->_bBlockDef = true;
+		return rs;
+	}
+	SPRuleSet RuleSet::LoadDir(const QString& dir) {
+		const QString	userFormat = dir + "/usercfg.json",
+						define = dir + "/defs",
+						blockDefine = dir + "/block.json";
+		RuleCache cache(RuleCache::DefaultPath(dir), userFormat, define, blockDefine);
+		if(SPRuleSet rs = cache.read())
+			return rs;
+		SPRuleSet rs = Load(userFormat, define, blockDefine);
+		// 書き込めなくても次回また読み込むだけなので失敗は無視
+		cache.write(*rs);
+		return rs;
+	}
+	void RuleSet::serialize(QDataStream& ds) const {
+		ds << quint32(_category.size());
+		for(auto& c : _category) {
+			ds << QByteArray(c.name.data(), c.name.size()) << c.bFormat
+				<< static_cast<const QTextFormat&>(c.format);
+		}
+		ds << _bCommentFormat << static_cast<const QTextFormat&>(_commentFormat);
+		ds << _bBlockDef;
+		_blockDef.serialize(ds);
+		_trie.serialize(ds);
+		_regex.serialize(ds);
+	}
+	SPRuleSet RuleSet::Deserialize(QDataStream& ds) {
+		std::shared_ptr<RuleSet> rs(new RuleSet());
+		quint32 n;
+		ds >> n;
+		for(quint32 i=0 ; i<n && ds.status()==QDataStream::Ok ; i++) {
+			QByteArray name;
+			Category c;
+			QTextFormat fmt;
+			ds >> name >> c.bFormat >> fmt;
+			c.name.assign(name.constData(), name.size());
+			c.format = fmt.toCharFormat();
+			rs->_category.push_back(std::move(c));
+		}
+		QTextFormat fmt;
+		ds >> rs->_bCommentFormat >> fmt;
+		rs->_commentFormat = fmt.toCharFormat();
+		ds >> rs->_bBlockDef;
+		if(!rs->_blockDef.deserialize(ds) ||
+			!rs->_trie.deserialize(ds, int(rs->_category.size())) ||
+			!rs->_regex.deserialize(ds, int(rs->_category.size())))
+		{
+			return nullptr;
+		}
+		if(ds.status() != QDataStream::Ok)
+			return nullptr;
+		return rs;
+	}
+	namespace {
+		//! ディレクトリ毎の共有ルールセット
+		using SharedMap = std::unordered_map<std::string, SPRuleSet>;
+		SharedMap	g_shared;
+		QMutex		g_sharedMutex;
+	}
+	SPRuleSet RuleSet::Shared(const QString& dir) {
+		QMutexLocker lk(&g_sharedMutex);
+		auto& ent = g_shared[dir.toStdString()];
+		if(!ent)
+			ent = LoadDir(dir);
+		return ent;
+	}
+	SPRuleSet RuleSet::Reload(const QString& dir) {
+		// 読み込み中は古い方を使えるようロックの外で作る
+		SPRuleSet rs = LoadDir(dir);
+		QMutexLocker lk(&g_sharedMutex);
+		g_shared[dir.toStdString()] = rs;
+		return rs;
+	}
+	const RuleSet::CategoryV& RuleSet::categories() const { return _category; }
+	const QTextCharFormat* RuleSet::format(int category) const {
+		auto& c = _category[category];
+		return c.bFormat ? &c.format : nullptr;
+	}
+	const QTextCharFormat* RuleSet::commentFormat() const {
+		return _bCommentFormat ? &_commentFormat : nullptr;
+	}
+	const KeywordTrie& RuleSet::trie() const { return _trie; }
+	const RegexSet& RuleSet::regex() const { return _regex; }
+	const RuleSet::BlockDef* RuleSet::blockDef() const {
+		return _bBlockDef ? &_blockDef : nullptr;
+	}
+}
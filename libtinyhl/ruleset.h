@@ -0,0 +1,132 @@
+#pragma once
+#include <QTextCharFormat>
+#include <QRegularExpression>
+#include <memory>
+#include <string>
+#include <vector>
+#include "keywordtrie.h"
+#include "regexset.h"
+
+class QJsonObject;
+class QJsonDocument;
+class QDataStream;
+namespace glsl {
+	class RuleSet;
+	using SPRuleSet = std::shared_ptr<const RuleSet>;
+	//! ハイライトに使う定義一式 (書式, キーワード検索表, コメント/キーワード境界)
+	/*! 構築後は一切変更しないので、複数のSyntaxHighlighterやスレッドから同時に参照できる。
+		定義を読み直す時は新しいRuleSetを作って差し替える */
+	class RuleSet {
+		public:
+			//! キーワードのカテゴリ (defs以下のファイル1つに対応)
+			struct Category {
+				std::string		name;		//!< 定義名 (ファイル名から拡張子を除いた物)
+				bool			bFormat;	//!< usercfg.jsonに同名の書式定義があるか
+				QTextCharFormat	format;
+			};
+			using CategoryV = std::vector<Category>;
+			//! コメント・キーワード境界定義(regex)
+			/*! JSONフォーマット(例):
+				"comment_line": "//",
+				"comment_begin": "/\\*",
+				"comment_end": "\\* /",
+				"keyword": "[\\w\\.]+"
+			*/
+			class BlockDef {
+				QRegularExpression	_cmmLine,
+									_cmmBegin, _cmmEnd,
+									_keyword;
+				public:
+					BlockDef() = default;
+					BlockDef(const QJsonObject& o);
+					const QRegularExpression& getCommentLine() const;
+					const QRegularExpression& getCommentBegin() const;
+					const QRegularExpression& getCommentEnd() const;
+					const QRegularExpression& getKeyword() const;
+					void serialize(QDataStream& ds) const;
+					bool deserialize(QDataStream& ds);
+			};
+		private:
+			//! テキストをハイライトする時の色やフォント
+			class TextFormat : public QTextCharFormat {
+				public:
+					using QTextCharFormat::QTextCharFormat;
+					TextFormat(const QJsonObject& o);
+					void loadFromJson(const QJsonObject& o);
+			};
+			//! キーワード定義 (string or regex)
+			/*! JSONフォーマット:
+				"type": "string" or "regex",
+				"auto_spacing":	bool,
+				"case_sensitive": bool,
+				"words": [
+					"keyword0",
+					"keyword1", ...
+				]
+			*/
+			class Keywords {
+				using StrV = std::vector<QString>;
+				// 文字列はKeywordTrie, 正規表現はRegexSetへ纏めて登録する
+				StrV	_wordV;
+				bool	_bRegex,			//!< wordが正規表現か
+						_bCaseSensitive,	//!< 大文字小文字を区別するか
+						_bAutoSpacing;		//!< キーワード前後の非wordを想定するか
+				public:
+					Keywords(const QJsonObject& o);
+					//! JSONで記述されたキーワード定義を読み込む
+					void loadFromJson(const QJsonObject& o);
+					//! キーワードを全カテゴリ共通の検索表に登録
+					/*! \param[in] category カテゴリ番号 */
+					void addTo(KeywordTrie& trie, RegexSet& regex, int category) const;
+			};
+
+			//! カテゴリ一覧 (定義名順, インデックスがカテゴリ番号)
+			CategoryV		_category;
+			//! 全カテゴリの文字列キーワード
+			KeywordTrie		_trie;
+			//! 全カテゴリの正規表現キーワード
+			RegexSet		_regex;
+			BlockDef		_blockDef;
+			bool			_bBlockDef = false;
+			//! コメントの書式 (usercfg.jsonに定義が無ければ_bCommentFormat=false)
+			bool			_bCommentFormat = false;
+			QTextCharFormat	_commentFormat;
+
+			RuleSet() = default;
+			//! JSONデータをファイルから読み込み、QJsonDocumentにして返す
+			static QJsonDocument _LoadJson(const QString& path);
+		public:
+			//! 各定義ファイルを読み込んでルールセットを作る
+			/*! \param[in] userFormat	テキスト装飾定義(usercfg.json)のパス
+				\param[in] define		キーワード定義(*.json)が置いてあるディレクトリパス
+				\param[in] blockDefine	コメント/キーワード境界定義(block.json)のパス */
+			static SPRuleSet Load(const QString& userFormat, const QString& define, const QString& blockDefine);
+			//! dir以下のusercfg.json, defs, block.jsonからルールセットを作る
+			/*! 定義ファイルが前回から変わっていなければRuleCacheから読み込み、
+				変わっていれば読み込み直してキャッシュを更新する */
+			static SPRuleSet LoadDir(const QString& dir);
+			//! コンパイル済みの状態を書き出す (RuleCache用)
+			void serialize(QDataStream& ds) const;
+			//! serializeで書き出した状態からルールセットを作る
+			/*! \return データが壊れていればnullptr */
+			static SPRuleSet Deserialize(QDataStream& ds);
+			//! プロセス内で共有するルールセットを取得
+			/*! 同じディレクトリに対しては初回の呼び出し時にだけ読み込む */
+			static SPRuleSet Shared(const QString& dir);
+			//! 共有ルールセットを読み直して差し替える
+			/*! 既に取得済みの参照は古いルールセットをそのまま使い続ける(copy-on-reload) */
+			static SPRuleSet Reload(const QString& dir);
+
+			const CategoryV& categories() const;
+			//! カテゴリの書式を取得
+			/*! \return usercfg.jsonに定義が無ければnullptr */
+			const QTextCharFormat* format(int category) const;
+			//! コメントの書式を取得
+			/*! \return usercfg.jsonに定義が無ければnullptr */
+			const QTextCharFormat* commentFormat() const;
+			const KeywordTrie& trie() const;
+			const RegexSet& regex() const;
+			//! \return block.jsonを読み込んでいなければnullptr
+			const BlockDef* blockDef() const;
+	};
+}
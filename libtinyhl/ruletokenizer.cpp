@@ -0,0 +1,224 @@
+#include "ruletokenizer.h"
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+namespace glsl {
+	namespace {
+		const MatchHit c_noHit = {-1, -1, -1};
+		//! QRegularExpressionに渡す為、1行分をQStringにした物 (スレッド毎に1つ)
+		/*! 同じ行に対する検索では変換結果を使い回し、確保した領域は次の行でも使う */
+		template <class Ch>
+		class LineBuffer;
+		template <>
+		class LineBuffer<char16_t> {
+			uint64_t	_lineId = 0;
+			QString		_str;
+			public:
+				const QString& set(U16View line, uint64_t lineId) {
+					if(lineId == 0 || lineId != _lineId) {
+						_str.resize(int(line.size));
+						std::memcpy(_str.data(), line.data, line.size * sizeof(char16_t));
+						_lineId = lineId;
+					}
+					return _str;
+				}
+				int toUnit(int offset) const {
+					return offset;
+				}
+				MatchHit toHit(int offset, int length, int category) const {
+					return MatchHit{offset, length, category};
+				}
+				static LineBuffer& Local() {
+					thread_local LineBuffer s_buff;
+					return s_buff;
+				}
+		};
+		template <>
+		class LineBuffer<char> {
+			uint64_t			_lineId = 0;
+			QString				_str;
+			//! UTF-16の各単位に対応するUTF-8のバイト位置 (末尾に行の長さ)
+			std::vector<int>	_pos;
+			public:
+				const QString& set(U8View line, uint64_t lineId) {
+					if(lineId == 0 || lineId != _lineId) {
+						// UTF-16の単位数はUTF-8のバイト数を超えない
+						_str.resize(int(line.size));
+						_pos.clear();
+						QChar* dst = _str.data();
+						int n = 0;
+						for(size_t i=0 ; i<line.size ; ) {
+							const int top = int(i);
+							char16_t u[2];
+							const int nu = ToUtf16(NextChar(line, i), u);
+							for(int k=0 ; k<nu ; k++) {
+								dst[n++] = QChar(ushort(u[k]));
+								_pos.push_back(top);
+							}
+						}
+						_pos.push_back(int(line.size));
+						_str.resize(n);
+						_lineId = lineId;
+					}
+					return _str;
+				}
+				int toUnit(int offset) const {
+					return int(std::lower_bound(_pos.begin(), _pos.end(), offset) - _pos.begin());
+				}
+				MatchHit toHit(int offset, int length, int category) const {
+					const int top = _pos[offset];
+					return MatchHit{top, _pos[offset+length] - top, category};
+				}
+				static LineBuffer& Local() {
+					thread_local LineBuffer s_buff;
+					return s_buff;
+				}
+		};
+		//! QRegularExpression1つで探す
+		template <class Ch>
+		class RegexMatcher : public BasicMatcher<Ch> {
+			using View = BasicTextView<Ch>;
+			const QRegularExpression&	_re;
+			public:
+				RegexMatcher(const QRegularExpression& re):
+					_re(re)
+				{}
+				MatchHit find(View line, int offset, uint64_t lineId) const override {
+					auto& buff = LineBuffer<Ch>::Local();
+					const QString& text = buff.set(line, lineId);
+					auto m = _re.match(text, buff.toUnit(offset));
+					if(!m.hasMatch())
+						return c_noHit;
+					return buff.toHit(m.capturedStart(), m.capturedLength(), 0);
+				}
+		};
+		//! 正規表現キーワードの種別を調べる
+		template <class Ch>
+		class RegexSetMatcher : public BasicMatcher<Ch> {
+			using View = BasicTextView<Ch>;
+			const RegexSet&		_set;
+			public:
+				RegexSetMatcher(const RegexSet& set):
+					_set(set)
+				{}
+				MatchHit find(View line, int offset, uint64_t lineId) const override {
+					auto& buff = LineBuffer<Ch>::Local();
+					const QString& text = buff.set(line, lineId);
+					const RegexSet::Result r = _set.find(text, buff.toUnit(offset));
+					if(r.offset < 0)
+						return c_noHit;
+					return buff.toHit(r.offset, r.length, r.category);
+				}
+		};
+		//! 正規表現が固定文字列だけで出来ていれば、その文字列を取り出す
+		bool ToLiteral(const QString& pattern, QString& dst) {
+			const QString c_meta("\\^$.|?*+()[]{}");
+			dst.clear();
+			for(int i=0 ; i<pattern.length() ; i++) {
+				QChar c = pattern.at(i);
+				if(c == '\\') {
+					if(++i >= pattern.length())
+						return false;
+					c = pattern.at(i);
+					// \wや\dなどはエスケープではない
+					if(c.isLetterOrNumber())
+						return false;
+				} else if(c_meta.contains(c))
+					return false;
+				dst.append(c);
+			}
+			return !dst.isEmpty();
+		}
+		//! キーワード境界が既定の"[\\w\\.]+"か
+		bool IsDefaultKeyword(const QString& pattern) {
+			return pattern == "[\\w\\.]+" || pattern == "[\\w.]+" ||
+					pattern == "[\\.\\w]+" || pattern == "[.\\w]+";
+		}
+		void Encode(const QString& s, std::u16string& dst) {
+			dst.assign(reinterpret_cast<const char16_t*>(s.utf16()), s.length());
+		}
+		void Encode(const QString& s, std::string& dst) {
+			const QByteArray u8 = s.toUtf8();
+			dst.assign(u8.constData(), u8.size());
+		}
+		CharTable MakeUnicodeTable() {
+			CharTable table;
+			for(uint32_t u=0 ; u<0x10000 ; u++) {
+				const QChar c = QChar(ushort(u));
+				table.setLetterOrNumber(char16_t(u), c.isLetterOrNumber());
+				if(u >= 0x80) {
+					const ushort f = c.toCaseFolded().unicode();
+					if(f != u)
+						table.addFold(char16_t(u), char16_t(f));
+				}
+			}
+			return table;
+		}
+	}
+	// ------------------ RuleTokenizer::Set ------------------
+	//! 文字コード毎の検索とTokenizer
+	template <class Ch>
+	struct RuleTokenizer::Set {
+		using Matcher = BasicMatcher<Ch>;
+		using UPMatcher = std::unique_ptr<Matcher>;
+		using Str = std::basic_string<Ch>;
+		std::vector<UPMatcher>	matcher;
+		BasicTokenizer<Ch>		tokenizer;
+
+		const Matcher* add(Matcher* m) {
+			matcher.emplace_back(m);
+			return m;
+		}
+		//! コメント記号の検索 (固定文字列なら正規表現を使わない)
+		const Matcher* addMark(const QRegularExpression& re) {
+			QString lit;
+			if(ToLiteral(re.pattern(), lit)) {
+				Str s;
+				Encode(lit, s);
+				return add(new BasicLiteralMatcher<Ch>(s));
+			}
+			return add(new RegexMatcher<Ch>(re));
+		}
+		Set(const RuleSet& rules) {
+			const RuleSet::BlockDef& def = *rules.blockDef();
+			const CharTable& table = UnicodeTable();
+			typename BasicTokenizer<Ch>::Config cfg;
+			cfg.table = &table;
+			cfg.commentLine = addMark(def.getCommentLine());
+			cfg.commentBegin = addMark(def.getCommentBegin());
+			cfg.commentEnd = addMark(def.getCommentEnd());
+			if(IsDefaultKeyword(def.getKeyword().pattern()))
+				cfg.keyword = add(new BasicWordMatcher<Ch>(table));
+			else
+				cfg.keyword = add(new RegexMatcher<Ch>(def.getKeyword()));
+			// 文字列キーワードを正規表現キーワードより優先
+			int n = 0;
+			if(!rules.trie().empty())
+				cfg.classifier[n++] = add(new BasicKeywordMatcher<Ch>(rules.trie().index(), table));
+			if(!rules.regex().empty())
+				cfg.classifier[n++] = add(new RegexSetMatcher<Ch>(rules.regex()));
+			tokenizer = BasicTokenizer<Ch>(cfg);
+		}
+	};
+	// ------------------ RuleTokenizer ------------------
+	RuleTokenizer::RuleTokenizer(const SPRuleSet& rules):
+		_rules(rules),
+		_u8(new Set<char>(*rules)),
+		_u16(new Set<char16_t>(*rules))
+	{}
+	RuleTokenizer::~RuleTokenizer() {}
+	const SPRuleSet& RuleTokenizer::ruleSet() const {
+		return _rules;
+	}
+	const U8Tokenizer& RuleTokenizer::utf8() const {
+		return _u8->tokenizer;
+	}
+	const U16Tokenizer& RuleTokenizer::utf16() const {
+		return _u16->tokenizer;
+	}
+	const CharTable& RuleTokenizer::UnicodeTable() {
+		static const CharTable s_table = MakeUnicodeTable();
+		return s_table;
+	}
+}
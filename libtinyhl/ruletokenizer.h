@@ -0,0 +1,32 @@
+#pragma once
+#include "ruleset.h"
+#include "tokenizer.h"
+#include <memory>
+
+namespace glsl {
+	//! QStringを参照するビュー (コピーしない)
+	inline U16View MakeView(const QString& s) {
+		return U16View(reinterpret_cast<const char16_t*>(s.utf16()), s.length());
+	}
+	//! RuleSetからUTF-8用とUTF-16用のTokenizerを組み立てる
+	/*! block.jsonの記号が固定文字列、キーワード境界が既定の"[\\w\\.]+"ならQtを使わない検索に置き換え、
+		それ以外と正規表現キーワードはQRegularExpressionを呼ぶ検索を使う(UTF-8の行はスレッド毎のバッファにUTF-16へ直して渡す)。
+		構築後は変更しないので、複数のスレッドから同時に使ってよい */
+	class RuleTokenizer {
+		template <class Ch>
+		struct Set;
+		SPRuleSet							_rules;
+		std::unique_ptr<Set<char>>			_u8;
+		std::unique_ptr<Set<char16_t>>		_u16;
+
+		public:
+			/*! \param[in] rules	block.jsonを読み込んだルールセット (blockDef()がnullptrでない事) */
+			RuleTokenizer(const SPRuleSet& rules);
+			~RuleTokenizer();
+			const SPRuleSet& ruleSet() const;
+			const U8Tokenizer& utf8() const;
+			const U16Tokenizer& utf16() const;
+			//! QCharと同じ分類をするUnicodeの文字表
+			static const CharTable& UnicodeTable();
+	};
+}
@@ -0,0 +1,244 @@
+#include "simdscan.h"
+#include <atomic>
+#include <cstdint>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+	#define SIMDSCAN_SSE2
+	#include <immintrin.h>
+	// target属性の関数で組み込み関数を使えるのはGCC 4.9以降
+	#if defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+		#define SIMDSCAN_AVX2
+	#endif
+#elif defined(_MSC_VER) && defined(_M_X64)
+	#define SIMDSCAN_SSE2
+	#include <intrin.h>
+#endif
+
+namespace glsl {
+	namespace {
+		// ------------------ Scalar ------------------
+		//! ASCIIの英数字, '_', '.'か
+		inline bool IsAsciiWord(char16_t u) {
+			const char16_t low = u | 0x20;
+			return (u >= '0' && u <= '9') || (low >= 'a' && low <= 'z') || u == '_' || u == '.';
+		}
+		size_t FindUnitScalar(const char16_t* p, size_t n, char16_t c, size_t i = 0) {
+			for( ; i<n ; i++) {
+				if(p[i] == c)
+					break;
+			}
+			return i;
+		}
+		size_t FindWordCandidateScalar(const char16_t* p, size_t n, size_t i = 0) {
+			for( ; i<n ; i++) {
+				if(p[i] >= 0x80 || IsAsciiWord(p[i]))
+					break;
+			}
+			return i;
+		}
+		size_t SkipAsciiWordScalar(const char16_t* p, size_t n, size_t i = 0) {
+			for( ; i<n ; i++) {
+				if(!IsAsciiWord(p[i]))
+					break;
+			}
+			return i;
+		}
+		size_t FindUnitScalar0(const char16_t* p, size_t n, char16_t c) {
+			return FindUnitScalar(p, n, c);
+		}
+		size_t FindWordCandidateScalar0(const char16_t* p, size_t n) {
+			return FindWordCandidateScalar(p, n);
+		}
+		size_t SkipAsciiWordScalar0(const char16_t* p, size_t n) {
+			return SkipAsciiWordScalar(p, n);
+		}
+
+	#if defined(SIMDSCAN_SSE2)
+		//! 立っている最下位ビットの位置 (mask != 0)
+		inline int LowestBit(uint32_t mask) {
+		#if defined(_MSC_VER)
+			unsigned long idx;
+			_BitScanForward(&idx, mask);
+			return int(idx);
+		#else
+			return __builtin_ctz(mask);
+		#endif
+		}
+		// ------------------ SSE2 ------------------
+		// 単位は符号付きで比べるが、0x8000以上(負数)はどの範囲にも入らないので問題無い
+		//! ASCIIの英数字, '_', '.'の単位を0xffffにする
+		inline __m128i WordMask(__m128i v) {
+			const __m128i	low = _mm_or_si128(v, _mm_set1_epi16(0x20)),
+							digit = _mm_and_si128(_mm_cmpgt_epi16(v, _mm_set1_epi16('0'-1)),
+												_mm_cmplt_epi16(v, _mm_set1_epi16('9'+1))),
+							alpha = _mm_and_si128(_mm_cmpgt_epi16(low, _mm_set1_epi16('a'-1)),
+												_mm_cmplt_epi16(low, _mm_set1_epi16('z'+1))),
+							sym = _mm_or_si128(_mm_cmpeq_epi16(v, _mm_set1_epi16('_')),
+												_mm_cmpeq_epi16(v, _mm_set1_epi16('.')));
+			return _mm_or_si128(_mm_or_si128(digit, alpha), sym);
+		}
+		//! ASCIIの単位を0xffffにする
+		inline __m128i AsciiMask(__m128i v) {
+			return _mm_cmpeq_epi16(_mm_and_si128(v, _mm_set1_epi16(short(0xff80))), _mm_setzero_si128());
+		}
+		inline __m128i Load(const char16_t* p) {
+			return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		}
+		size_t FindUnitSSE2(const char16_t* p, size_t n, char16_t c) {
+			const __m128i cv = _mm_set1_epi16(short(c));
+			size_t i = 0;
+			for( ; i+8<=n ; i+=8) {
+				const uint32_t m = _mm_movemask_epi8(_mm_cmpeq_epi16(Load(p+i), cv));
+				if(m)
+					return i + LowestBit(m)/2;
+			}
+			return FindUnitScalar(p, n, c, i);
+		}
+		size_t FindWordCandidateSSE2(const char16_t* p, size_t n) {
+			size_t i = 0;
+			for( ; i+8<=n ; i+=8) {
+				const __m128i v = Load(p+i);
+				const uint32_t m = _mm_movemask_epi8(WordMask(v)) | (~_mm_movemask_epi8(AsciiMask(v)) & 0xffff);
+				if(m)
+					return i + LowestBit(m)/2;
+			}
+			return FindWordCandidateScalar(p, n, i);
+		}
+		size_t SkipAsciiWordSSE2(const char16_t* p, size_t n) {
+			size_t i = 0;
+			for( ; i+8<=n ; i+=8) {
+				const uint32_t m = ~_mm_movemask_epi8(WordMask(Load(p+i))) & 0xffff;
+				if(m)
+					return i + LowestBit(m)/2;
+			}
+			return SkipAsciiWordScalar(p, n, i);
+		}
+	#endif
+
+	#if defined(SIMDSCAN_AVX2)
+		// ------------------ AVX2 ------------------
+		#define SIMDSCAN_TARGET_AVX2 __attribute__((target("avx2")))
+		SIMDSCAN_TARGET_AVX2 inline __m256i WordMask256(__m256i v) {
+			const __m256i	low = _mm256_or_si256(v, _mm256_set1_epi16(0x20)),
+							digit = _mm256_and_si256(_mm256_cmpgt_epi16(v, _mm256_set1_epi16('0'-1)),
+													_mm256_cmpgt_epi16(_mm256_set1_epi16('9'+1), v)),
+							alpha = _mm256_and_si256(_mm256_cmpgt_epi16(low, _mm256_set1_epi16('a'-1)),
+													_mm256_cmpgt_epi16(_mm256_set1_epi16('z'+1), low)),
+							sym = _mm256_or_si256(_mm256_cmpeq_epi16(v, _mm256_set1_epi16('_')),
+													_mm256_cmpeq_epi16(v, _mm256_set1_epi16('.')));
+			return _mm256_or_si256(_mm256_or_si256(digit, alpha), sym);
+		}
+		SIMDSCAN_TARGET_AVX2 inline __m256i AsciiMask256(__m256i v) {
+			return _mm256_cmpeq_epi16(_mm256_and_si256(v, _mm256_set1_epi16(short(0xff80))), _mm256_setzero_si256());
+		}
+		SIMDSCAN_TARGET_AVX2 inline __m256i Load256(const char16_t* p) {
+			return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+		}
+		SIMDSCAN_TARGET_AVX2 size_t FindUnitAVX2(const char16_t* p, size_t n, char16_t c) {
+			const __m256i cv = _mm256_set1_epi16(short(c));
+			size_t i = 0;
+			for( ; i+16<=n ; i+=16) {
+				const uint32_t m = _mm256_movemask_epi8(_mm256_cmpeq_epi16(Load256(p+i), cv));
+				if(m)
+					return i + LowestBit(m)/2;
+			}
+			return FindUnitScalar(p, n, c, i);
+		}
+		SIMDSCAN_TARGET_AVX2 size_t FindWordCandidateAVX2(const char16_t* p, size_t n) {
+			size_t i = 0;
+			for( ; i+16<=n ; i+=16) {
+				const __m256i v = Load256(p+i);
+				const uint32_t m = uint32_t(_mm256_movemask_epi8(WordMask256(v))) | ~uint32_t(_mm256_movemask_epi8(AsciiMask256(v)));
+				if(m)
+					return i + LowestBit(m)/2;
+			}
+			return FindWordCandidateScalar(p, n, i);
+		}
+		SIMDSCAN_TARGET_AVX2 size_t SkipAsciiWordAVX2(const char16_t* p, size_t n) {
+			size_t i = 0;
+			for( ; i+16<=n ; i+=16) {
+				const uint32_t m = ~uint32_t(_mm256_movemask_epi8(WordMask256(Load256(p+i))));
+				if(m)
+					return i + LowestBit(m)/2;
+			}
+			return SkipAsciiWordScalar(p, n, i);
+		}
+	#endif
+
+		// ------------------ 実行時の選択 ------------------
+		struct ScanFn {
+			size_t (*findUnit)(const char16_t*, size_t, char16_t);
+			size_t (*findWordCandidate)(const char16_t*, size_t);
+			size_t (*skipAsciiWord)(const char16_t*, size_t);
+		};
+		//! 命令セット毎の実装 (ビルドできなかった物はScalarで埋めるが、選ばれる事は無い)
+		const ScanFn c_scanFn[SimdLevel::_Num] = {
+			{FindUnitScalar0, FindWordCandidateScalar0, SkipAsciiWordScalar0},
+		#if defined(SIMDSCAN_SSE2)
+			{FindUnitSSE2, FindWordCandidateSSE2, SkipAsciiWordSSE2},
+		#else
+			{FindUnitScalar0, FindWordCandidateScalar0, SkipAsciiWordScalar0},
+		#endif
+		#if defined(SIMDSCAN_AVX2)
+			{FindUnitAVX2, FindWordCandidateAVX2, SkipAsciiWordAVX2}
+		#else
+			{FindUnitScalar0, FindWordCandidateScalar0, SkipAsciiWordScalar0}
+		#endif
+		};
+		SimdLevel::Type DetectLevel() {
+		#if defined(SIMDSCAN_AVX2)
+			// OSがAVXのレジスタを保存しない場合もfalseになる
+			__builtin_cpu_init();
+			if(__builtin_cpu_supports("avx2"))
+				return SimdLevel::AVX2;
+		#endif
+		#if defined(SIMDSCAN_SSE2)
+			return SimdLevel::SSE2;
+		#else
+			return SimdLevel::Scalar;
+		#endif
+		}
+		//! 使用中の命令セット (負数なら未選択)
+		std::atomic<int> g_level(-1);
+
+		const ScanFn& Fn() {
+			int level = g_level.load(std::memory_order_relaxed);
+			if(level < 0) {
+				level = GetSupportedSimdLevel();
+				g_level.store(level, std::memory_order_relaxed);
+			}
+			return c_scanFn[level];
+		}
+	}
+	SimdLevel::Type GetSimdLevel() {
+		Fn();
+		return static_cast<SimdLevel::Type>(g_level.load(std::memory_order_relaxed));
+	}
+	SimdLevel::Type GetSupportedSimdLevel() {
+		static const SimdLevel::Type s_level = DetectLevel();
+		return s_level;
+	}
+	SimdLevel::Type SetSimdLevel(SimdLevel::Type level) {
+		if(level < SimdLevel::Scalar || level >= SimdLevel::_Num || level > GetSupportedSimdLevel())
+			level = GetSupportedSimdLevel();
+		g_level.store(level, std::memory_order_relaxed);
+		return level;
+	}
+	const char* GetSimdLevelName(SimdLevel::Type level) {
+		switch(level) {
+			case SimdLevel::Scalar:	return "scalar";
+			case SimdLevel::SSE2:	return "sse2";
+			case SimdLevel::AVX2:	return "avx2";
+			default:				return "";
+		}
+	}
+	size_t SimdFindUnit(const char16_t* p, size_t n, char16_t c) {
+		return Fn().findUnit(p, n, c);
+	}
+	size_t SimdFindWordCandidate(const char16_t* p, size_t n) {
+		return Fn().findWordCandidate(p, n);
+	}
+	size_t SimdSkipAsciiWord(const char16_t* p, size_t n) {
+		return Fn().skipAsciiWord(p, n);
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+
+namespace glsl {
+	//! UTF-16の単位列を纏めて分類する検索で使う命令セット
+	/*! 最初の検索時にCPUを調べて使える中で最も速い物を選ぶ。
+		x86以外やSIMDの組み込み関数が使えないコンパイラでは常にScalar */
+	struct SimdLevel {
+		enum Type {
+			Scalar,		//!< 1単位ずつ調べる
+			SSE2,		//!< 8単位ずつ
+			AVX2,		//!< 16単位ずつ
+			_Num
+		};
+	};
+	//! 使用中の命令セット
+	SimdLevel::Type GetSimdLevel();
+	//! CPUが対応している最も速い命令セット
+	SimdLevel::Type GetSupportedSimdLevel();
+	//! 使う命令セットを変える (計測用。対応していなければ対応している中で最も速い物にする)
+	/*! \return 実際に使う命令セット */
+	SimdLevel::Type SetSimdLevel(SimdLevel::Type level);
+	//! "scalar", "sse2", "avx2"
+	const char* GetSimdLevelName(SimdLevel::Type level);
+
+	//! [p, p+n)で最初にcと等しい単位の位置 (無ければn)
+	size_t SimdFindUnit(const char16_t* p, size_t n, char16_t c);
+	//! 最初に単語の先頭に成り得る単位の位置 (無ければn)
+	/*! ASCIIの英数字, '_', '.'と、表を引かないと分からない非ASCIIの単位 */
+	size_t SimdFindWordCandidate(const char16_t* p, size_t n);
+	//! 最初にASCIIの英数字, '_', '.'以外の単位の位置 (非ASCIIも含む。無ければn)
+	size_t SimdSkipAsciiWord(const char16_t* p, size_t n);
+}
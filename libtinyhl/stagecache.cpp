@@ -0,0 +1,55 @@
+#include "stagecache.h"
+#include <QCryptographicHash>
+
+namespace glsl {
+	// ------------------ StageCache::Stat ------------------
+	StageCache::Stat& StageCache::Stat::operator += (const Stat& s) {
+		hit += s.hit;
+		miss += s.miss;
+		return *this;
+	}
+	// ------------------ StageCache ------------------
+	StageCache::StageCache(int maxEntry):
+		_maxEntry(maxEntry)
+	{}
+	QByteArray StageCache::MakeKey(Shader::Type type, const QString& src) {
+		QCryptographicHash h(QCryptographicHash::Sha1);
+		const quint32 t = type;
+		h.addData(reinterpret_cast<const char*>(&t), sizeof(t));
+		h.addData(reinterpret_cast<const char*>(src.constData()), src.size()*sizeof(QChar));
+		return h.result();
+	}
+	bool StageCache::find(const QByteArray& key, Stage& dst) {
+		auto itr = _map.find(key);
+		if(itr == _map.end()) {
+			++_stat.miss;
+			return false;
+		}
+		_lru.splice(_lru.begin(), _lru, itr.value());
+		dst = itr.value()->stage;
+		++_stat.hit;
+		return true;
+	}
+	void StageCache::store(const QByteArray& key, const Stage& stage) {
+		auto itr = _map.find(key);
+		if(itr != _map.end()) {
+			itr.value()->stage = stage;
+			_lru.splice(_lru.begin(), _lru, itr.value());
+			return;
+		}
+		_lru.push_front(Entry{key, stage});
+		_map.insert(key, _lru.begin());
+		// 使用中のプログラムはshared_ptrで保持しているので、ここで捨てても構わない
+		while(static_cast<int>(_lru.size()) > _maxEntry) {
+			_map.remove(_lru.back().key);
+			_lru.pop_back();
+		}
+	}
+	void StageCache::clear() {
+		_lru.clear();
+		_map.clear();
+	}
+	StageCache::Stat StageCache::stat() const {
+		return _stat;
+	}
+}
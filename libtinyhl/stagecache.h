@@ -0,0 +1,55 @@
+#pragma once
+#include "glsl.h"
+#include <QByteArray>
+#include <QHash>
+#include <QOpenGLShader>
+#include <QString>
+#include <list>
+#include <memory>
+
+namespace glsl {
+	//! コンパイル済みのステージ(シェーダーオブジェクト)をステージ種別とソースの組で再利用する
+	/*! 多くのプログラムが同じステージのソースを使っていても、コンパイルは1度で済む。
+		コンパイルに失敗したステージもログごと覚えておく。
+		シェーダーオブジェクトは作成したコンテキスト(と共有するコンテキスト)でしか使えないので、Compiler毎に持つ。
+		上限を超えたら最も長く使われていない物から捨てる(LRU)。1つのスレッドから使うこと */
+	class StageCache {
+		public:
+			using SPShader = std::shared_ptr<QOpenGLShader>;
+			struct Stage {
+				SPShader	shader;		//!< コンパイル済みのシェーダー (コンテキストが対応していなければnullptr)
+				bool		bOk;
+				QString		log;
+			};
+			//! キャッシュの利用状況
+			struct Stat {
+				quint64	hit = 0,
+						miss = 0;
+
+				Stat& operator += (const Stat& s);
+			};
+		private:
+			struct Entry {
+				QByteArray	key;
+				Stage		stage;
+			};
+			//! 先頭ほど最近使われたエントリ
+			using EntryL = std::list<Entry>;
+			using EntryMap = QHash<QByteArray, EntryL::iterator>;
+
+			EntryL		_lru;
+			EntryMap	_map;
+			int			_maxEntry;
+			Stat		_stat;
+		public:
+			/*! \param[in] maxEntry	保持するステージ数の上限 */
+			StageCache(int maxEntry = 512);
+			//! ステージ種別とソースからキーを作る
+			static QByteArray MakeKey(Shader::Type type, const QString& src);
+			//! \return 無ければfalse
+			bool find(const QByteArray& key, Stage& dst);
+			void store(const QByteArray& key, const Stage& stage);
+			void clear();
+			Stat stat() const;
+	};
+}
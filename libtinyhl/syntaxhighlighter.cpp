@@ -1,362 +1,269 @@
-#include <QJsonObject>
-#include <QJsonArray>
-#include <QJsonDocument>
-#include <QFile>
-#include <QDir>
 #include "syntaxhighlighter.h"
-
-#define DEF_STRING(str)	const QString str = #str;
-// JSONファイルのエントリ文字列
-namespace JEnt {
-	// キーワード定義ファイルで使用
-	namespace Keyword {
-		DEF_STRING(type)
-		DEF_STRING(string)
-		DEF_STRING(regex)
-		DEF_STRING(case_sensitive)
-		DEF_STRING(auto_spacing)
-		DEF_STRING(words)
-	}
-	// ハイライト定義ファイルで使用
-	namespace Highlight {
-		DEF_STRING(highlights)
-		DEF_STRING(italic)
-		DEF_STRING(bold)
-		DEF_STRING(underline)
-		DEF_STRING(color)
-	}
-	// ハイライト定義における"コメント"用エントリ名
-	const std::string comment("comment");
-	// コメントブロックとキーワード境界定義ファイルで使用
-	namespace Block {
-		DEF_STRING(comment_line)
-		DEF_STRING(comment_begin)
-		DEF_STRING(comment_end)
-		DEF_STRING(keyword)
-	}
-}
-#undef DEF_STRING
+#include <QTextBlock>
+#include <QTextDocument>
+#include <QFutureWatcher>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QTextEdit>
+#include <QScrollBar>
+#include <QTimer>
+#include <algorithm>
 
 namespace glsl {
 	// ------------------ SyntaxHighlighter ------------------
-	SyntaxHighlighter::TextFormat::TextFormat(const QJsonObject& o) {
-		loadFromJson(o);
+	namespace {
+		//! 1イベント処理でハイライトに使う時間の目安 (ms)
+		const int c_sliceMs = 20;
+		//! 最初にハイライトする先頭からの行数 (ビューポートの位置が分かるまで)
+		const int c_initialWindow = 200;
 	}
-	void SyntaxHighlighter::TextFormat::loadFromJson(const QJsonObject& o) {
-		namespace Highlight = JEnt::Highlight;
-		// Italicフラグ: デフォルト値=false
-		auto itr = o.find(Highlight::italic);
-		bool b = false;
-		if(itr != o.end())
-			b = itr.value().toBool(false);
-		setFontItalic(b);
-		// Boldフラグ: デフォルト値=QFont::Normal
-		int w = QFont::Normal;
-		itr = o.find(Highlight::bold);
-		if(itr != o.end())
-			w = itr.value().toBool(false) ? QFont::Bold : QFont::Normal;
-		setFontWeight(w);
-		// Underlineフラグ: デフォルト値=false
-		b = false;
-		itr = o.find(Highlight::underline);
-		if(itr != o.end())
-			b = itr.value().toBool(false);
-		setFontUnderline(b);
-		// Color RGB: デフォルト値=(128,128,128)
-		QColor col(128,128,128);
-		itr = o.find(Highlight::color);
-		if(itr != o.end()) {
-			QJsonArray ar = itr.value().toArray();
-			if(ar.size() == 3)
-				col.setRgb(ar[0].toInt(), ar[1].toInt(), ar[2].toInt());
+	//! ブロック毎のハイライト結果
+	class SyntaxHighlighter::BlockMemo : public QTextBlockUserData {
+		public:
+			int				generation = -1;	//!< 結果を求めた時のルールセットの番号 (SyntaxHighlighter::_generation)
+			QString			text;				//!< 結果を求めた時のテキスト (暗黙共有なので複製はしない)
+			bool			bValid = false;		//!< textの結果を持っているか
+			int				inState = -1,		//!< 前のブロックから受け取った状態
+							outState = 0;
+			SpanV			span;
+	};
+	void SyntaxHighlighter::highlightBlock(const QString& text) {
+		_beginSlice();
+		if(!_line) {
+			setCurrentBlockState(0);
+			return;
 		}
-		setForeground(col);
+		const int inState = std::max(previousBlockState(), 0);
+		auto* memo = dynamic_cast<BlockMemo*>(currentBlockUserData());
+		// ハッシュ値は衝突し得るので、テキストそのものを比べる (長さが違えばすぐに終わる)
+		const bool bSameText = memo && memo->bValid && memo->generation == _generation && memo->text == text;
+		if(bSameText && memo->inState == inState) {
+			// テキストも入力状態も同じなので結果も前回と同じ
+			_applyMemo(*memo);
+			setCurrentBlockState(memo->outState);
+			return;
+		}
+		if(!memo) {
+			memo = new BlockMemo();
+			setCurrentBlockUserData(memo);
+		}
+		if(_canDefer(bSameText)) {
+			// 書式と状態は前回の物を仮に使って伝播を止め、続きは後で行う
+			// (memo->inStateが前のブロックの状態と食い違うので_resumeで見つけられる)
+			if(bSameText) {
+				_applyMemo(*memo);
+				setCurrentBlockState(memo->outState);
+			} else {
+				// 一度もハイライトしていない行
+				memo->generation = _generation;
+				memo->text.clear();
+				memo->bValid = false;
+				memo->inState = -1;
+				memo->span.clear();
+				setCurrentBlockState(LineHighlighter::UnknownState);
+			}
+			_scheduleResume(currentBlock());
+			return;
+		}
+		memo->generation = _generation;
+		memo->text = text;
+		memo->bValid = true;
+		memo->inState = inState;
+		memo->span.clear();
+		memo->outState = _line->highlight(text, inState, memo->span);
+		setCurrentBlockState(memo->outState);
 	}
-	SyntaxHighlighter::Keywords::Keywords(const QJsonObject& o) {
-		loadFromJson(o);
+	bool SyntaxHighlighter::_canDefer(bool bSameText) const {
+		if(_view) {
+			// ビューポート付近の行は常にすぐ処理する
+			const int num = currentBlock().blockNumber();
+			if(num >= _winFirst && num <= _winLast)
+				return false;
+			// それ以外はアイドル時の処理に任せる
+			if(!_bFill)
+				return true;
+		} else if(!bSameText) {
+			// 書き換えられた行はすぐ処理する
+			return false;
+		}
+		return _slice.elapsed() >= c_sliceMs;
 	}
-	void SyntaxHighlighter::Keywords::loadFromJson(const QJsonObject& o) {
-		namespace Keyword = JEnt::Keyword;
-		_strV.clear();
-		_regV.clear();
-		// AutoSpacingフラグ: デフォルト値=false
-		bool b = false;
-		auto itr = o.find(Keyword::auto_spacing);
-		if(itr != o.end())
-			b = itr.value().toBool(false);
-		_bAutoSpacing = b;
-		// CaseSensitiveフラグ: デフォルト値=false
-		b = false;
-		itr = o.find(Keyword::case_sensitive);
-		if(itr != o.end())
-			b = itr.value().toBool(false);
-		_bCaseSensitive = b;
-		// String or RegEx: デフォルト値=string
-		QString strType = o.value(Keyword::type).toString(Keyword::string);
-		bool bIsRegex = strType == Keyword::regex;
-
-		QJsonArray ar = o.value(Keyword::words).toArray();
-		for(const auto& w : ar) {
-			QString word = w.toString();
-			if(!word.isEmpty()) {
-				if(bIsRegex) {
-					// 正規表現によるキーワード指定
-					_regV.emplace_back(word,
-									   _bCaseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive);
-				} else {
-					// 文字列によるキーワード指定
-					_strV.emplace_back(word);
-				}
-			}
+	void SyntaxHighlighter::_applyMemo(const BlockMemo& memo) {
+		for(auto& sp : memo.span) {
+			// 表に無い種別(ルールセットと食い違った結果)は色付けしない
+			const size_t idx = size_t(sp.kind - LineHighlighter::Comment);
+			if(idx < _format.size())
+				setFormat(sp.offset, sp.length, *_format[idx]);
 		}
 	}
-	SyntaxHighlighter::BlockDef::BlockDef(const QJsonObject& o) {
-		namespace Block = JEnt::Block;
-		_cmmLine.setPattern(o.value(Block::comment_line).toString("//"));
-		_cmmBegin.setPattern(o.value(Block::comment_begin).toString("/\\*"));
-		_cmmEnd.setPattern(o.value(Block::comment_end).toString("\\*/"));
-		_keyword.setPattern(o.value(Block::keyword).toString("[\\w\\.]+"));
+	void SyntaxHighlighter::_beginSlice() {
+		if(_bSlice)
+			return;
+		_bSlice = true;
+		_slice.start();
+		// 今のイベント処理が終わったら計測し直す
+		QMetaObject::invokeMethod(this, "_endSlice", Qt::QueuedConnection);
 	}
-	QRegExp& SyntaxHighlighter::BlockDef::getCommentLine() { return _cmmLine; }
-	QRegExp& SyntaxHighlighter::BlockDef::getCommentBegin() { return _cmmBegin; }
-	QRegExp& SyntaxHighlighter::BlockDef::getCommentEnd() { return _cmmEnd; }
-	QRegExp& SyntaxHighlighter::BlockDef::getKeyword() { return _keyword; }
-
-	void SyntaxHighlighter::highlightBlock(const QString& text) {
-		setCurrentBlockState(0);
-		if(!_blockDef)
+	void SyntaxHighlighter::_endSlice() {
+		_bSlice = false;
+	}
+	void SyntaxHighlighter::_scheduleResume(const QTextBlock& block) {
+		// 再開位置は編集に追従するようカーソルで覚えておく
+		if(_resumeCursor.isNull() || block.position() < _resumeCursor.position())
+			_resumeCursor = QTextCursor(block);
+		if(_bResumePending)
 			return;
-
-		enum class TokenType {
-			Keyword,
-			CommentStart,
-			CommentLine,
-			_Num
-		};
-		struct Token {
-			int			offset;
-			TokenType	type;
-			int			length;
-		};
-
-		enum class SyntaxState {
-			Normal,
-			InCommentBlock
-		};
-		auto& fmt_comment = _getFormat(JEnt::comment);
-		int length = text.length();
-
-		QRegExp &startMark = _blockDef->getCommentBegin(),
-				&endMark = _blockDef->getCommentEnd(),
-				&lineMark = _blockDef->getCommentLine(),
-				&keywordRE = _blockDef->getKeyword();
-		SyntaxState state = (previousBlockState() == 1) ?
-								SyntaxState::InCommentBlock :
-								SyntaxState::Normal;
-		int cursor = 0;
-		for(;;) {
-			switch(state) {
-				case SyntaxState::Normal: {
-					Token tokens[static_cast<int>(TokenType::_Num)] = {
-						{text.indexOf(keywordRE, cursor), TokenType::Keyword, keywordRE.matchedLength()},
-						{text.indexOf(startMark, cursor), TokenType::CommentStart, startMark.matchedLength()},
-						{text.indexOf(lineMark, cursor), TokenType::CommentLine, lineMark.matchedLength()}
-					};
-					for(auto& t : tokens) {
-						if(t.offset < 0)
-							t.offset = std::numeric_limits<int>::max();
-					}
-					std::sort(tokens, tokens+sizeof(tokens)/sizeof(tokens[0]), [](const Token& t0, const Token& t1){
-						return t0.offset < t1.offset;
-					});
-					auto& cur_token = tokens[0];
-					// 何も見つからなければ終了
-					if(cur_token.offset == std::numeric_limits<int>::max())
-						return;
-
-					switch(cur_token.type) {
-						case TokenType::Keyword: {
-							bool bFound = false;
-							// どのキーワードに該当するか探索
-							std::pair<int,int> kwd_result{std::numeric_limits<int>::max(), -1};
-							QTextCharFormat fmt;
-							for(auto& p : _pairV) {
-								auto res = p.keyword->match(text, cur_token.offset);
-								if(res.second > 0) {
-									if(res.first < kwd_result.first) {
-										bFound = true;
-										kwd_result = res;
-										fmt = *p.format;
-									}
-								}
-							}
-							if(bFound) {
-								// キーワードに色付け
-								setFormat(kwd_result.first, kwd_result.second, fmt);
-							}
-						} break;
-						case TokenType::CommentStart:
-							setFormat(cur_token.offset, cur_token.length, fmt_comment);
-							state = SyntaxState::InCommentBlock;
-							break;
-						case TokenType::CommentLine:
-							// 行最後までコメントアウト
-							setFormat(cur_token.offset, length-cur_token.offset, fmt_comment);
-							return;
-						default:
-							break;
-					}
-					cursor = cur_token.offset + cur_token.length;
-				} break;
-
-				case SyntaxState::InCommentBlock: {
-					// CommentEndを探す
-					int idx = text.indexOf(endMark, cursor);
-					if(idx >= 0) {
-						// endMarkまでコメントアウト
-						setFormat(cursor, idx+endMark.matchedLength() - cursor, fmt_comment);
-						cursor = idx+endMark.matchedLength();
-						state = SyntaxState::Normal;
-					} else {
-						// 次の行へコメントが続いている
-						setFormat(cursor, length-cursor, fmt_comment);
-						setCurrentBlockState(1);
-						return;
-					}
-				} break;
-			}
-		}
+		_bResumePending = true;
+		// 入力イベント等を先に処理させる
+		QTimer::singleShot(0, this, SLOT(_resume()));
 	}
 	namespace {
-		//! 文字列中のキーワードをRegExかStringのいづれかの形式で探す
-		struct KeywordMatch {
-			static int Length(const QRegExp& r) { return r.matchedLength(); }
-			static int Length(const QString& s) { return s.length(); }
-			static QString String(const QString& s) { return s; }
-			static QString String(const QRegExp& r) { return r.pattern(); }
-
-			const QString&	_text;
-			int				_baseOffset,	//!< 検索開始オフセット
-							_offset,
-							_length;
-			bool			_bCaseSensitive,
-							_bAutoSpacing;
-			/*! \param[in] text			検索対象のテキスト
-				\param[in] ofs			検索開始する位置
-				\param[in] autospace	キーワードの両側が非wordと仮定するか	*/
-			KeywordMatch(const QString& text, int ofs, bool bCase, bool bAutoSpace):
-				_text(text),
-				_baseOffset(ofs),
-				_offset(text.length()),
-				_length(-1),
-				_bCaseSensitive(bCase),
-				_bAutoSpacing(bAutoSpace)
-			{}
-			int _indexOf(const QRegExp& r) const {
-				return _text.indexOf(const_cast<QRegExp&>(r), _baseOffset);
-			}
-			int _indexOf(const QString& str) const {
-				// case_sensitiveフラグが立っているならここで指定
-				return _text.indexOf(str,
-									_baseOffset,
-									_bCaseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive);
-			}
-
-			template <class T>
-			void proc(const T& t) {
-				int idx = _indexOf(t);
-				if(idx >= 0) {
-					int len = Length(t);
-					// auto_spacingフラグが立っている時はキーワードの両側が非wordかをチェック
-					if(_bAutoSpacing) {
-						if((idx + len >= _text.length() ||
-							!_text.at(idx+len).isLetterOrNumber()) &&
-							(idx == 0 || !_text.at(idx-1).isLetterOrNumber()))
-						{} else
-							return;
-					}
-					// 前回より検出位置が手前なら結果を上書き
-					if(_offset > idx) {
-						_offset = idx;
-						_length = len;
-					}
-					// 前回と位置が同じならキーワード長が長い方を採用
-					else if(_offset == idx) {
-						if(_length < len)
-							_length = len;
-					}
-				}
-			}
-		};
+		int PrevState(const QTextBlock& b) {
+			const QTextBlock prev = b.previous();
+			return prev.isValid() ? std::max(prev.userState(), 0) : 0;
+		}
 	}
-	std::pair<int,int> SyntaxHighlighter::Keywords::match(const QString& text, int offset) const {
-		KeywordMatch m(text, offset, _bCaseSensitive, _bAutoSpacing);
-		for(auto& k : _strV)
-			m.proc(k);
-		for(auto& r : _regV)
-			m.proc(r);
-		return std::make_pair(m._offset, m._length);
+	bool SyntaxHighlighter::_IsStale(const QTextBlock& b, int prevState) {
+		auto* memo = dynamic_cast<BlockMemo*>(b.userData());
+		return memo && memo->inState != prevState;
+	}
+	void SyntaxHighlighter::_resume() {
+		_bResumePending = false;
+		// 並列ハイライト中は結果を待つ (終わったら再開する)
+		if(!document() || _resumeCursor.isNull() || (_parallel && _parallel->isRunning()))
+			return;
+		QTextBlock b = _resumeCursor.block();
+		_resumeCursor = QTextCursor();
+		// 後回しにした最初のブロックから再開
+		for(int prev = PrevState(b) ; b.isValid() ; b = b.next()) {
+			if(_IsStale(b, prev)) {
+				// 新しいタイムスライスとして処理する
+				_bSlice = false;
+				_bFill = true;
+				rehighlightBlock(b);
+				_bFill = false;
+				return;
+			}
+			prev = std::max(b.userState(), 0);
+		}
 	}
-	void SyntaxHighlighter::_refreshPairV() {
-		_pairV.clear();
-		for(auto& k : _keywordMap) {
-			Pair p;
-			p.keywordName = k.first;
-			QString str = QString::fromStdString(k.first);
-			p.format = &_getFormat(k.first);
-			p.keyword = &k.second;
-			_pairV.push_back(std::move(p));
+	void SyntaxHighlighter::setView(QTextEdit* view) {
+		if(_view)
+			_view->verticalScrollBar()->disconnect(this);
+		_view = view;
+		_winFirst = 0;
+		_winLast = c_initialWindow;
+		if(view) {
+			connect(view->verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(_onScroll()));
+			connect(view->verticalScrollBar(), SIGNAL(rangeChanged(int,int)), this, SLOT(_onScroll()));
 		}
 	}
-	const QTextCharFormat& SyntaxHighlighter::_getFormat(const std::string& name) const {
-		auto itr = _formatMap.find(name);
-		if(itr != _formatMap.end())
-			return itr->second;
-		return _formatDefault;
+	void SyntaxHighlighter::_onScroll() {
+		if(!_view || !document())
+			return;
+		const QRect rc = _view->viewport()->rect();
+		const int first = _view->cursorForPosition(rc.topLeft()).blockNumber(),
+				last = _view->cursorForPosition(rc.bottomLeft()).blockNumber(),
+				// 前後1画面分は先読みしておく
+				margin = last - first + 1;
+		_winFirst = std::max(0, first - margin);
+		_winLast = last + margin;
+		// 見えている範囲で後回しになっているブロックを優先して処理
+		QTextBlock b = document()->findBlockByNumber(_winFirst);
+		for(int prev = PrevState(b) ; b.isValid() && b.blockNumber() <= _winLast ; b = b.next()) {
+			if(_IsStale(b, prev))
+				rehighlightBlock(b);
+			prev = std::max(b.userState(), 0);
+		}
 	}
-	QJsonDocument SyntaxHighlighter::_LoadJson(const QString& path) {
-		QFile file;
-		file.setFileName(path);
-		if(!file.open(QFile::ReadOnly))
-			throw std::runtime_error("can't read file");
-
-		QJsonParseError err;
-		QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &err);
-		if(err.error != QJsonParseError::NoError)
-			throw std::runtime_error(err.errorString().toStdString());
-		return std::move(doc);
+	void SyntaxHighlighter::highlightParallel() {
+		if(!_line || !document())
+			return;
+		if(!_parallel) {
+			_parallel = new ParallelWatcher(this);
+			connect(_parallel, SIGNAL(finished()), this, SLOT(_onParallelFinished()));
+		} else if(_parallel->isRunning()) {
+			// GUIスレッドを止めないよう、今の処理が終わってからやり直す
+			_bParallelAgain = true;
+			return;
+		}
+		// ワーカーには文書のコピーを渡す
+		QStringList lines;
+		lines.reserve(document()->blockCount());
+		for(QTextBlock b = document()->begin() ; b.isValid() ; b = b.next())
+			lines.append(b.text());
+		_parallelLines = lines;
+		_parallelGeneration = _generation;
+		// ルールセットはコピーが保持するので、途中で差し替えられても構わない
+		const std::shared_ptr<const LineHighlighter> line = std::make_shared<LineHighlighter>(*_line);
+		_parallel->setFuture(QtConcurrent::run([line, lines](){
+			return line->highlightAll(lines);
+		}));
 	}
-	void SyntaxHighlighter::loadUserFormat(const QString& path) {
-		QJsonDocument doc = _LoadJson(path);
-		_formatMap.clear();
-		QJsonObject root = doc.object();
-		auto itr = root.find(JEnt::Highlight::highlights);
-		if(itr != root.end()) {
-			QJsonObject ent = itr.value().toObject();
-			for(auto itr2 = ent.begin() ; itr2 != ent.end() ; itr2++)
-				_formatMap.emplace(itr2.key().toStdString(), TextFormat(itr2.value().toObject()));
+	void SyntaxHighlighter::_onParallelFinished() {
+		const LineResultV res = _parallel->result();
+		const QStringList lines = _parallelLines;
+		_parallelLines.clear();
+		if(document() && _generation == _parallelGeneration) {
+			// テキストがコピーと同じブロックにだけ結果を覚えさせる
+			// (編集された行は覚えている結果と食い違うので、highlightBlockでハイライトし直される)
+			int nApplied = 0,
+				i = 0;
+			for(QTextBlock b = document()->begin() ; b.isValid() && i<int(res.size()) ; b = b.next(), ++i) {
+				const QString text = b.text();
+				if(text != lines[i])
+					continue;
+				auto* memo = dynamic_cast<BlockMemo*>(b.userData());
+				if(!memo) {
+					memo = new BlockMemo();
+					b.setUserData(memo);
+				}
+				memo->generation = _parallelGeneration;
+				memo->text = text;
+				memo->bValid = true;
+				memo->inState = res[i].inState;
+				memo->outState = res[i].outState;
+				memo->span = res[i].span;
+				++nApplied;
+			}
+			// ブロック毎に呼ぶとその度にレイアウトし直すので、文書全体を一度に処理する
+			// (入力状態も合っているブロックは覚えた書式を適用するだけで済む)
+			if(nApplied > 0) {
+				_bSlice = false;
+				_bFill = true;
+				rehighlight();
+				_bFill = false;
+			}
+		}
+		if(_bParallelAgain) {
+			_bParallelAgain = false;
+			highlightParallel();
+		} else if(!_resumeCursor.isNull()) {
+			// 適用できなかったブロックはアイドル時の処理に任せる
+			_scheduleResume(_resumeCursor.block());
 		}
-		_refreshPairV();
 	}
-	void SyntaxHighlighter::loadDefine(const QString& path) {
-		QDir dir(path);
-		QStringList filter;
-		filter << "*.json";
-		QStringList files = dir.entryList(filter);
-		for(auto& f : files) {
-			// ファイル名から拡張子を除く
-			QRegExp re(R"(([\w\d_]+)\.json)");
-			f.indexOf(re);
-			QString fileName = re.capturedTexts()[1];
-
-			_keywordMap.emplace(fileName.toStdString(), Keywords(_LoadJson(path + '/' + f).object()));
+	void SyntaxHighlighter::setRuleSet(const SPRuleSet& rules) {
+		// 同じルールセットなら字句解析器はそのまま使い、覚えている結果だけを捨てる
+		if(rules != _rules) {
+			_rules = rules;
+			_line.reset((rules && rules->blockDef()) ? new LineHighlighter(rules) : nullptr);
 		}
-		_refreshPairV();
+		++_generation;
+		_makeFormatTable();
+		rehighlight();
 	}
-	void SyntaxHighlighter::loadBlockDefine(const QString& path) {
-		QJsonDocument doc = _LoadJson(path);
-		QJsonObject root = doc.object();
-		_blockDef.reset(new BlockDef(root));
+	const SPRuleSet& SyntaxHighlighter::ruleSet() const { return _rules; }
+	void SyntaxHighlighter::_makeFormatTable() {
+		_format.clear();
+		if(!_rules)
+			return;
+		const auto fnGet = [this](const QTextCharFormat* fmt) {
+			return fmt ? fmt : &_formatDefault;
+		};
+		static_assert(LineHighlighter::Comment == -1, "Comment must precede the category numbers");
+		_format.push_back(fnGet(_rules->commentFormat()));
+		for(int i=0 ; i<int(_rules->categories().size()) ; i++)
+			_format.push_back(fnGet(_rules->format(i)));
 	}
 	QTextCharFormat& SyntaxHighlighter::defaultFormat() { return _formatDefault; }
 }
@@ -1,112 +1,96 @@
 #pragma once
 #include <QSyntaxHighlighter>
 #include <QTextCharFormat>
-#include <unordered_map>
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QTextCursor>
+#include <QStringList>
 #include <memory>
+#include <vector>
+#include "linehighlighter.h"
 
+class QTextEdit;
+template <class T>
+class QFutureWatcher;
 namespace glsl {
 	//! GLSLの各キーワードをハイライトする
+	/*! ハイライト定義(RuleSet)は読み込み済みの物を複数のインスタンスで共有する。
+		ブロックの状態にはブロックコメント、ディレクティブの継続行(\\)、#if 0の入れ子の深さを持たせ、
+		ブロック毎の結果をQTextBlockUserDataに覚えておく。
+		テキストも入力状態も前回と同じブロックは覚えておいた書式をそのまま使い、
+		一度のイベント処理で時間を使い過ぎた時は残りのブロックを次のイベントループに回す。
+		setViewで表示するQTextEditを指定した場合はビューポート付近のブロックだけをすぐにハイライトし、
+		残りはアイドル時に少しずつ処理する (スクロールで見えたブロックは優先して処理) */
 	class SyntaxHighlighter : public QSyntaxHighlighter {
 		Q_OBJECT
-		//! テキストをハイライトする時の色やフォント
-		class TextFormat : public QTextCharFormat {
-			public:
-				using QTextCharFormat::QTextCharFormat;
-				TextFormat(const QJsonObject& o);
-				void loadFromJson(const QJsonObject& o);
-		};
-		//! キーワード定義 (string or regex)
-		/*! JSONフォーマット:
-			"type": "string" or "regex",
-			"auto_spacing":	bool,
-			"": bool,
-			"words": [
-				"keyword0",
-				"keyword1", ...
-			]
-		*/
-		class Keywords {
-			using StrV = std::vector<QString>;
-			using RegV = std::vector<QRegExp>;
-			// StrVかRegVのどちらか片方が使用される
-			StrV	_strV;
-			RegV	_regV;
-			bool	_bCaseSensitive,	//!< 大文字小文字を区別するか
-					_bAutoSpacing;		//!< キーワード前後の非wordを想定するか
-			public:
-				Keywords(const QJsonObject& o);
-				//! JSONで記述されたキーワード定義を読み込む
-				void loadFromJson(const QJsonObject& o);
-				//! キーワードが文字列中に存在するかチェック
-				/*! \param[in] text	チェックする文字列
-					\param[in] offset チェック開始するオフセット
-					\return <int: キーワードのオフセット(負数は無効), int: キーワード長> */
-				std::pair<int,int> match(const QString& text, int offset) const;
-		};
-		//! コメント・キーワード境界定義(regex)
-		/*! JSONフォーマット(例):
-			"comment_line": "//",
-			"comment_begin": "/\\*",
-			"comment_end": "\\* /",
-			"keyword": "[\\w\\.]+"
-		*/
-		class BlockDef {
-			QRegExp	_cmmLine,
-					_cmmBegin, _cmmEnd,
-					_keyword;
-			public:
-				BlockDef(const QJsonObject& o);
-				QRegExp& getCommentLine();
-				QRegExp& getCommentBegin();
-				QRegExp& getCommentEnd();
-				QRegExp& getKeyword();
-		};
-
+		using SpanV = LineHighlighter::SpanV;
+		class BlockMemo;
 		//! テキストハイライト定義が存在しない場合のデフォルト値
 		QTextCharFormat	_formatDefault;
-		//! ハイライト定義名に対応したフォーマットを取得
-		/*! 定義名が見つからなければデフォルト値を返す */
-		const QTextCharFormat& _getFormat(const std::string& name) const;
-
-		using FormatMap = std::unordered_map<std::string, TextFormat>;
-		using KeywordMap = std::unordered_map<std::string, Keywords>;
-		using UPBlockDef = std::unique_ptr<BlockDef>;
-		struct Pair {
-			std::string				keywordName;
-			const QTextCharFormat*	format;
-			const Keywords*			keyword;
-		};
-		using PairV = std::vector<Pair>;
-
-		//! テキストハイライト定義マップ (定義名とその値)
-		FormatMap		_formatMap;
-		//! キーワード定義マップ (定義名とその値)
-		KeywordMap		_keywordMap;
-		//! (Format, Keyword)に対し、同じ定義名のエントリをvectorで纏めた物
-		PairV			_pairV;
-		UPBlockDef		_blockDef;
+		SPRuleSet		_rules;
+		//! setRuleSet毎に増やす番号 (BlockMemoが今のルールセットで求めた物かを調べる)
+		/*! 解放されたルールセットと同じアドレスに別の物が読み込まれても取り違えない */
+		int				_generation = 0;
+		//! Spanの種別 - LineHighlighter::Comment をインデックスとする書式表
+		/*! setRuleSetで作り、定義の無い種別は_formatDefaultを指す (行毎の処理では引くだけにする) */
+		using FormatTable = std::vector<const QTextCharFormat*>;
+		FormatTable		_format;
+		//! 行毎のハイライト処理 (block.jsonが無ければnullptr)
+		std::unique_ptr<LineHighlighter>	_line;
+		//! 今回のイベント処理でハイライトに使った時間
+		QElapsedTimer	_slice;
+		bool			_bSlice = false,			//!< _sliceを計測中か
+						_bResumePending = false,	//!< 残りのブロックの処理を予約済みか
+						_bFill = false;				//!< 後回しにしたブロックを処理中か
+		//! 後回しにした最初のブロック
+		QTextCursor		_resumeCursor;
+		//! ビューポート付近の行を優先してハイライトする時の表示先
+		QPointer<QTextEdit>	_view;
+		//! すぐにハイライトするブロック番号の範囲 (_viewがある時のみ)
+		int				_winFirst = 0,
+						_winLast = 0;
+		//! 並列ハイライトの結果待ち
+		using LineResultV = LineHighlighter::LineResultV;
+		using ParallelWatcher = QFutureWatcher<LineResultV>;
+		ParallelWatcher*	_parallel = nullptr;
+		QStringList		_parallelLines;				//!< 並列ハイライトに渡した文書のコピー
+		int				_parallelGeneration = 0;	//!< 並列ハイライトに使ったルールセットの番号
+		bool			_bParallelAgain = false;	//!< 実行中に再度要求されたか (終わったらやり直す)
 
-		//! JSONデータをファイルから読み込み、QJsonDocumentにして返す
-		static QJsonDocument _LoadJson(const QString& path);
-		//! PairVを作りなおす
-		void _refreshPairV();
+		void _makeFormatTable();
+		void _applyMemo(const BlockMemo& memo);
+		//! カレントブロックのハイライトを後回しにするか
+		/*! \param[in] bSameText	前回ハイライトした時とテキストが同じか */
+		bool _canDefer(bool bSameText) const;
+		//! 前のブロックの状態と覚えている入力状態が食い違うか (後回しにしたブロック)
+		static bool _IsStale(const QTextBlock& b, int prevState);
+		void _beginSlice();
+		void _scheduleResume(const QTextBlock& block);
 
+		private slots:
+			void _endSlice();
+			//! 後回しにしたブロックからハイライトを再開する
+			void _resume();
+			//! ビューポートの範囲を更新し、見えているブロックを優先してハイライト
+			void _onScroll();
+			//! 並列ハイライトの結果を各ブロックに適用する
+			void _onParallelFinished();
 		protected:
 			void highlightBlock(const QString& text) override;
 		public:
 			using QSyntaxHighlighter::QSyntaxHighlighter;
-			//! テキスト装飾定義を読み込む
-			/*! 装飾する色やフォントなど
-				\param[in] path jsonが置いてあるディレクトリパス */
-			void loadUserFormat(const QString& path);
-			//! キーワード定義を指定パス以下全て読み込む
-			/*! ハイライトする対象のキーワード
-				\param[in] path jsonファイルパス */
-			void loadDefine(const QString& path);
-			//! コメント/キーワード定義を読み込む
-			/*!	コメントブロックやキーワード境界
-				\param[in] path jsonファイルパス */
-			void loadBlockDefine(const QString& path);
+			//! ハイライト定義を設定し、文書全体をハイライトし直す
+			/*! 今と同じルールセットなら字句解析器は作り直さず、覚えている結果だけを捨てて字句解析からやり直す
+				\param[in] rules RuleSet::Shared()等で得た共有ルールセット */
+			void setRuleSet(const SPRuleSet& rules);
+			const SPRuleSet& ruleSet() const;
 			QTextCharFormat& defaultFormat();
+			//! ビューポート付近を優先してハイライトする (nullptrなら文書全体をすぐにハイライト)
+			void setView(QTextEdit* view);
+			//! 文書全体をワーカースレッドで並列にハイライトし、終わったら結果を適用する
+			/*! GUIスレッドでは文書のコピーと結果の適用だけを行い、終わるのを待たずに戻る。
+				結果はコピーした時からテキストが変わっていないブロックにだけ適用する。
+				実行中に呼ばれたら、終わった後にその時の文書でもう一度行う */
+			void highlightParallel();
 	};
 }
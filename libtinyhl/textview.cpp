@@ -0,0 +1,97 @@
+#include "textview.h"
+
+namespace glsl {
+	namespace {
+		const char32_t c_replacement = 0xfffd;
+		bool IsCont(uint32_t b) {
+			return (b & 0xc0) == 0x80;
+		}
+	}
+	char32_t NextChar(U8View text, size_t& pos) {
+		const uint32_t b0 = UnitOf(text.data[pos]);
+		if(b0 < 0x80) {
+			++pos;
+			return b0;
+		}
+		// 先頭バイトから続くバイト数と最小値(冗長な表現を弾く)を決める
+		int n;
+		char32_t c, minC;
+		if((b0 & 0xe0) == 0xc0) {
+			n = 1; c = b0 & 0x1f; minC = 0x80;
+		} else if((b0 & 0xf0) == 0xe0) {
+			n = 2; c = b0 & 0x0f; minC = 0x800;
+		} else if((b0 & 0xf8) == 0xf0) {
+			n = 3; c = b0 & 0x07; minC = 0x10000;
+		} else {
+			++pos;
+			return c_replacement;
+		}
+		if(pos + n >= text.size) {
+			++pos;
+			return c_replacement;
+		}
+		for(int i=1 ; i<=n ; i++) {
+			const uint32_t b = UnitOf(text.data[pos+i]);
+			if(!IsCont(b)) {
+				++pos;
+				return c_replacement;
+			}
+			c = (c << 6) | (b & 0x3f);
+		}
+		if(c < minC || c > 0x10ffff || (c >= 0xd800 && c < 0xe000)) {
+			++pos;
+			return c_replacement;
+		}
+		pos += n+1;
+		return c;
+	}
+	char32_t NextChar(U16View text, size_t& pos) {
+		const char32_t u0 = text.data[pos++];
+		if(u0 >= 0xd800 && u0 < 0xdc00 && pos < text.size) {
+			const char32_t u1 = text.data[pos];
+			if(u1 >= 0xdc00 && u1 < 0xe000) {
+				++pos;
+				return 0x10000 + ((u0 - 0xd800) << 10) + (u1 - 0xdc00);
+			}
+		}
+		return u0;
+	}
+	char32_t BackChar(U8View text, size_t& pos) {
+		if(pos == 0)
+			return 0;
+		// 継続バイトを最大3つ遡って先頭バイトを探す
+		size_t top = pos-1;
+		while(top > 0 && pos-top < 4 && IsCont(UnitOf(text.data[top])))
+			--top;
+		size_t cur = top;
+		const char32_t c = NextChar(text, cur);
+		if(cur != pos) {
+			// 途中で不正なバイトがあれば直前の1バイトだけを1文字とみなす
+			const uint32_t b = UnitOf(text.data[--pos]);
+			return b < 0x80 ? b : c_replacement;
+		}
+		pos = top;
+		return c;
+	}
+	char32_t BackChar(U16View text, size_t& pos) {
+		if(pos == 0)
+			return 0;
+		const char32_t u1 = text.data[--pos];
+		if(u1 >= 0xdc00 && u1 < 0xe000 && pos >= 1) {
+			const char32_t u0 = text.data[pos-1];
+			if(u0 >= 0xd800 && u0 < 0xdc00) {
+				--pos;
+				return 0x10000 + ((u0 - 0xd800) << 10) + (u1 - 0xdc00);
+			}
+		}
+		return u1;
+	}
+	bool IsSpaceChar(char32_t c) {
+		if(c < 0x80)
+			return c == ' ' || (c >= '\t' && c <= '\r');
+		// Unicodeの区切り文字(Zs, Zl, Zp)と制御文字の空白
+		return c == 0x85 || c == 0xa0 || c == 0x1680 ||
+				(c >= 0x2000 && c <= 0x200a) ||
+				c == 0x2028 || c == 0x2029 || c == 0x202f || c == 0x205f || c == 0x3000;
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace glsl {
+	//! 文字列の参照 (所有はしない)
+	/*! Chがcharの時はUTF-8, char16_tの時はUTF-16として扱う。
+		位置や長さは全て文字コードの単位数 (UTF-8ならバイト数) */
+	template <class Ch>
+	struct BasicTextView {
+		const Ch*	data;
+		size_t		size;
+
+		BasicTextView(): data(nullptr), size(0) {}
+		BasicTextView(const Ch* d, size_t n): data(d), size(n) {}
+		bool empty() const { return size == 0; }
+		//! [pos, pos+n)の部分
+		BasicTextView sub(size_t pos, size_t n) const { return BasicTextView(data+pos, n); }
+	};
+	using U8View = BasicTextView<char>;
+	using U16View = BasicTextView<char16_t>;
+
+	//! 符号無しの単位値
+	template <class Ch>
+	inline uint32_t UnitOf(Ch c) {
+		return static_cast<typename std::make_unsigned<Ch>::type>(c);
+	}
+	//! text[pos]から1文字(コードポイント)読んでposを進める
+	/*! 不正なUTF-8は1バイト毎にU+FFFD、対になっていないサロゲートはその値のまま返す */
+	char32_t NextChar(U8View text, size_t& pos);
+	char32_t NextChar(U16View text, size_t& pos);
+	//! text[pos]の直前の1文字を読んでposを戻す (pos==0なら0を返す)
+	char32_t BackChar(U8View text, size_t& pos);
+	char32_t BackChar(U16View text, size_t& pos);
+	//! text[pos]の直前の1文字 (pos==0なら0)
+	template <class Ch>
+	inline char32_t PrevChar(BasicTextView<Ch> text, size_t pos) {
+		return BackChar(text, pos);
+	}
+	//! text[pos]から始まる1文字 (posは進めない)
+	template <class Ch>
+	inline char32_t PeekChar(BasicTextView<Ch> text, size_t pos) {
+		return NextChar(text, pos);
+	}
+	//! 1文字をUTF-16に直す
+	/*! \return 書き込んだ単位数 (1か2) */
+	inline int ToUtf16(char32_t c, char16_t (&dst)[2]) {
+		if(c < 0x10000) {
+			dst[0] = char16_t(c);
+			return 1;
+		}
+		c -= 0x10000;
+		dst[0] = char16_t(0xd800 + (c >> 10));
+		dst[1] = char16_t(0xdc00 + (c & 0x3ff));
+		return 2;
+	}
+	//! QChar::isSpaceと同じ空白文字か
+	bool IsSpaceChar(char32_t c);
+}
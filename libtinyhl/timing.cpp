@@ -0,0 +1,116 @@
+#include "timing.h"
+#include <QStringList>
+#include <algorithm>
+
+namespace glsl {
+	// ------------------ Phase ------------------
+	Phase::Type Phase::CompileOf(Shader::Type type) {
+		return static_cast<Type>(Compile + type);
+	}
+	QString GetPhaseName(Phase::Type phase) {
+		if(phase >= Phase::Compile && phase < Phase::Link)
+			return QString("compile_%1").arg(QString(GetStageName(static_cast<Shader::Type>(phase - Phase::Compile))).toLower());
+		switch(phase) {
+			case Phase::Preprocess:	return "preprocess";
+			case Phase::CacheFind:	return "cache_find";
+			case Phase::Restore:	return "restore";
+			case Phase::Link:		return "link";
+			case Phase::Reflect:	return "reflect";
+			case Phase::CacheStore:	return "cache_store";
+			default:				return QString();
+		}
+	}
+	// ------------------ Timing ------------------
+	qint64 Timing::total() const {
+		qint64 sum = 0;
+		for(auto n : nsec)
+			sum += n;
+		return sum;
+	}
+	Timing& Timing::operator += (const Timing& t) {
+		for(int i=0 ; i<Phase::_Num ; i++)
+			nsec[i] += t.nsec[i];
+		return *this;
+	}
+	QString Timing::toString() const {
+		QStringList sl;
+		for(int i=0 ; i<Phase::_Num ; i++) {
+			if(nsec[i] > 0)
+				sl << QString("%1 %2ms").arg(GetPhaseName(static_cast<Phase::Type>(i))).arg(nsec[i] / 1e6, 0, 'f', 2);
+		}
+		return sl.join(", ");
+	}
+	// ------------------ ScopedTiming ------------------
+	ScopedTiming::ScopedTiming(Timing& timing, Phase::Type phase):
+		_dst(timing.nsec[phase])
+	{
+		_timer.start();
+	}
+	ScopedTiming::~ScopedTiming() {
+		// 0は実行しなかった扱いなので、分解能未満でも1ns以上にする
+		_dst += std::max<qint64>(_timer.nsecsElapsed(), 1);
+	}
+	// ------------------ TimingStat ------------------
+	void TimingStat::Entry::add(qint64 nsec) {
+		if(count == 0 || nsec < min)
+			min = nsec;
+		if(count == 0 || nsec > max)
+			max = nsec;
+		++count;
+		total += nsec;
+		++bucket[BucketOf(nsec)];
+	}
+	TimingStat::Entry& TimingStat::Entry::operator += (const Entry& e) {
+		if(e.count == 0)
+			return *this;
+		if(count == 0 || e.min < min)
+			min = e.min;
+		if(count == 0 || e.max > max)
+			max = e.max;
+		count += e.count;
+		total += e.total;
+		for(int i=0 ; i<NBucket ; i++)
+			bucket[i] += e.bucket[i];
+		return *this;
+	}
+	void TimingStat::add(const Timing& t) {
+		for(int i=0 ; i<Phase::_Num ; i++) {
+			if(t.nsec[i] > 0)
+				_entry[i].add(t.nsec[i]);
+		}
+		++_nRun;
+	}
+	TimingStat& TimingStat::operator += (const TimingStat& s) {
+		for(int i=0 ; i<Phase::_Num ; i++)
+			_entry[i] += s._entry[i];
+		_nRun += s._nRun;
+		return *this;
+	}
+	const TimingStat::Entry& TimingStat::entry(Phase::Type phase) const {
+		return _entry[phase];
+	}
+	TimingStat::Entry& TimingStat::entry(Phase::Type phase) {
+		return _entry[phase];
+	}
+	quint64 TimingStat::numRun() const {
+		return _nRun;
+	}
+	void TimingStat::setNumRun(quint64 n) {
+		_nRun = n;
+	}
+	void TimingStat::clear() {
+		*this = TimingStat();
+	}
+	qint64 TimingStat::BucketFloor(int i) {
+		return i == 0 ? 0 : (qint64(1) << (i-1)) * 1000;
+	}
+	int TimingStat::BucketOf(qint64 nsec) {
+		qint64 us = nsec / 1000;
+		int i = 0;
+		while(us > 0 && i < NBucket-1) {
+			us >>= 1;
+			++i;
+		}
+		return i;
+	}
+}
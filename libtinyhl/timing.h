@@ -0,0 +1,74 @@
+#pragma once
+#include "glsl.h"
+#include <QElapsedTimer>
+#include <QString>
+
+namespace glsl {
+	//! コンパイルの工程
+	struct Phase {
+		enum Type {
+			Preprocess,							//!< #includeの展開とマクロの組み合わせの解決
+			CacheFind,							//!< キャッシュの検索
+			Restore,							//!< プログラムバイナリの復元
+			Compile,							//!< ステージ毎のコンパイル (Compile + Shader::Type)
+			Link = Compile + Shader::_Num,
+			Reflect,							//!< 変数情報とプログラムバイナリの取得
+			CacheStore,							//!< キャッシュへの書き込み
+			_Num
+		};
+		static Type CompileOf(Shader::Type type);
+	};
+	//! JSONやログに出す工程名 ("preprocess", "compile_vertex"など)
+	QString GetPhaseName(Phase::Type phase);
+
+	//! 工程毎の処理時間 (ナノ秒, 実行しなかった工程は0)
+	struct Timing {
+		qint64	nsec[Phase::_Num] = {};
+
+		qint64 total() const;
+		Timing& operator += (const Timing& t);
+		//! "preprocess 0.12ms, link 3.40ms"形式 (実行した工程のみ)
+		QString toString() const;
+	};
+	//! 生成してから破棄するまでの時間をtimingに加算する
+	/*! QElapsedTimerを使うので、可能ならモノトニッククロックで計る */
+	class ScopedTiming {
+		QElapsedTimer	_timer;
+		qint64&			_dst;
+		public:
+			ScopedTiming(Timing& timing, Phase::Type phase);
+			~ScopedTiming();
+	};
+	//! 複数回分の処理時間を工程毎に集計する
+	/*! 分布は2の冪のマイクロ秒毎に数える (区間iは[2^(i-1), 2^i)us, 0は1us未満, 最後は上限無し) */
+	class TimingStat {
+		public:
+			enum { NBucket = 24 };
+			struct Entry {
+				quint64	count = 0;
+				qint64	total = 0,
+						min = 0,
+						max = 0;
+				quint64	bucket[NBucket] = {};
+
+				void add(qint64 nsec);
+				Entry& operator += (const Entry& e);
+			};
+		private:
+			Entry	_entry[Phase::_Num];
+			quint64	_nRun = 0;
+		public:
+			//! 1回分を加える (実行しなかった工程は数えない)
+			void add(const Timing& t);
+			TimingStat& operator += (const TimingStat& s);
+			const Entry& entry(Phase::Type phase) const;
+			Entry& entry(Phase::Type phase);
+			//! addした回数
+			quint64 numRun() const;
+			void setNumRun(quint64 n);
+			void clear();
+			//! 区間iの下限 (ナノ秒)
+			static qint64 BucketFloor(int i);
+			static int BucketOf(qint64 nsec);
+	};
+}
@@ -0,0 +1,323 @@
+#include "tokenizer.h"
+#include <algorithm>
+#include <limits>
+
+namespace glsl {
+	namespace {
+		//! 行内の検索結果を再利用する
+		/*! 検索結果の位置がまだ次の検索開始位置以降にあれば、その間に一致する物は無いので
+			結果をそのまま使える。これにより各位置は一行につき一度しか調べない
+			(一致するかどうかは位置だけで決まり、検索開始位置には依存しない事が前提) */
+		class HitCache {
+			MatchHit	_res = {-1, -1, -1};
+			int			_from = -1;
+			public:
+				template <class F>
+				const MatchHit& find(int offset, F f) {
+					if(_from < 0 || offset < _from ||
+						(_res.offset >= 0 && _res.offset < offset))
+					{
+						_res = f(offset);
+						_from = offset;
+					}
+					return _res;
+				}
+		};
+		const MatchHit c_noHit = {-1, -1, -1};
+		//! #if 0の入れ子の深さの上限
+		const int c_maxDisabled = 0xffff;
+		//! スレッド毎に振る行番号 (Matcherが行単位の前処理を使い回す為の物)
+		thread_local uint64_t t_lineId = 0;
+
+		//! 行の状態 (int1つに詰めて次の行へ渡す)
+		struct BlockState {
+			bool	bComment = false,	//!< ブロックコメントが続いている
+					bContinue = false;	//!< ディレクティブが次の行へ続いている
+			int		disabled = 0;		//!< #if 0の中の入れ子の深さ (0なら有効なコード)
+
+			static BlockState Decode(int state) {
+				BlockState ret;
+				// 不明な状態は初期状態とみなす
+				if(state > 0 && state != TokenizerBase::UnknownState) {
+					ret.bComment = (state & 1) != 0;
+					ret.bContinue = (state & 2) != 0;
+					ret.disabled = state >> 2;
+				}
+				return ret;
+			}
+			int encode() const {
+				return (bComment ? 1 : 0) | (bContinue ? 2 : 0) | (disabled << 2);
+			}
+		};
+		enum class Directive {
+			None,
+			If,			//!< #if, #ifdef, #ifndef
+			IfZero,		//!< #if 0
+			Else,		//!< #else, #elif
+			Endif,
+			Other
+		};
+		//! text[pos, pos+len)がASCII文字列strと等しいか
+		template <class Ch>
+		bool EqualsAscii(BasicTextView<Ch> text, size_t pos, size_t len, const char* str) {
+			size_t i = 0;
+			for( ; i<len && str[i] ; i++) {
+				if(UnitOf(text.data[pos+i]) != uint32_t(str[i]))
+					return false;
+			}
+			return i == len && !str[i];
+		}
+		//! 行頭のプリプロセッサディレクティブを判定
+		template <class Ch>
+		Directive ParseDirective(BasicTextView<Ch> text, const CharTable& table) {
+			const size_t len = text.size;
+			size_t i = 0;
+			const auto fnSkip = [&text, &i, len](){
+				while(i < len) {
+					size_t next = i;
+					if(!IsSpaceChar(NextChar(text, next)))
+						break;
+					i = next;
+				}
+			};
+			fnSkip();
+			if(i >= len || text.data[i] != '#')
+				return Directive::None;
+			++i;
+			fnSkip();
+			const size_t top = i;
+			while(i < len) {
+				size_t next = i;
+				const char32_t c = NextChar(text, next);
+				if(!table.isLetterOrNumber(c) && c != '_')
+					break;
+				i = next;
+			}
+			const size_t nameLen = i - top;
+			if(EqualsAscii(text, top, nameLen, "if")) {
+				// 引数が0だけの物 (後ろのコメントは無視)
+				fnSkip();
+				if(i < len && text.data[i] == '0') {
+					++i;
+					fnSkip();
+					if(i >= len ||
+						(i+1 < len && text.data[i] == '/' && (text.data[i+1] == '/' || text.data[i+1] == '*')))
+						return Directive::IfZero;
+				}
+				return Directive::If;
+			}
+			if(EqualsAscii(text, top, nameLen, "ifdef") || EqualsAscii(text, top, nameLen, "ifndef"))
+				return Directive::If;
+			if(EqualsAscii(text, top, nameLen, "else") || EqualsAscii(text, top, nameLen, "elif"))
+				return Directive::Else;
+			if(EqualsAscii(text, top, nameLen, "endif"))
+				return Directive::Endif;
+			return Directive::Other;
+		}
+		//! 行末が\\ (次の行へ続く) か
+		template <class Ch>
+		bool EndsWithBackslash(BasicTextView<Ch> text) {
+			size_t i = text.size;
+			while(i > 0) {
+				const char32_t c = BackChar(text, i);
+				if(!IsSpaceChar(c))
+					return c == '\\';
+			}
+			return false;
+		}
+	}
+	template <class Ch>
+	BasicTokenizer<Ch>::BasicTokenizer(const Config& config):
+		_config(config)
+	{}
+	template <class Ch>
+	const typename BasicTokenizer<Ch>::Config& BasicTokenizer<Ch>::config() const {
+		return _config;
+	}
+	template <class Ch>
+	bool BasicTokenizer<Ch>::_tokenize(const View text, const bool bComment, const bool bDisabled, const uint32_t base, TokenSpanV* span) const {
+		enum class TokenType {
+			Keyword,
+			CommentStart,
+			CommentLine,
+			_Num
+		};
+		struct Token {
+			int			offset;
+			TokenType	type;
+			int			length;
+		};
+		enum class SyntaxState {
+			Normal,
+			InCommentBlock
+		};
+		const int length = int(text.size);
+		const auto fnSet = [span, base](int offset, int len, int kind) {
+			if(span)
+				span->push_back(TokenSpan{base + uint32_t(offset), uint32_t(len), kind});
+		};
+		// 無効なコードは行全体をコメントと同じ書式にし、コメント部分だけ上書きする
+		if(bDisabled && length > 0)
+			fnSet(0, length, Comment);
+
+		const Config& cfg = _config;
+		const uint64_t lineId = ++t_lineId;
+		SyntaxState state = bComment ?
+								SyntaxState::InCommentBlock :
+								SyntaxState::Normal;
+		// トークン毎に行末まで探し直さないよう、各検索の結果を次のトークンでも使い回す
+		const auto fnMark = [&text, lineId](const Matcher* m) {
+			return [&text, lineId, m](int ofs){
+				return m ? m->find(text, ofs, lineId) : c_noHit;
+			};
+		};
+		HitCache	keywordHit,
+					startHit,
+					lineHit,
+					classHit[MaxClassifier];
+		int cursor = 0;
+		for(;;) {
+			switch(state) {
+				case SyntaxState::Normal: {
+					// 状態だけを求める時はキーワードを探さない
+					const MatchHit	&mKeyword = span ? keywordHit.find(cursor, fnMark(cfg.keyword)) : c_noHit,
+									&mStart = startHit.find(cursor, fnMark(cfg.commentBegin)),
+									&mLine = lineHit.find(cursor, fnMark(cfg.commentLine));
+					Token tokens[static_cast<int>(TokenType::_Num)] = {
+						{mKeyword.offset, TokenType::Keyword, mKeyword.length},
+						{mStart.offset, TokenType::CommentStart, mStart.length},
+						{mLine.offset, TokenType::CommentLine, mLine.length}
+					};
+					for(auto& t : tokens) {
+						if(t.offset < 0)
+							t.offset = std::numeric_limits<int>::max();
+					}
+					std::sort(tokens, tokens+sizeof(tokens)/sizeof(tokens[0]), [](const Token& t0, const Token& t1){
+						return t0.offset < t1.offset;
+					});
+					auto& cur_token = tokens[0];
+					// 何も見つからなければ終了
+					if(cur_token.offset == std::numeric_limits<int>::max())
+						return false;
+
+					switch(cur_token.type) {
+						case TokenType::Keyword: {
+							if(bDisabled)
+								break;
+							// どのキーワードに該当するか、各検索をトークン位置から調べ
+							// 手前にある方、同じ位置なら長い方、それも同じならカテゴリ番号順で選ぶ
+							const MatchHit* best = &c_noHit;
+							for(int i=0 ; i<MaxClassifier ; i++) {
+								if(!cfg.classifier[i])
+									continue;
+								const MatchHit& r = classHit[i].find(cur_token.offset, fnMark(cfg.classifier[i]));
+								if(r.offset < 0)
+									continue;
+								if(best->offset < 0 ||
+									r.offset < best->offset ||
+									(r.offset == best->offset &&
+										(r.length > best->length ||
+										(r.length == best->length && r.category < best->category))))
+								{
+									best = &r;
+								}
+							}
+							if(best->offset >= 0) {
+								// キーワードに色付け
+								fnSet(best->offset, best->length, best->category);
+							}
+						} break;
+						case TokenType::CommentStart:
+							fnSet(cur_token.offset, cur_token.length, Comment);
+							state = SyntaxState::InCommentBlock;
+							break;
+						case TokenType::CommentLine:
+							// 行最後までコメントアウト
+							fnSet(cur_token.offset, length-cur_token.offset, Comment);
+							return false;
+						default:
+							break;
+					}
+					cursor = cur_token.offset + cur_token.length;
+				} break;
+
+				case SyntaxState::InCommentBlock: {
+					// CommentEndを探す
+					const MatchHit m = cfg.commentEnd ? cfg.commentEnd->find(text, cursor, lineId) : c_noHit;
+					if(m.offset >= 0) {
+						// endMarkまでコメントアウト
+						fnSet(cursor, m.offset+m.length - cursor, Comment);
+						cursor = m.offset+m.length;
+						state = SyntaxState::Normal;
+					} else {
+						// 次の行へコメントが続いている
+						fnSet(cursor, length-cursor, Comment);
+						return true;
+					}
+				} break;
+			}
+		}
+	}
+	template <class Ch>
+	int BasicTokenizer<Ch>::_line(const View text, const int inState, const uint32_t base, TokenSpanV* span) const {
+		const BlockState in = BlockState::Decode(inState);
+		BlockState out = in;
+		// コメントやディレクティブの続きの行はディレクティブとして扱わない
+		const Directive dir = (in.bComment || in.bContinue) ?
+								Directive::None :
+								ParseDirective(text, *_config.table);
+		bool bDisabled = in.disabled > 0;
+		if(bDisabled) {
+			switch(dir) {
+				case Directive::If:
+				case Directive::IfZero:
+					out.disabled = std::min(out.disabled+1, c_maxDisabled);
+					break;
+				case Directive::Else:
+					// #if 0に対応する#else以降は有効
+					if(in.disabled == 1) {
+						out.disabled = 0;
+						bDisabled = false;
+					}
+					break;
+				case Directive::Endif:
+					if(--out.disabled == 0)
+						bDisabled = false;
+					break;
+				default:
+					break;
+			}
+		} else if(dir == Directive::IfZero)
+			out.disabled = 1;
+
+		out.bComment = _tokenize(text, in.bComment, bDisabled, base, span);
+		out.bContinue = (dir != Directive::None || in.bContinue) && EndsWithBackslash(text);
+		return out.encode();
+	}
+	template <class Ch>
+	int BasicTokenizer<Ch>::tokenize(const View line, const int inState, TokenSpanV& span) const {
+		return _line(line, inState, 0, &span);
+	}
+	template <class Ch>
+	int BasicTokenizer<Ch>::scanState(const View line, const int inState) const {
+		return _line(line, inState, 0, nullptr);
+	}
+	template <class Ch>
+	int BasicTokenizer<Ch>::tokenizeBuffer(const View buffer, int state, TokenSpanV& span, LineV* line) const {
+		size_t top = 0;
+		while(top < buffer.size) {
+			const Ch* nl = std::find(buffer.data + top, buffer.data + buffer.size, Ch('\n'));
+			const size_t end = nl - buffer.data;
+			size_t len = end - top;
+			if(len > 0 && buffer.data[top+len-1] == '\r')
+				--len;
+			if(line)
+				line->push_back(Line{uint32_t(top), uint32_t(len), uint32_t(span.size()), state});
+			state = _line(buffer.sub(top, len), state, uint32_t(top), &span);
+			top = end + 1;
+		}
+		return state;
+	}
+	template class BasicTokenizer<char>;
+	template class BasicTokenizer<char16_t>;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include "matcher.h"
+#include <vector>
+
+namespace glsl {
+	//! 色付けする範囲
+	struct TokenSpan {
+		uint32_t	offset,		//!< 入力の先頭からの位置 (入力の文字コードの単位数)
+					length;
+		int32_t		kind;		//!< カテゴリ番号又はTokenizerBase::Comment
+	};
+	using TokenSpanV = std::vector<TokenSpan>;
+	//! 文字コードに依らない定義
+	struct TokenizerBase {
+		enum : int {
+			//! TokenSpan::kind: コメント (#if 0の中の行も含む)
+			Comment = -1,
+			//! まだ処理していない行の状態 (どの状態とも一致せず、初期状態とみなす)
+			UnknownState = 1 << 30
+		};
+		//! 種別を調べる検索の最大数
+		enum { MaxClassifier = 4 };
+	};
+	//! コメントとキーワードを探して色付けする範囲を求める (Qtに依存しない)
+	/*! 行の状態にはブロックコメント、ディレクティブの継続行、#if 0の入れ子の深さを詰めて次の行へ渡す。
+		結果はspanへ追加するだけなので、呼び出し側が同じ配列を使い回せばトークン毎の確保は起きない。
+		構築後は変更しないので、同じインスタンスを複数のスレッドから同時に使ってよい */
+	template <class Ch>
+	class BasicTokenizer : public TokenizerBase {
+		public:
+			using View = BasicTextView<Ch>;
+			using Matcher = BasicMatcher<Ch>;
+			//! 使用する検索 (所有はしない)
+			struct Config {
+				const Matcher	*commentLine = nullptr,
+								*commentBegin = nullptr,
+								*commentEnd = nullptr,
+								*keyword = nullptr;		//!< キーワード境界
+				//! キーワードの種別 (nullptrは無視。同じ位置・長さなら前にある方を優先)
+				const Matcher*	classifier[MaxClassifier] = {};
+				//! ディレクティブ名と空白の判定に使う表
+				const CharTable*	table = &CharTable::Ascii();
+			};
+			//! tokenizeBufferで分割した行
+			struct Line {
+				uint32_t	offset,		//!< バッファ先頭からの位置
+							length,		//!< 改行を除いた長さ
+							spanBegin;	//!< 行の最初のTokenSpanのインデックス
+				int			inState;	//!< 前の行から受け取った状態
+			};
+			using LineV = std::vector<Line>;
+		private:
+			Config	_config;
+
+			/*! \param[in] bDisabled	#if 0の中の行か (キーワードは色付けせず、行全体をコメントとする)
+				\param[in] base			spanのoffsetに足す値
+				\param[out] span		nullptrなら状態だけを求める (キーワードは探さない)
+				\return 行末でブロックコメントが続いているか */
+			bool _tokenize(View text, bool bComment, bool bDisabled, uint32_t base, TokenSpanV* span) const;
+			int _line(View text, int inState, uint32_t base, TokenSpanV* span) const;
+		public:
+			BasicTokenizer() = default;
+			BasicTokenizer(const Config& config);
+			const Config& config() const;
+			//! 1行を処理して次の行へ渡す状態を返す
+			/*! \param[in] inState	前の行の状態 (最初の行は0)
+				\param[out] span	結果を追加する (クリアはしない) */
+			int tokenize(View line, int inState, TokenSpanV& span) const;
+			//! 色付けはせずに次の行へ渡す状態だけを求める
+			/*! キーワードを調べない分tokenizeより速い */
+			int scanState(View line, int inState) const;
+			//! 改行を含むバッファを行に分けて処理し、最後の行が返した状態を返す
+			/*! 行末の"\r"は改行の一部とする。spanのoffsetはbufferの先頭から数える
+				\param[out] line	nullptrでなければ各行の情報を追加 */
+			int tokenizeBuffer(View buffer, int inState, TokenSpanV& span, LineV* line = nullptr) const;
+	};
+	extern template class BasicTokenizer<char>;
+	extern template class BasicTokenizer<char16_t>;
+	using U8Tokenizer = BasicTokenizer<char>;
+	using U16Tokenizer = BasicTokenizer<char16_t>;
+}
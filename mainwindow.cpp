@@ -3,13 +3,22 @@
 #include "glsl.h"
 #include "syntaxhighlighter.h"
 #include "glctxnotify.h"
+#include "compiler.h"
+#include "compilecache.h"
+#include "asynccompiler.h"
+#include "preprocessor.h"
 #include <QFileDialog>
+#include <QHBoxLayout>
 #include <QMessageBox>
-#include <QOpenGLShader>
+#include <QTimer>
+#include <QGLContext>
+#include <QCryptographicHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 
 class MainWindow::TabEnt {
 	using UPHL = std::unique_ptr<glsl::SyntaxHighlighter>;
-	using UPDoc = std::unique_ptr<QTextDocument>;
 	private:
 		MainWindow*		_pMain = nullptr;
 		UPHL			_hl;
@@ -18,20 +27,36 @@ class MainWindow::TabEnt {
 						_extension,
 						_baseTitle,
 						_filter;
-		UPDoc			_savedDoc;	//!< ファイルに保存してあるテキスト
+		QByteArray		_savedHash;			//!< ファイルに保存してあるテキストのハッシュ値
+		int				_savedLength = 0;	//!< 同じく文字数 (QTextDocument::characterCount)
 		int				_tabIndex = -1;
 
-		bool _isModified() const {
-			if(_tedit) {
-				// セーブ or ロードした時の文章と比較
-				auto* doc = _tedit->document();
-				if(_savedDoc->characterCount() != doc->characterCount() ||
-					_savedDoc->toPlainText() != doc->toPlainText())
-				{
-					return true;
-				}
-			}
-			return false;
+		static QByteArray _Hash(const QString& text) {
+			return QCryptographicHash::hash(QByteArray::fromRawData(reinterpret_cast<const char*>(text.utf16()), text.size()*sizeof(ushort)),
+											QCryptographicHash::Sha1);
+		}
+		//! 現在の内容をファイルに保存してある状態とする
+		/*! \param[in] text	現在の内容 (toPlainText) */
+		void _markSaved(const QString& text) {
+			auto* doc = _tedit->document();
+			doc->setModified(false);
+			_savedLength = doc->characterCount();
+			_savedHash = _Hash(text);
+		}
+		//! 保存してある内容から変わっているか
+		/*! \param[in] bExact	長さが同じ時に内容のハッシュ値まで比べるか
+								(文書全体をコピーするので、打鍵毎に呼ぶタイトルの更新ではfalse) */
+		bool _isModified(bool bExact) const {
+			if(!_tedit)
+				return false;
+			// 編集した後にundoで保存時の状態まで戻した場合もQTextDocumentが未変更に戻す
+			auto* doc = _tedit->document();
+			if(!doc->isModified())
+				return false;
+			if(doc->characterCount() != _savedLength)
+				return true;
+			// 手で同じ内容に打ち直した場合に備え、長さが同じ時だけ内容のハッシュ値で比べる
+			return !bExact || _Hash(doc->toPlainText()) != _savedHash;
 		}
 	public:
 		void reset() {
@@ -48,21 +73,24 @@ class MainWindow::TabEnt {
 			_extension = ext;
 			_pMain = w;
 			_baseTitle = baseTitle;
-			_savedDoc.reset(te->document()->clone());
 
 			_hl.reset(new glsl::SyntaxHighlighter(te->document()));
-			auto appPath = QApplication::applicationDirPath();
-			_hl->loadUserFormat(appPath + "/usercfg.json");
-			_hl->loadDefine(appPath + "/defs");
-			_hl->loadBlockDefine(appPath + "/block.json");
 			QTextCharFormat& fmt = _hl->defaultFormat();
 			fmt.setForeground(Qt::darkGreen);
+			// ハイライト定義は全てのタブで共有する (読み込みは初回のみ)
+			// 大きなファイルでも開いてすぐ表示できるよう、見えている所から順にハイライトする
+			_hl->setView(te);
+			_hl->setRuleSet(glsl::RuleSet::Shared(QApplication::applicationDirPath()));
 			QObject::connect(te, &QTextEdit::textChanged, [this](){
 				onTextChange();
 			});
 			te->clear();
+			_markSaved(QString());
 			onTextChange();
 		}
+		void setRuleSet(const glsl::SPRuleSet& rules) {
+			_hl->setRuleSet(rules);
+		}
 		static QStringRef ExtractFileName(const QString& path) {
 			QRegExp re(R"([\w\d_]+(\.)?[\w\d]+$)");
 			int idx = path.indexOf(re);
@@ -77,19 +105,25 @@ class MainWindow::TabEnt {
 				return QStringRef(&path, idx, re.matchedLength()).toString();
 			return QString();
 		}
+		//! ファイルのパス (保存していなければ空)
+		const QString& path() const {
+			return _path;
+		}
 		QString makeTitle() {
 			QChar mc(' ');
-			if(_isModified())
+			if(_isModified(false))
 				mc = '*';
 			return QString("%1(%2)%3").arg(_baseTitle).arg(ExtractFileName(_path).toString()).arg(mc);
 		}
 		void onTextChange() {
+			if(_tedit)
+				_pMain->_onSourceChanged();
 			QMetaObject::invokeMethod(_pMain, "onTabTitleChanged", Qt::QueuedConnection,
 									  Q_ARG(int, _tabIndex), Q_ARG(QString, makeTitle()));
 		}
 		bool clear() {
 			// 未保存だったら確認する
-			if(_isModified()) {
+			if(_isModified(true)) {
 				int res = QMessageBox::question(_pMain, "save confirm", "the document is modified. would you like save it now?", QMessageBox::StandardButton::Yes, QMessageBox::StandardButton::No, QMessageBox::StandardButton::Cancel);
 				if(res == QMessageBox::Yes) {
 					save();
@@ -101,17 +135,41 @@ class MainWindow::TabEnt {
 			}
 			_path.clear();
 			_tedit->clear();
-			_savedDoc.reset(_tedit->document()->clone());
+			_markSaved(QString());
 			return true;
 		}
-		void load(const QString& name, const QByteArray& data) {
+		//! ファイルを読み込む
+		/*! \return ファイルを開けなければfalse */
+		bool load(const QString& path) {
+			QFile file(path);
+			if(!file.open(QFile::ReadOnly))
+				return false;
 			// 未保存だったら現在の文章を保存するか確認
-			if(clear()) {
-				_path = name;
-				_tedit->setText(data);
-				_savedDoc.reset(_tedit->document()->clone());
-				onTextChange();
+			if(!clear())
+				return true;
+			QString text;
+			{
+				// バイト列のコピーを作らないよう、マップした領域から直接デコードする
+				const qint64 size = file.size();
+				if(uchar* p = (size > 0) ? file.map(0, size) : nullptr) {
+					text = QString::fromUtf8(reinterpret_cast<const char*>(p), int(size));
+					file.unmap(p);
+				} else
+					text = QString::fromUtf8(file.readAll());
+				file.close();
 			}
+			_path = path;
+			_tedit->setPlainText(text);
+			// 文書から取り出し直さずに済むよう、解放する前にハッシュ値を取る
+			_markSaved(text);
+			// 文書へ移した後は要らないので、ハイライトの前に解放する
+			text = QString();
+			// 大きなファイルはビューポート以外の部分をワーカースレッドで纏めてハイライトする
+			const int c_parallelLines = 2000;
+			if(_tedit->document()->blockCount() > c_parallelLines)
+				_hl->highlightParallel();
+			onTextChange();
+			return true;
 		}
 		bool save() {
 			if(_path.isEmpty()) {
@@ -130,7 +188,7 @@ class MainWindow::TabEnt {
 			if(file.open(QFile::WriteOnly)) {
 				QString str = _tedit->toPlainText();
 				file.write(str.toUtf8());
-				_savedDoc.reset(_tedit->document()->clone());
+				_markSaved(str);
 				onTextChange();
 			} else {
 				QMessageBox::warning(_pMain, "error", QString("can't open file %1").arg(file.fileName()));
@@ -158,19 +216,67 @@ class MainWindow::TabEnt {
 };
 
 // --------------------- MainWindow ---------------------
+namespace {
+	//! usercfg.jsonのinclude_paths (相対パスはusercfg.jsonからの位置)
+	QStringList LoadIncludePaths(const QString& dir) {
+		QStringList ret;
+		QFile file(dir + "/usercfg.json");
+		if(file.open(QFile::ReadOnly)) {
+			const QDir base(dir);
+			for(auto v : QJsonDocument::fromJson(file.readAll()).object().value("include_paths").toArray())
+				ret.append(base.absoluteFilePath(v.toString()));
+		}
+		return ret;
+	}
+	//! 工程毎の平均時間 (実行した回数で割る)
+	QString MeanString(const glsl::TimingStat& s) {
+		QStringList sl;
+		for(int i=0 ; i<glsl::Phase::_Num ; i++) {
+			const auto phase = static_cast<glsl::Phase::Type>(i);
+			const auto& e = s.entry(phase);
+			if(e.count > 0)
+				sl << QString("%1 %2ms").arg(glsl::GetPhaseName(phase)).arg(e.total / double(e.count) / 1e6, 0, 'f', 2);
+		}
+		return sl.join(", ");
+	}
+}
 MainWindow::MainWindow(QWidget *parent):
 	QMainWindow(parent),
 	_tab(std::make_shared<TabV>(glsl::Shader::_Num)),
-	_ui(std::make_shared<Ui::MainWindow>())
+	_ui(std::make_shared<Ui::MainWindow>()),
+	_cache(new glsl::CompileCache(glsl::CompileCache::DefaultPath())),
+	_pp(new glsl::Preprocessor()),
+	_autoTimer(new QTimer(this))
 {
+	// 入力中は何度もコンパイルしないよう、最後の編集から一定時間待つ
+	_autoTimer->setSingleShot(true);
+	_autoTimer->setInterval(500);
+	_pp->setSearchPaths(LoadIncludePaths(QApplication::applicationDirPath()));
+	QObject::connect(_autoTimer, &QTimer::timeout, this, &MainWindow::doCompile);
 	_ui->setupUi(this);
 	_ui->glwidget->hide();
 	QObject::connect(_ui->glwidget, &glsl::GLCtxNotify::onContextInitialized, [this](QOpenGLContext* ctx){
 		_ctx = ctx;
 		initializeOpenGLFunctions();
 	});
-	(*_tab)[glsl::Shader::Vertex].init(_ui->teVS, "Vertex Shader (*.vsh)", "vsh", glsl::Shader::Vertex, "VertexShader: ", this);
-	(*_tab)[glsl::Shader::Fragment].init(_ui->teFS, "Fragment Shader (*.fsh)", "fsh", glsl::Shader::Fragment, "FragmentShader: ", this);
+	// VS/FS以外のステージのタブはuiファイルに無いので、種別の順にここで足す
+	QTextEdit* te[glsl::Shader::_Num] = {_ui->teVS, _ui->teFS};
+	for(int i=glsl::Shader::Fragment+1 ; i<glsl::Shader::_Num ; i++) {
+		auto* page = new QWidget();
+		auto* layout = new QHBoxLayout(page);
+		layout->setContentsMargins(1,1,1,1);
+		te[i] = new QTextEdit(page);
+		te[i]->setTabStopWidth(_ui->teVS->tabStopWidth());
+		layout->addWidget(te[i]);
+		_ui->tabWidget->addTab(page, QString());
+	}
+	for(int i=0 ; i<glsl::Shader::_Num ; i++) {
+		const auto type = static_cast<glsl::Shader::Type>(i);
+		const QString name = glsl::GetStageName(type),
+					ext = glsl::GetStageExtension(type);
+		(*_tab)[i].init(te[i], QString("%1 Shader (*.%2)").arg(name).arg(ext), ext, type, name + "Shader: ", this);
+		_edit[i] = te[i];
+	}
 }
 MainWindow::~MainWindow() {
 	for(auto& t : *_tab)
@@ -185,30 +291,18 @@ void MainWindow::loadShader() {
 	dlg.setFileMode(QFileDialog::ExistingFile);
 	dlg.setFilter(QDir::Readable | QDir::Files);
 	dlg.setViewMode(QFileDialog::ViewMode::List);
-	dlg.setNameFilter("Shader files (*.vsh *.fsh)");
+	QStringList filter;
+	for(int i=0 ; i<glsl::Shader::_Num ; i++)
+		filter << QString("*.") + glsl::GetStageExtension(static_cast<glsl::Shader::Type>(i));
+	dlg.setNameFilter(QString("Shader files (%1)").arg(filter.join(' ')));
 	if(dlg.exec() == QFileDialog::Accepted) {
-		QRegExp re(R"(\.([\w\d]+)$)");
 		QStringList files = dlg.selectedFiles();
 		for(auto& f : files) {
-			int idx = f.indexOf(re);
-			if(idx >= 0) {
-				QString ext = re.capturedTexts()[1];
-				glsl::Shader::Type type;
-				if(ext == "vsh")
-					type = glsl::Shader::Vertex;
-				else if(ext == "fsh")
-					type = glsl::Shader::Fragment;
-				else
-					continue;
-
-				QFile file;
-				file.setFileName(f);
-				if(file.open(QFile::ReadOnly)) {
-					auto s = file.readAll();
-					(*_tab)[type].load(file.fileName(), s);
-				} else
-					QMessageBox::warning(this, "error", QString("can't open file %1").arg(file.fileName()));
-			}
+			const glsl::Shader::Type type = glsl::GetStageFromPath(f);
+			if(type == glsl::Shader::_Num)
+				continue;
+			if(!(*_tab)[type].load(f))
+				QMessageBox::warning(this, "error", QString("can't open file %1").arg(f));
 		}
 	}
 }
@@ -226,63 +320,104 @@ void MainWindow::saveAs() {
 	int index = _ui->tabWidget->currentIndex();
 	(*_tab)[static_cast<glsl::Shader::Type>(index)].saveAs();
 }
-void MainWindow::doCompile() {
-	_ui->teOutput->clear();
-
+void MainWindow::_onSourceChanged() {
+	if(_bAutoCheck)
+		_autoTimer->start();
+}
+void MainWindow::setAutoCheck(bool b) {
+	_bAutoCheck = b;
+	if(b)
+		_autoTimer->start();
+	else
+		_autoTimer->stop();
+}
+void MainWindow::reloadRules() {
+	glsl::SPRuleSet rules;
 	try {
-		_ui->trAttribute->clear();
-		_ui->trUnifom->clear();
-
-		QString vs_str(_ui->teVS->toPlainText());
-		QOpenGLShader vs_sh(QOpenGLShader::Vertex, this);
-		if(!vs_sh.compileSourceCode(vs_str))
-			throw std::runtime_error(vs_sh.log().toStdString());
-
-		QString fs_str(_ui->teFS->toPlainText());
-		QOpenGLShader fs_sh(QOpenGLShader::Fragment, this);
-		if(!fs_sh.compileSourceCode(fs_str))
-			throw std::runtime_error(fs_sh.log().toStdString());
-
-		QOpenGLShaderProgram prog(this);
-		prog.addShader(&vs_sh);
-		prog.addShader(&fs_sh);
-		if(!prog.link()) {
-			throw std::runtime_error(prog.log().toStdString());
+		rules = glsl::RuleSet::Reload(QApplication::applicationDirPath());
+	} catch(const std::exception& e) {
+		// 定義が壊れていたら今のルールセットを使い続ける
+		QMessageBox::warning(this, "error", QString("can't reload highlight rules: %1").arg(e.what()));
+		return;
+	}
+	for(auto& t : *_tab)
+		t.setRuleSet(rules);
+}
+glsl::AsyncCompiler* MainWindow::_getAsync() {
+	if(!_async && !_bAsyncFailed) {
+		try {
+			_ui->glwidget->makeCurrent();
+			_async.reset(new glsl::AsyncCompiler(_ui->glwidget->context()->contextHandle()));
+			_async->setCache(_cache.get());
+			QObject::connect(_async.get(), &glsl::AsyncCompiler::compiled, [this](int, const glsl::CompileResult& res){
+				statusBar()->clearMessage();
+				_showResult(res);
+			});
+		} catch(const std::exception& e) {
+			qWarning("can't start background compiler: %s", e.what());
+			_bAsyncFailed = true;
 		}
-
+	}
+	return _async.get();
+}
+void MainWindow::doCompile() {
+	_autoTimer->stop();
+	glsl::ProgramSource src;
+	for(int i=0 ; i<glsl::Shader::_Num ; i++)
+		src.source[i] = _edit[i]->toPlainText();
+	// 相対パスのインクルードは保存してあるファイルの場所から探す
+	QString path[glsl::Shader::_Num];
+	for(int i=0 ; i<glsl::Shader::_Num ; i++)
+		path[i] = (*_tab)[i].path();
+	_preTiming = glsl::Timing();
+	{
+		glsl::ScopedTiming st(_preTiming, glsl::Phase::Preprocess);
+		_pp->expand(src, path);
+	}
+	if(auto* async = _getAsync()) {
+		// 結果が来るまで前回の表示は残しておく
+		async->request(src);
+		statusBar()->showMessage("compiling...");
+		return;
+	}
+	// バックグラウンドのコンテキストが作れなければGUIスレッドでコンパイル
+	_ui->glwidget->makeCurrent();
+	if(!_compiler) {
+		_compiler.reset(new glsl::Compiler());
+		_compiler->setCache(_cache.get());
+	}
+	_showResult(_compiler->compile(src));
+}
+void MainWindow::_showResult(const glsl::CompileResult& res) {
+	_ui->teOutput->clear();
+	_ui->trAttribute->clear();
+	_ui->trUnifom->clear();
+	glsl::Timing timing = res.timing;
+	timing += _preTiming;
+	_timingStat.add(timing);
+	_ui->teOutput->append(QString("time: %1 (total %2ms)").arg(timing.toString()).arg(timing.total() / 1e6, 0, 'f', 2));
+	_ui->teOutput->append(QString("mean of %1 runs: %2").arg(_timingStat.numRun()).arg(MeanString(_timingStat)));
+	if(!res.bSuccess) {
+		_ui->teOutput->append("compile error:");
+		_ui->teOutput->append(res.log);
+		return;
+	}
+	auto fnAdd = [](QTreeWidget* tr, const glsl::VariableV& v) {
 		QStringList sl;
-		GLuint id = prog.programId();
-		GLint n;
-		GLsizei len;
-		GLint size;
-		GLenum type;
-		GLchar buff[256];
-		glGetProgramiv(id, GL_ACTIVE_ATTRIBUTES, &n);
-		for(int i=0 ; i<n ; i++) {
-			glGetActiveAttrib(id, i, sizeof(buff), &len, &size, &type, buff);
-
+		for(auto& a : v) {
+			const char* type = glsl::GetValueTypeStr(a.type);
 			sl.clear();
-			sl << QString("%1").arg(glGetAttribLocation(id, buff))
-				<< buff
-				<< glsl::GetValueTypeStr(type)
-				<< QString("%1").arg(size);
-			_ui->trAttribute->addTopLevelItem(new QTreeWidgetItem(sl));
+			sl << QString("%1").arg(a.location)
+				<< a.name
+				<< (type ? QString(type) : QString("0x%1").arg(a.type, 4, 16, QChar('0')))
+				<< QString("%1").arg(a.size);
+			tr->addTopLevelItem(new QTreeWidgetItem(sl));
 		}
-
-		glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &n);
-		for(int i=0 ; i<n ; i++) {
-			glGetActiveUniform(id, i, sizeof(buff), &len, &size, &type, buff);
-			sl.clear();
-			sl << QString("%1").arg(glGetUniformLocation(id, buff))
-				<< buff
-				<< glsl::GetValueTypeStr(type)
-				<< QString("%1").arg(size);
-			_ui->trUnifom->addTopLevelItem(new QTreeWidgetItem(sl));
-		}
-	} catch(const std::exception& e) {
-		_ui->teOutput->append("compile error:");
-		_ui->teOutput->append(e.what());
-	}
+	};
+	fnAdd(_ui->trAttribute, res.reflection.attribute);
+	fnAdd(_ui->trUnifom, res.reflection.uniform);
+	// シェーダーストレージブロックのメンバもuniformと同じ一覧に出す
+	fnAdd(_ui->trUnifom, res.reflection.bufferVariable);
 }
 void MainWindow::quit() {
 	qApp->quit();
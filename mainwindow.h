@@ -1,11 +1,22 @@
 #pragma once
 #include <QMainWindow>
 #include <QOpenGLFunctions>
+#include "glsl.h"
+#include "timing.h"
 #include <memory>
 
 namespace Ui {
 	class MainWindow;
 }
+class QTimer;
+class QTextEdit;
+namespace glsl {
+	class CompileCache;
+	class AsyncCompiler;
+	class Compiler;
+	class Preprocessor;
+	struct CompileResult;
+}
 class MainWindow : public QMainWindow, public QOpenGLFunctions {
 	Q_OBJECT
 	private:
@@ -16,11 +27,41 @@ class MainWindow : public QMainWindow, public QOpenGLFunctions {
 
 		std::shared_ptr<Ui::MainWindow>	_ui;
 		QOpenGLContext*	_ctx;
+		//! 前回と同じソースならコンパイルせずに結果を使う
+		std::unique_ptr<glsl::CompileCache>	_cache;
+		//! コンパイル前に#includeを展開する (読み込んだヘッダはキャッシュする)
+		std::unique_ptr<glsl::Preprocessor>	_pp;
+		//! ステージ毎のエディタ (タブの並び)
+		QTextEdit*	_edit[glsl::Shader::_Num];
+		//! バックグラウンドでのコンパイル (初回のコンパイル時に作成)
+		/*! Compilerを使い続けるので、変更していないステージはコンパイルし直さない */
+		std::unique_ptr<glsl::AsyncCompiler>	_async;
+		//! AsyncCompilerが作れなかった時にGUIスレッドで使う
+		std::unique_ptr<glsl::Compiler>		_compiler;
+		//! 自動チェック時、入力が止まってからコンパイルするまでの待ち
+		QTimer*		_autoTimer;
+		bool		_bAutoCheck = false,
+					_bAsyncFailed = false;	//!< AsyncCompilerが作れなかったか (以降はGUIスレッドでコンパイル)
+		//! 最後に要求したコンパイルの前処理時間 (結果を表示する時に足す)
+		glsl::Timing		_preTiming;
+		//! 起動してからのコンパイル毎の処理時間の集計
+		glsl::TimingStat	_timingStat;
+
+		//! エディタの内容が変わった (自動チェックが有効ならコンパイルを予約)
+		void _onSourceChanged();
+		//! AsyncCompilerを取得 (作れなければnullptr)
+		glsl::AsyncCompiler* _getAsync();
+		//! コンパイル結果をログと変数一覧に、処理時間をログに表示
+		void _showResult(const glsl::CompileResult& res);
 	public:
 		explicit MainWindow(QWidget* parent=nullptr);
 		~MainWindow();
 	public slots:
 		void doCompile();
+		//! 編集が止まったら自動でコンパイルするか
+		void setAutoCheck(bool b);
+		//! ハイライト定義(usercfg.json, defs, block.json)を読み直して全てのタブに適用する
+		void reloadRules();
 		//! ファイルダイアログを開き、シェーダーファイルをロード
 		/*! 種別は拡張子で判断 */
 		void loadShader();